@@ -25,6 +25,7 @@
 #include <exception>
 #include <functional>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace realm {
@@ -66,6 +67,15 @@ struct CollectionChangeSet {
 };
 
 using CollectionChangeCallback = std::function<void (CollectionChangeSet, std::exception_ptr)>;
+
+// Dot-separated paths of properties, starting from the collection's object
+// type, which a callback is interested in changes to (e.g. "name" or "owner.name")
+using KeyPathArray = std::vector<std::string>;
+
+// A callback which is passed a reference to a single immutable changeset which
+// is shared between all of the callbacks for a collection, rather than each
+// callback getting its own copy of the changeset
+using SharedCollectionChangeCallback = std::function<void (std::shared_ptr<const CollectionChangeSet>, std::exception_ptr)>;
 } // namespace realm
 
 #endif // REALM_COLLECTION_NOTIFICATIONS_HPP
@@ -21,7 +21,7 @@
 #include <realm/util/assert.hpp>
 #include <algorithm>
 
-#include <algorithm>
+#include <numeric>
 
 using namespace realm;
 using namespace realm::_impl;
@@ -118,7 +118,13 @@ void CollectionChangeBuilder::merge(CollectionChangeBuilder&& c)
     modifications.shift_for_insert_at(c.insertions);
     modifications.add(c.modifications);
 
-    c = {};
+    // Clearing each member rather than assigning a new builder avoids moving
+    // the IndexSets' inline storage around
+    c.deletions.clear();
+    c.insertions.clear();
+    c.modifications.clear();
+    c.moves.clear();
+    c.m_move_mapping.clear();
     verify();
 }
 
@@ -139,11 +145,11 @@ void CollectionChangeBuilder::clean_up_stale_moves()
 void CollectionChangeBuilder::parse_complete()
 {
     moves.reserve(m_move_mapping.size());
-    for (auto move : m_move_mapping) {
-        REALM_ASSERT_DEBUG(deletions.contains(move.second));
-        REALM_ASSERT_DEBUG(insertions.contains(move.first));
-        moves.push_back({move.second, move.first});
-    }
+    m_move_mapping.for_each([&](size_t to, size_t from) {
+        REALM_ASSERT_DEBUG(deletions.contains(from));
+        REALM_ASSERT_DEBUG(insertions.contains(to));
+        moves.push_back({from, to});
+    });
     m_move_mapping.clear();
     std::sort(begin(moves), end(moves),
               [](auto const& a, auto const& b) { return a.from < b.from; });
@@ -250,8 +256,8 @@ void CollectionChangeBuilder::move(size_t from, size_t to)
 void CollectionChangeBuilder::move_over(size_t row_ndx, size_t last_row, bool track_moves)
 {
     REALM_ASSERT(row_ndx <= last_row);
-    REALM_ASSERT(insertions.empty() || prev(insertions.end())->second - 1 <= last_row);
-    REALM_ASSERT(modifications.empty() || prev(modifications.end())->second - 1 <= last_row);
+    REALM_ASSERT(insertions.empty() || std::prev(insertions.end())->second - 1 <= last_row);
+    REALM_ASSERT(modifications.empty() || std::prev(modifications.end())->second - 1 <= last_row);
 
     if (row_ndx == last_row) {
         if (track_moves) {
@@ -276,26 +282,23 @@ void CollectionChangeBuilder::move_over(size_t row_ndx, size_t last_row, bool tr
         return;
 
     bool row_is_insertion = insertions.contains(row_ndx);
-    bool last_is_insertion = !insertions.empty() && prev(insertions.end())->second == last_row + 1;
-    REALM_ASSERT_DEBUG(insertions.empty() || prev(insertions.end())->second <= last_row + 1);
+    bool last_is_insertion = !insertions.empty() && std::prev(insertions.end())->second == last_row + 1;
+    REALM_ASSERT_DEBUG(insertions.empty() || std::prev(insertions.end())->second <= last_row + 1);
 
     // Collapse A -> B, B -> C into a single A -> C move
     bool last_was_already_moved = false;
     if (last_is_insertion) {
-        auto it = m_move_mapping.find(last_row);
-        if (it != m_move_mapping.end() && it->first == last_row) {
-            m_move_mapping[row_ndx] = it->second;
-            m_move_mapping.erase(it);
+        if (auto from = m_move_mapping.find(last_row)) {
+            size_t old_row = *from;
+            m_move_mapping.erase(last_row);
+            m_move_mapping.set(row_ndx, old_row);
             last_was_already_moved = true;
         }
     }
 
     // Remove moves to the row being deleted
-    if (row_is_insertion && !last_was_already_moved) {
-        auto it = m_move_mapping.find(row_ndx);
-        if (it != m_move_mapping.end() && it->first == row_ndx)
-            m_move_mapping.erase(it);
-    }
+    if (row_is_insertion && !last_was_already_moved)
+        m_move_mapping.erase(row_ndx);
 
     // Don't report deletions/moves if last_row is newly inserted
     if (last_is_insertion) {
@@ -305,7 +308,7 @@ void CollectionChangeBuilder::move_over(size_t row_ndx, size_t last_row, bool tr
     else if (!last_was_already_moved) {
         auto shifted_last_row = insertions.unshift(last_row);
         shifted_last_row = deletions.add_shifted(shifted_last_row);
-        m_move_mapping[row_ndx] = shifted_last_row;
+        m_move_mapping.set(row_ndx, shifted_last_row);
     }
 
     // Don't mark the moved-over row as deleted if it was a new insertion
@@ -334,6 +337,44 @@ struct RowInfo {
     size_t shifted_tv_index;
 };
 
+// Whether the indices up to `max_index` are dense enough relative to `count`
+// values that an array indexed by them is cheaper than sorting the values
+bool is_dense(size_t max_index, size_t count)
+{
+    return max_index / 4 <= count;
+}
+
+// Stably sort `values` by `key(value)`, which is linear time with a counting
+// sort when the keys are row or TV indices which are dense enough
+template<typename T, typename Key>
+void sort_by_index(std::vector<T>& values, Key key)
+{
+    size_t max_key = 0;
+    bool sorted = true;
+    for (size_t i = 0; i < values.size(); ++i) {
+        size_t k = key(values[i]);
+        sorted = sorted && (i == 0 || key(values[i - 1]) <= k);
+        max_key = std::max(max_key, k);
+    }
+    if (sorted)
+        return;
+    if (!is_dense(max_key, values.size())) {
+        std::stable_sort(begin(values), end(values), [&](auto const& lft, auto const& rgt) {
+            return key(lft) < key(rgt);
+        });
+        return;
+    }
+
+    std::vector<size_t> offsets(max_key + 2);
+    for (auto const& value : values)
+        ++offsets[key(value) + 1];
+    std::partial_sum(begin(offsets), end(offsets), begin(offsets));
+    std::vector<T> result(values.size());
+    for (auto const& value : values)
+        result[offsets[key(value)]++] = value;
+    values.swap(result);
+}
+
 void calculate_moves_unsorted(std::vector<RowInfo>& new_rows, IndexSet& removed, CollectionChangeSet& changeset)
 {
     size_t expected = 0;
@@ -506,13 +547,13 @@ void calculate_moves_sorted(std::vector<RowInfo>& rows, CollectionChangeSet& cha
     // then find matches in
     std::vector<LongestCommonSubsequenceCalculator::Row> a, b;
 
+    // Each old row has been matched to at most one new row, so the old TV
+    // indices are unique and are all that `a` needs to be sorted by
     a.reserve(rows.size());
     for (auto& row : rows) {
         a.push_back({row.row_index, row.prev_tv_index});
     }
-    std::sort(begin(a), end(a), [](auto lft, auto rgt) {
-        return std::tie(lft.tv_index, lft.row_index) < std::tie(rgt.tv_index, rgt.row_index);
-    });
+    sort_by_index(a, [](auto const& row) { return row.tv_index; });
 
     // Before constructing `b`, first find the first index in `a` which will
     // actually differ in `b`, and skip everything else if there aren't any
@@ -526,13 +567,12 @@ void calculate_moves_sorted(std::vector<RowInfo>& rows, CollectionChangeSet& cha
     if (first_difference == IndexSet::npos)
         return;
 
-    // Note that `b` is sorted by row_index, while `a` is sorted by tv_index
+    // Note that `b` is sorted by row_index, while `a` is sorted by tv_index.
+    // The sort is stable, so rows with the same row index stay in TV order.
     b.reserve(rows.size());
     for (size_t i = 0; i < rows.size(); ++i)
         b.push_back({rows[i].row_index, i});
-    std::sort(begin(b), end(b), [](auto lft, auto rgt) {
-        return std::tie(lft.row_index, lft.tv_index) < std::tie(rgt.row_index, rgt.tv_index);
-    });
+    sort_by_index(b, [](auto const& row) { return row.row_index; });
 
     // Calculate the LCS of the two sequences
     auto matches = LongestCommonSubsequenceCalculator(a, b, first_difference,
@@ -550,45 +590,77 @@ void calculate_moves_sorted(std::vector<RowInfo>& rows, CollectionChangeSet& cha
     }
 }
 
-} // Anonymous namespace
-
-CollectionChangeBuilder CollectionChangeBuilder::calculate(std::vector<size_t> const& prev_rows,
-                                                           std::vector<size_t> const& next_rows,
-                                                           std::function<bool (size_t)> row_did_change,
-                                                           bool rows_are_in_table_order)
+// Find the rows which have to be moved to turn the old order into the new one
+// using the longest increasing subsequence of the old indices of the rows in
+// their new order, which is O(N log N) time and O(N) space, unlike the LCS
+// calculator's O(N^2) worst case. This relies on each old row having been
+// matched to at most one new row, which is true by this point even for
+// collections with duplicates, but for those it may not pick the same rows to
+// move as the LCS calculator would.
+// Returns false without modifying the changeset if more than `max_moved_rows`
+// rows would have to be moved.
+bool calculate_moves_sorted_bounded(std::vector<RowInfo> const& rows, CollectionChangeSet& changeset,
+                                    size_t max_moved_rows)
 {
-    REALM_ASSERT_DEBUG(!rows_are_in_table_order || std::is_sorted(begin(next_rows), end(next_rows)));
+    // tails[k] is the index in `rows` of the row with the lowest old index
+    // which ends an increasing subsequence of length k + 1
+    std::vector<size_t> tails;
+    // The row before each row in the longest increasing subsequence ending at it
+    std::vector<size_t> predecessors(rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+        auto it = std::lower_bound(begin(tails), end(tails), rows[i].prev_tv_index,
+                                   [&](size_t tail, size_t index) { return rows[tail].prev_tv_index < index; });
+        predecessors[i] = it == begin(tails) ? IndexSet::npos : *(it - 1);
+        if (it == end(tails))
+            tails.push_back(i);
+        else
+            *it = i;
+    }
 
-    CollectionChangeBuilder ret;
+    if (rows.size() - tails.size() > max_moved_rows)
+        return false;
+
+    std::vector<bool> in_place(rows.size());
+    for (size_t i = tails.empty() ? IndexSet::npos : tails.back(); i != IndexSet::npos; i = predecessors[i])
+        in_place[i] = true;
+
+    // `rows` is in new order, so the insertions are added in order but the
+    // deletions need to be sorted first to avoid O(N^2) behavior in IndexSet
+    std::vector<size_t> deletions;
+    deletions.reserve(rows.size() - tails.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (!in_place[i]) {
+            deletions.push_back(rows[i].prev_tv_index);
+            changeset.insertions.add(rows[i].tv_index);
+        }
+    }
+    sort_by_index(deletions, [](size_t index) { return index; });
+    for (auto index : deletions)
+        changeset.deletions.add(index);
+    return true;
+}
 
+// Match up the rows in prev_rows and next_rows by sorting both by row index,
+// adding the unmatched rows to `insertions` and `removed`
+void match_rows_by_sorting(std::vector<size_t> const& prev_rows, std::vector<size_t> const& next_rows,
+                           IndexSet& insertions, IndexSet& removed, std::vector<RowInfo>& new_rows)
+{
     size_t deleted = 0;
     std::vector<RowInfo> old_rows;
     old_rows.reserve(prev_rows.size());
     for (size_t i = 0; i < prev_rows.size(); ++i) {
-        if (prev_rows[i] == IndexSet::npos) {
+        if (prev_rows[i] == IndexSet::npos)
             ++deleted;
-            ret.deletions.add(i);
-        }
         else
             old_rows.push_back({prev_rows[i], IndexSet::npos, i, i - deleted});
     }
-    std::sort(begin(old_rows), end(old_rows), [](auto& lft, auto& rgt) {
-        return lft.row_index < rgt.row_index;
-    });
+    sort_by_index(old_rows, [](auto const& row) { return row.row_index; });
 
-    std::vector<RowInfo> new_rows;
     new_rows.reserve(next_rows.size());
     for (size_t i = 0; i < next_rows.size(); ++i) {
         new_rows.push_back({next_rows[i], IndexSet::npos, i, 0});
     }
-    std::sort(begin(new_rows), end(new_rows), [](auto& lft, auto& rgt) {
-        return lft.row_index < rgt.row_index;
-    });
-
-    // Don't add rows which were modified to not match the query to `deletions`
-    // immediately because the unsorted move logic needs to be able to
-    // distinguish them from rows which were outright deleted
-    IndexSet removed;
+    sort_by_index(new_rows, [](auto const& row) { return row.row_index; });
 
     // Now that our old and new sets of rows are sorted by row index, we can
     // iterate over them and either record old+new TV indices for rows present
@@ -608,7 +680,7 @@ CollectionChangeBuilder CollectionChangeBuilder::calculate(std::vector<size_t> c
             ++i;
         }
         else {
-            ret.insertions.add(new_index.tv_index);
+            insertions.add(new_index.tv_index);
             ++j;
         }
     }
@@ -616,15 +688,116 @@ CollectionChangeBuilder CollectionChangeBuilder::calculate(std::vector<size_t> c
     for (; i < old_rows.size(); ++i)
         removed.add(old_rows[i].tv_index);
     for (; j < new_rows.size(); ++j)
-        ret.insertions.add(new_rows[j].tv_index);
+        insertions.add(new_rows[j].tv_index);
 
     // Filter out the new insertions since we don't need them for any of the
     // further calculations
     new_rows.erase(std::remove_if(begin(new_rows), end(new_rows),
                                   [](auto& row) { return row.prev_tv_index == IndexSet::npos; }),
                    end(new_rows));
-    std::sort(begin(new_rows), end(new_rows),
-              [](auto& lft, auto& rgt) { return lft.tv_index < rgt.tv_index; });
+    sort_by_index(new_rows, [](auto const& row) { return row.tv_index; });
+}
+
+// Match up the rows in prev_rows and next_rows with an array indexed by row
+// index, which is linear time and produces the matched rows in TV order
+// without any sorting. Returns false without doing anything if the row
+// indices are too sparse for this, or if prev_rows has duplicates, as then
+// which of the duplicates are matched up has to be decided by sorting.
+bool match_rows_by_index(std::vector<size_t> const& prev_rows, std::vector<size_t> const& next_rows,
+                         size_t max_row, IndexSet& insertions, IndexSet& removed, std::vector<RowInfo>& new_rows)
+{
+    if (!is_dense(max_row, prev_rows.size() + next_rows.size()))
+        return false;
+
+    // The old TV index of each row which hasn't yet been matched to a new row
+    std::vector<size_t> old_index(max_row + 1, IndexSet::npos);
+    for (size_t i = 0; i < prev_rows.size(); ++i) {
+        if (prev_rows[i] == IndexSet::npos)
+            continue;
+        if (old_index[prev_rows[i]] != IndexSet::npos)
+            return false;
+        old_index[prev_rows[i]] = i;
+    }
+
+    // The old TV indices adjusted for the rows which were deleted outright
+    std::vector<size_t> shifted_index(prev_rows.size());
+    for (size_t i = 0, deleted = 0; i < prev_rows.size(); ++i) {
+        if (prev_rows[i] == IndexSet::npos)
+            ++deleted;
+        shifted_index[i] = i - deleted;
+    }
+
+    new_rows.reserve(next_rows.size());
+    for (size_t i = 0; i < next_rows.size(); ++i) {
+        auto& old = old_index[next_rows[i]];
+        if (old == IndexSet::npos) {
+            insertions.add(i);
+            continue;
+        }
+        new_rows.push_back({next_rows[i], old, i, shifted_index[old]});
+        // Any duplicates of this row in next_rows are insertions
+        old = IndexSet::npos;
+    }
+
+    for (size_t i = 0; i < prev_rows.size(); ++i) {
+        if (prev_rows[i] != IndexSet::npos && old_index[prev_rows[i]] == i)
+            removed.add(i);
+    }
+    return true;
+}
+
+#ifdef REALM_DEBUG
+// Verify that applying the calculated change to prev_rows actually produces next_rows
+void verify_changeset(std::vector<size_t> const& prev_rows,
+                      std::vector<size_t> const& next_rows,
+                      CollectionChangeSet const& changeset)
+{
+    auto rows = prev_rows;
+    auto it = util::make_reverse_iterator(changeset.deletions.end());
+    auto end = util::make_reverse_iterator(changeset.deletions.begin());
+    for (; it != end; ++it) {
+        rows.erase(rows.begin() + it->first, rows.begin() + it->second);
+    }
+
+    for (auto i : changeset.insertions.as_indexes()) {
+        rows.insert(rows.begin() + i, next_rows[i]);
+    }
+
+    REALM_ASSERT(rows == next_rows);
+}
+#endif
+
+} // Anonymous namespace
+
+CollectionChangeBuilder CollectionChangeBuilder::calculate(std::vector<size_t> const& prev_rows,
+                                                           std::vector<size_t> const& next_rows,
+                                                           std::function<bool (size_t)> row_did_change,
+                                                           bool rows_are_in_table_order,
+                                                           size_t max_moved_rows)
+{
+    REALM_ASSERT_DEBUG(!rows_are_in_table_order || std::is_sorted(begin(next_rows), end(next_rows)));
+
+    CollectionChangeBuilder ret;
+
+    size_t max_row = 0;
+    for (size_t i = 0; i < prev_rows.size(); ++i) {
+        if (prev_rows[i] == IndexSet::npos)
+            ret.deletions.add(i);
+        else
+            max_row = std::max(max_row, prev_rows[i]);
+    }
+    for (auto row : next_rows)
+        max_row = std::max(max_row, row);
+
+    // Don't add rows which were modified to not match the query to `deletions`
+    // immediately because the unsorted move logic needs to be able to
+    // distinguish them from rows which were outright deleted
+    IndexSet removed;
+
+    // The rows present in both, in new TV order, with their old TV indices
+    std::vector<RowInfo> new_rows;
+    if (!match_rows_by_index(prev_rows, next_rows, max_row, ret.insertions, removed, new_rows))
+        match_rows_by_sorting(prev_rows, next_rows, ret.insertions, removed, new_rows);
 
     for (auto& row : new_rows) {
         if (row_did_change(row.row_index)) {
@@ -632,29 +805,255 @@ CollectionChangeBuilder CollectionChangeBuilder::calculate(std::vector<size_t> c
         }
     }
 
-    if (!rows_are_in_table_order) {
+    if (rows_are_in_table_order) {
+        calculate_moves_unsorted(new_rows, removed, ret);
+    }
+    else if (max_moved_rows == IndexSet::npos) {
         calculate_moves_sorted(new_rows, ret);
     }
-    else {
-        calculate_moves_unsorted(new_rows, removed, ret);
+    else if (!calculate_moves_sorted_bounded(new_rows, ret, max_moved_rows)) {
+        // Too many rows moved for a fine-grained changeset to be useful, so
+        // report it as every row being replaced
+        ret = {};
+        ret.deletions.set(prev_rows.size());
+        ret.insertions.set(next_rows.size());
+        removed.clear();
     }
     ret.deletions.add(removed);
     ret.verify();
 
 #ifdef REALM_DEBUG
-    { // Verify that applying the calculated change to prev_rows actually produces next_rows
+    verify_changeset(prev_rows, next_rows, ret);
+#endif
+
+    return ret;
+}
+
+CollectionChangeBuilder CollectionChangeBuilder::calculate_incremental(std::vector<size_t> const& prev_rows,
+                                                                       std::vector<size_t> const& next_rows,
+                                                                       CollectionChangeBuilder const& table_changes)
+{
+    REALM_ASSERT_DEBUG(std::is_sorted(begin(prev_rows), end(prev_rows)));
+    REALM_ASSERT_DEBUG(std::is_sorted(begin(next_rows), end(next_rows)));
+
+    CollectionChangeBuilder ret;
+
+    auto index_of = [](std::vector<size_t> const& rows, size_t row) {
+        auto it = std::lower_bound(begin(rows), end(rows), row);
+        return it != end(rows) && *it == row ? size_t(it - begin(rows)) : IndexSet::npos;
+    };
+
+    // Rows which were deleted from the table or moved to a different row
+    // index. Both the deletions and the moves are sorted by source row.
+    auto const& moves = table_changes.moves;
+    for (auto range : table_changes.deletions) {
+        auto it = std::lower_bound(begin(prev_rows), end(prev_rows), range.first);
+        for (; it != end(prev_rows) && *it < range.second; ++it) {
+            size_t old_ndx = it - begin(prev_rows);
+            auto move = std::lower_bound(begin(moves), end(moves), *it,
+                                         [](auto const& m, size_t row) { return m.from < row; });
+            size_t new_ndx = IndexSet::npos;
+            if (move != end(moves) && move->from == *it)
+                new_ndx = index_of(next_rows, move->to);
+
+            ret.deletions.add(old_ndx);
+            if (new_ndx != IndexSet::npos) {
+                ret.insertions.add(new_ndx);
+                ret.moves.push_back({old_ndx, new_ndx});
+            }
+        }
+    }
+
+    // New rows which match, including the destinations of moves which didn't
+    // match previously
+    for (auto range : table_changes.insertions) {
+        auto it = std::lower_bound(begin(next_rows), end(next_rows), range.first);
+        for (; it != end(next_rows) && *it < range.second; ++it)
+            ret.insertions.add(it - begin(next_rows));
+    }
+
+    // Modified rows may have started or stopped matching, or just been modified
+    std::vector<Move> moves_by_dest;
+    if (!moves.empty() && !table_changes.modifications.empty()) {
+        moves_by_dest = moves;
+        std::sort(begin(moves_by_dest), end(moves_by_dest),
+                  [](auto const& a, auto const& b) { return a.to < b.to; });
+    }
+    for (auto row : table_changes.modifications.as_indexes()) {
+        size_t old_row;
+        if (table_changes.insertions.contains(row)) {
+            // Newly inserted rows were handled above, so only moved rows are left
+            auto move = std::lower_bound(begin(moves_by_dest), end(moves_by_dest), row,
+                                         [](auto const& m, size_t row) { return m.to < row; });
+            if (move == end(moves_by_dest) || move->to != row)
+                continue;
+            old_row = move->from;
+        }
+        else {
+            old_row = table_changes.deletions.shift(table_changes.insertions.unshift(row));
+        }
+
+        size_t old_ndx = index_of(prev_rows, old_row);
+        size_t new_ndx = index_of(next_rows, row);
+        if (old_ndx != IndexSet::npos && new_ndx != IndexSet::npos)
+            ret.modifications.add(new_ndx);
+        else if (old_ndx != IndexSet::npos)
+            ret.deletions.add(old_ndx);
+        else if (new_ndx != IndexSet::npos)
+            ret.insertions.add(new_ndx);
+    }
+
+    ret.clean_up_stale_moves();
+    ret.verify();
+
+#ifdef REALM_DEBUG
+    { // Map the surviving previous rows to their new row indices and verify
+      // that applying the changes to that produces next_rows
         auto rows = prev_rows;
-        auto it = util::make_reverse_iterator(ret.deletions.end());
-        auto end = util::make_reverse_iterator(ret.deletions.begin());
-        for (; it != end; ++it) {
-            rows.erase(rows.begin() + it->first, rows.begin() + it->second);
+        for (auto& row : rows) {
+            auto move = std::lower_bound(begin(moves), end(moves), row,
+                                         [](auto const& m, size_t row) { return m.from < row; });
+            if (move != end(moves) && move->from == row)
+                row = move->to;
+            else if (table_changes.deletions.contains(row))
+                row = IndexSet::npos;
+            else
+                row = table_changes.insertions.shift(table_changes.deletions.unshift(row));
+        }
+        verify_changeset(rows, next_rows, ret);
+    }
+#endif
+
+    return ret;
+}
+
+CollectionChangeBuilder CollectionChangeBuilder::calculate_incremental_sorted(std::vector<size_t> const& prev_rows,
+                                                                              std::vector<size_t> const& next_rows,
+                                                                              CollectionChangeBuilder const& table_changes)
+{
+    CollectionChangeBuilder ret;
+
+    // Map a row index from before the table changes to after them, or npos if
+    // the row was deleted
+    auto const& moves = table_changes.moves;
+    auto map_row = [&](size_t row) {
+        auto move = std::lower_bound(begin(moves), end(moves), row,
+                                     [](auto const& m, size_t row) { return m.from < row; });
+        if (move != end(moves) && move->from == row)
+            return move->to;
+        if (table_changes.deletions.contains(row))
+            return IndexSet::npos;
+        return table_changes.insertions.shift(table_changes.deletions.unshift(row));
+    };
+    // Moved rows are in insertions, and their position relative to rows with
+    // equal values can change even if they weren't modified
+    auto row_changed = [&](size_t row) {
+        return table_changes.insertions.contains(row) || table_changes.modifications.contains(row);
+    };
+
+    struct ChangedRow {
+        size_t row_index;
+        size_t prev_tv_index;
+        size_t tv_index;
+        // The number of unchanged rows before this one in the old order
+        size_t stable_rank;
+    };
+
+    // Find the old positions of the changed rows. The unchanged rows are in
+    // the same relative order in both sets of rows and are never moved.
+    std::vector<ChangedRow> changed;
+    size_t stable = 0;
+    for (size_t i = 0; i < prev_rows.size(); ++i) {
+        size_t row = map_row(prev_rows[i]);
+        if (row == IndexSet::npos)
+            ret.deletions.add(i);
+        else if (row_changed(row))
+            changed.push_back({row, i, IndexSet::npos, stable});
+        else
+            ++stable;
+    }
+    std::sort(begin(changed), end(changed),
+              [](auto const& a, auto const& b) { return a.row_index < b.row_index; });
+
+    // Find the new positions of the changed rows. A changed row which is in
+    // both sets of rows can only stay in place if it has the same unchanged
+    // rows before it in both, so collect those in new order for the next step
+    // and report the rest as moved.
+    std::vector<ChangedRow*> candidates;
+    stable = 0;
+    for (size_t i = 0; i < next_rows.size(); ++i) {
+        size_t row = next_rows[i];
+        if (!row_changed(row)) {
+            ++stable;
+            continue;
+        }
+
+        auto it = std::lower_bound(begin(changed), end(changed), row,
+                                   [](auto const& c, size_t row) { return c.row_index < row; });
+        if (it == end(changed) || it->row_index != row) {
+            ret.insertions.add(i);
+            continue;
+        }
+
+        it->tv_index = i;
+        if (table_changes.modifications.contains(row))
+            ret.modifications.add(i);
+        if (it->stable_rank == stable)
+            candidates.push_back(&*it);
+        else {
+            ret.deletions.add(it->prev_tv_index);
+            ret.insertions.add(i);
+        }
+    }
+
+    for (auto& row : changed) {
+        if (row.tv_index == IndexSet::npos)
+            ret.deletions.add(row.prev_tv_index);
+    }
+
+    // Candidates between the same pair of unchanged rows can still be out of
+    // order relative to each other, so keep the longest run of them which is
+    // in the same order as before in place and move the rest
+    for (size_t group_begin = 0; group_begin < candidates.size(); ) {
+        size_t group_end = group_begin + 1;
+        while (group_end < candidates.size() && candidates[group_end]->stable_rank == candidates[group_begin]->stable_rank)
+            ++group_end;
+
+        // tails[k] is the index of the candidate with the lowest old index
+        // which ends an increasing subsequence of length k + 1
+        std::vector<size_t> tails;
+        std::vector<size_t> predecessors(group_end - group_begin);
+        for (size_t i = group_begin; i < group_end; ++i) {
+            auto it = std::lower_bound(begin(tails), end(tails), candidates[i]->prev_tv_index,
+                                       [&](size_t tail, size_t index) { return candidates[tail]->prev_tv_index < index; });
+            predecessors[i - group_begin] = it == begin(tails) ? IndexSet::npos : *(it - 1);
+            if (it == end(tails))
+                tails.push_back(i);
+            else
+                *it = i;
         }
 
-        for (auto i : ret.insertions.as_indexes()) {
-            rows.insert(rows.begin() + i, next_rows[i]);
+        std::vector<bool> in_place(group_end - group_begin);
+        for (size_t i = tails.back(); i != IndexSet::npos; i = predecessors[i - group_begin])
+            in_place[i - group_begin] = true;
+        for (size_t i = group_begin; i < group_end; ++i) {
+            if (!in_place[i - group_begin]) {
+                ret.deletions.add(candidates[i]->prev_tv_index);
+                ret.insertions.add(candidates[i]->tv_index);
+            }
         }
 
-        REALM_ASSERT(rows == next_rows);
+        group_begin = group_end;
+    }
+
+    ret.verify();
+
+#ifdef REALM_DEBUG
+    {
+        auto rows = prev_rows;
+        for (auto& row : rows)
+            row = map_row(row);
+        verify_changeset(rows, next_rows, ret);
     }
 #endif
 
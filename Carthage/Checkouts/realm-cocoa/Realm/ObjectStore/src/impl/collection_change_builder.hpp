@@ -20,8 +20,7 @@
 #define REALM_COLLECTION_CHANGE_BUILDER_HPP
 
 #include "collection_notifications.hpp"
-
-#include <unordered_map>
+#include "util/flat_index_map.hpp"
 
 namespace realm {
 namespace _impl {
@@ -39,10 +38,37 @@ public:
 
     // Calculate where rows need to be inserted or deleted from old_rows to turn
     // it into new_rows, and check all matching rows for modifications
+    //
+    // If `max_moved_rows` is not npos and the rows are not in table order,
+    // moves are found with an O(N log N) algorithm rather than the O(N^2)
+    // worst-case default, and if more than `max_moved_rows` rows moved the
+    // changeset instead reports all of the old rows as deleted and all of the
+    // new rows as inserted.
     static CollectionChangeBuilder calculate(std::vector<size_t> const& old_rows,
                                              std::vector<size_t> const& new_rows,
                                              std::function<bool (size_t)> row_did_change,
-                                             bool sort);
+                                             bool rows_are_in_table_order,
+                                             size_t max_moved_rows=IndexSet::npos);
+
+    // Calculate the changes between old_rows and new_rows, both of which must
+    // be in table order, using the table-level changes to skip over rows which
+    // cannot have changed. Only valid if membership in new_rows can only have
+    // changed for rows which were inserted, deleted, moved or modified in
+    // `table_changes`.
+    static CollectionChangeBuilder calculate_incremental(std::vector<size_t> const& old_rows,
+                                                         std::vector<size_t> const& new_rows,
+                                                         CollectionChangeBuilder const& table_changes);
+
+    // Calculate the changes between old_rows and new_rows, which are both
+    // sorted by the values of the rows, using the table-level changes to find
+    // the rows which may have changed position. Unchanged rows keep their
+    // relative order, so only the changed rows have to be located in each
+    // ordering. Only valid if rows which were not inserted, deleted, moved or
+    // modified in `table_changes` cannot have changed membership or relative
+    // order in new_rows.
+    static CollectionChangeBuilder calculate_incremental_sorted(std::vector<size_t> const& old_rows,
+                                                                std::vector<size_t> const& new_rows,
+                                                                CollectionChangeBuilder const& table_changes);
 
     void merge(CollectionChangeBuilder&&);
     void clean_up_stale_moves();
@@ -57,7 +83,9 @@ public:
     void parse_complete();
 
 private:
-    std::unordered_map<size_t, size_t> m_move_mapping;
+    // Map from the new row index to the old row index of each row moved by
+    // move_over(), converted to `moves` by parse_complete()
+    util::FlatIndexMap m_move_mapping;
 
     void verify();
 };
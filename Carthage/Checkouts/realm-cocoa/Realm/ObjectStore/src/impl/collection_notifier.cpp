@@ -19,10 +19,18 @@
 #include "impl/collection_notifier.hpp"
 
 #include "impl/realm_coordinator.hpp"
+#include "object_schema.hpp"
+#include "object_store.hpp"
+#include "property.hpp"
+#include "schema.hpp"
 #include "shared_realm.hpp"
+#include "util/format.hpp"
 
+#include <realm/group.hpp>
 #include <realm/link_view.hpp>
 
+#include <algorithm>
+
 using namespace realm;
 using namespace realm::_impl;
 
@@ -41,7 +49,26 @@ CollectionNotifier::get_modification_checker(TransactionChangeInfo const& info,
         return [](size_t) { return false; };
     }
 
-    return DeepChangeChecker(info, root_table, m_related_tables);
+    return info.dirty_rows->get_checker(info, root_table, m_related_tables);
+}
+
+void CollectionNotifier::calculate_filtered_modifications(TransactionChangeInfo const& info,
+                                                          Table const& root_table,
+                                                          IndexSet const& modifications,
+                                                          std::function<size_t (size_t)> row_at,
+                                                          IndexSet const& direct_modifications)
+{
+    for (auto filter : key_path_filters()) {
+        filter->modifications = direct_modifications;
+        if (modifications.empty())
+            continue;
+
+        DeepChangeChecker checker(info, root_table, m_related_tables, &filter->columns);
+        for (auto ndx : modifications.as_indexes()) {
+            if (!direct_modifications.contains(ndx) && checker(row_at(ndx)))
+                filter->modifications.add(ndx);
+        }
+    }
 }
 
 void DeepChangeChecker::find_related_tables(std::vector<RelatedTable>& out, Table const& table)
@@ -68,13 +95,40 @@ void DeepChangeChecker::find_related_tables(std::vector<RelatedTable>& out, Tabl
 
 DeepChangeChecker::DeepChangeChecker(TransactionChangeInfo const& info,
                                      Table const& root_table,
-                                     std::vector<RelatedTable> const& related_tables)
+                                     std::vector<RelatedTable> const& related_tables,
+                                     ColumnFilter const* filter)
 : m_info(info)
 , m_root_table(root_table)
 , m_root_table_ndx(root_table.get_index_in_group())
 , m_root_modifications(m_root_table_ndx < info.tables.size() ? &info.tables[m_root_table_ndx].modifications : nullptr)
 , m_related_tables(related_tables)
+, m_filter(filter)
+{
+}
+
+bool DeepChangeChecker::row_modified(size_t table_ndx, size_t row_ndx) const
 {
+    if (table_ndx >= m_info.tables.size() || !m_info.tables[table_ndx].modifications.contains(row_ndx))
+        return false;
+    if (!m_filter)
+        return true;
+
+    auto range = std::equal_range(m_filter->begin(), m_filter->end(), std::make_pair(table_ndx, size_t(0)),
+                                  [](auto const& a, auto const& b) { return a.first < b.first; });
+    if (range.first == range.second)
+        return false;
+
+    // If the per-column changes weren't tracked for this version we can only
+    // report that the row was modified
+    if (table_ndx >= m_info.table_columns_needed.size() || !m_info.table_columns_needed[table_ndx])
+        return true;
+    if (table_ndx >= m_info.columns.size())
+        return false;
+
+    auto const& columns = m_info.columns[table_ndx];
+    return std::any_of(range.first, range.second, [&](auto const& column) {
+        return column.second < columns.size() && columns[column.second].contains(row_ndx);
+    });
 }
 
 bool DeepChangeChecker::check_outgoing_links(size_t table_ndx,
@@ -98,6 +152,8 @@ bool DeepChangeChecker::check_outgoing_links(size_t table_ndx,
     };
 
     for (auto const& link : it->links) {
+        if (m_filter && !std::binary_search(m_filter->begin(), m_filter->end(), std::make_pair(table_ndx, link.col_ndx)))
+            continue;
         if (already_checking(link.col_ndx))
             continue;
         if (!link.is_list) {
@@ -131,7 +187,7 @@ bool DeepChangeChecker::check_row(Table const& table, size_t idx, size_t depth)
     }
 
     size_t table_ndx = table.get_index_in_group();
-    if (depth > 0 && table_ndx < m_info.tables.size() && m_info.tables[table_ndx].modifications.contains(idx))
+    if (depth > 0 && row_modified(table_ndx, idx))
         return true;
 
     if (m_not_modified.size() <= table_ndx)
@@ -145,9 +201,106 @@ bool DeepChangeChecker::check_row(Table const& table, size_t idx, size_t depth)
     return ret;
 }
 
+std::function<bool (size_t)>
+DirtyRowClosure::get_checker(TransactionChangeInfo const& info, Table const& root_table,
+                             std::vector<DeepChangeChecker::RelatedTable> const& related_tables)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    calculate(info, root_table, related_tables);
+    auto rows = m_rows[root_table.get_index_in_group()].get();
+    return [=](size_t ndx) { return rows->contains(ndx); };
+}
+
+void DirtyRowClosure::calculate(TransactionChangeInfo const& info, Table const& root_table,
+                                std::vector<DeepChangeChecker::RelatedTable> const& related_tables)
+{
+    auto is_calculated = [&](size_t table_ndx) {
+        return table_ndx < m_rows.size() && m_rows[table_ndx];
+    };
+    if (std::all_of(begin(related_tables), end(related_tables),
+                    [&](auto const& tbl) { return is_calculated(tbl.table_ndx); }))
+        return;
+
+    // Look up the accessors for all of the related tables. Each table comes
+    // after some table which links to it, other than the root table which is first.
+    auto max = max_element(begin(related_tables), end(related_tables),
+                           [](auto&& a, auto&& b) { return a.table_ndx < b.table_ndx; });
+    std::vector<ConstTableRef> tables(max->table_ndx + 1);
+    tables[root_table.get_index_in_group()] = root_table.get_table_ref();
+    for (auto const& tbl : related_tables) {
+        for (auto const& link : tbl.links) {
+            auto target = tables[tbl.table_ndx]->get_link_target(link.col_ndx);
+            tables[target->get_index_in_group()] = target;
+        }
+    }
+    if (m_rows.size() < tables.size())
+        m_rows.resize(tables.size());
+    std::vector<bool> was_calculated(tables.size());
+    for (auto const& tbl : related_tables)
+        was_calculated[tbl.table_ndx] = is_calculated(tbl.table_ndx);
+
+    // Start from the modified rows of the new tables, and add each row which
+    // links to a dirty row until nothing changes
+    std::vector<std::pair<size_t, size_t>> dirty;
+    std::vector<std::vector<std::pair<size_t, size_t>>> incoming_links(tables.size());
+    for (auto const& tbl : related_tables) {
+        if (was_calculated[tbl.table_ndx])
+            continue;
+
+        auto& table = *tables[tbl.table_ndx];
+        auto& rows = m_rows[tbl.table_ndx];
+        rows = std::make_unique<util::FlatIndexMap>();
+        if (tbl.table_ndx < info.tables.size()) {
+            for (auto ndx : info.tables[tbl.table_ndx].modifications.as_indexes()) {
+                if (ndx < table.size()) {
+                    rows->set(ndx, 0);
+                    dirty.emplace_back(tbl.table_ndx, ndx);
+                }
+            }
+        }
+
+        for (auto const& link : tbl.links) {
+            auto target_ndx = table.get_link_target(link.col_ndx)->get_index_in_group();
+            incoming_links[target_ndx].emplace_back(tbl.table_ndx, link.col_ndx);
+        }
+    }
+
+    // Dirty rows in previously calculated tables can also make rows in the
+    // new tables dirty if the new tables link to them
+    for (size_t table_ndx = 0; table_ndx < tables.size(); ++table_ndx) {
+        if (!was_calculated[table_ndx] || incoming_links[table_ndx].empty())
+            continue;
+        m_rows[table_ndx]->for_each([&](size_t ndx, size_t) {
+            dirty.emplace_back(table_ndx, ndx);
+        });
+    }
+
+    while (!dirty.empty()) {
+        auto target = dirty.back();
+        dirty.pop_back();
+
+        auto const& target_table = *tables[target.first];
+        for (auto const& link : incoming_links[target.first]) {
+            auto const& origin = *tables[link.first];
+            auto& rows = *m_rows[link.first];
+            for (size_t i = 0, count = target_table.get_backlink_count(target.second, origin, link.second); i < count; ++i) {
+                size_t ndx = target_table.get_backlink(target.second, origin, link.second, i);
+                if (!rows.contains(ndx)) {
+                    rows.set(ndx, 0);
+                    dirty.emplace_back(link.first, ndx);
+                }
+            }
+        }
+    }
+}
+
 bool DeepChangeChecker::operator()(size_t ndx)
 {
-    if (m_root_modifications && m_root_modifications->contains(ndx))
+    if (m_filter) {
+        if (row_modified(m_root_table_ndx, ndx))
+            return true;
+    }
+    else if (m_root_modifications && m_root_modifications->contains(ndx))
         return true;
     return check_row(m_root_table, ndx, 0);
 }
@@ -165,10 +318,80 @@ CollectionNotifier::~CollectionNotifier()
     unregister();
 }
 
-size_t CollectionNotifier::add_callback(CollectionChangeCallback callback)
+size_t CollectionNotifier::add_callback(CollectionChangeCallback callback, KeyPathArray key_paths)
+{
+    return add_callback([callback = std::move(callback)](std::shared_ptr<const CollectionChangeSet> changes,
+                                                         std::exception_ptr err) {
+        callback(*changes, err);
+    }, std::move(key_paths));
+}
+
+ColumnFilter CollectionNotifier::resolve_key_paths(KeyPathArray const& key_paths) const
+{
+    auto& group = m_realm->read_group();
+    auto& schema = m_realm->schema();
+    auto root_table = group.get_table(m_related_tables.front().table_ndx);
+    auto root_type = ObjectStore::object_type_for_table_name(root_table->get_name());
+
+    ColumnFilter columns;
+    for (auto const& key_path : key_paths) {
+        auto object_schema = schema.find(root_type);
+        size_t start = 0;
+        while (true) {
+            size_t end = std::min(key_path.find('.', start), key_path.size());
+            auto name = key_path.substr(start, end - start);
+            auto prop = object_schema->property_for_name(name);
+            if (!prop) {
+                throw std::invalid_argument(util::format("Invalid key path '%1': property '%2.%3' does not exist.",
+                                                         key_path, object_schema->name, name));
+            }
+            if (prop->type == PropertyType::LinkingObjects) {
+                throw std::invalid_argument(util::format("Invalid key path '%1': linking objects property '%2.%3' cannot be observed.",
+                                                         key_path, object_schema->name, name));
+            }
+
+            auto table = ObjectStore::table_for_object_type(group, object_schema->name);
+            columns.emplace_back(table->get_index_in_group(), prop->table_column);
+
+            if (end == key_path.size())
+                break;
+            if (prop->type != PropertyType::Object && prop->type != PropertyType::Array) {
+                throw std::invalid_argument(util::format("Invalid key path '%1': property '%2.%3' is not a link.",
+                                                         key_path, object_schema->name, name));
+            }
+            object_schema = schema.find(prop->object_type);
+            start = end + 1;
+        }
+    }
+
+    std::sort(columns.begin(), columns.end());
+    columns.erase(std::unique(columns.begin(), columns.end()), columns.end());
+    return columns;
+}
+
+std::vector<CollectionNotifier::KeyPathFilter*> CollectionNotifier::key_path_filters()
+{
+    std::lock_guard<std::mutex> lock(m_callback_mutex);
+    std::vector<KeyPathFilter*> filters;
+    filters.reserve(m_key_path_filters.size());
+    for (auto& filter : m_key_path_filters)
+        filters.push_back(filter.get());
+    return filters;
+}
+
+size_t CollectionNotifier::add_callback(SharedCollectionChangeCallback callback, KeyPathArray key_paths)
 {
     m_realm->verify_thread();
 
+    // Resolve the key paths before taking the lock so that invalid ones throw
+    // without modifying anything
+    ColumnFilter columns;
+    if (!key_paths.empty()) {
+        std::sort(key_paths.begin(), key_paths.end());
+        key_paths.erase(std::unique(key_paths.begin(), key_paths.end()), key_paths.end());
+        columns = resolve_key_paths(key_paths);
+    }
+
     auto next_token = [=] {
         size_t token = 0;
         for (auto& callback : m_callbacks) {
@@ -180,8 +403,23 @@ size_t CollectionNotifier::add_callback(CollectionChangeCallback callback)
     };
 
     std::lock_guard<std::mutex> lock(m_callback_mutex);
+    size_t filter = npos;
+    if (!key_paths.empty()) {
+        auto it = find_if(begin(m_key_path_filters), end(m_key_path_filters),
+                          [&](auto const& f) { return f->key_paths == key_paths; });
+        if (it == end(m_key_path_filters)) {
+            m_key_path_filters.push_back(std::make_unique<KeyPathFilter>());
+            auto& f = *m_key_path_filters.back();
+            f.key_paths = std::move(key_paths);
+            f.columns = std::move(columns);
+            f.changes_to_deliver = std::make_shared<CollectionChangeSet>();
+            it = m_key_path_filters.end() - 1;
+        }
+        filter = distance(begin(m_key_path_filters), it);
+    }
+
     auto token = next_token();
-    m_callbacks.push_back({std::move(callback), token, false});
+    m_callbacks.push_back({std::move(callback), token, false, filter});
     if (m_callback_index == npos) { // Don't need to wake up if we're already sending notifications
         Realm::Internal::get_coordinator(*m_realm).send_commit_notifications();
         m_have_callbacks = true;
@@ -228,6 +466,12 @@ bool CollectionNotifier::is_alive() const noexcept
     return m_realm != nullptr;
 }
 
+Realm* CollectionNotifier::get_target_realm() const noexcept
+{
+    std::lock_guard<std::mutex> lock(m_realm_mutex);
+    return m_realm.get();
+}
+
 std::unique_lock<std::mutex> CollectionNotifier::lock_target()
 {
     return std::unique_lock<std::mutex>{m_realm_mutex};
@@ -253,6 +497,31 @@ void CollectionNotifier::add_required_change_info(TransactionChangeInfo& info)
     for (auto& tbl : m_related_tables) {
         info.table_modifications_needed[tbl.table_ndx] = true;
     }
+
+    bool has_filters;
+    {
+        std::lock_guard<std::mutex> lock(m_callback_mutex);
+        has_filters = !m_key_path_filters.empty();
+    }
+    if (has_filters) {
+        if (max->table_ndx >= info.table_columns_needed.size())
+            info.table_columns_needed.resize(max->table_ndx + 1, false);
+        for (auto& tbl : m_related_tables)
+            info.table_columns_needed[tbl.table_ndx] = true;
+    }
+}
+
+void CollectionNotifier::add_changes(CollectionChangeBuilder change)
+{
+    for (auto filter : key_path_filters()) {
+        // Insertions, deletions and moves don't depend on which properties
+        // are observed, so only the modifications differ between filters
+        auto filtered = change;
+        filtered.modifications = std::move(filter->modifications);
+        filter->modifications = {};
+        filter->accumulated_changes.merge(std::move(filtered));
+    }
+    m_accumulated_changes.merge(std::move(change));
 }
 
 void CollectionNotifier::prepare_handover()
@@ -273,6 +542,10 @@ bool CollectionNotifier::deliver(Realm& realm, SharedGroup& sg, std::exception_p
 
     if (err) {
         m_error = err;
+        if (!m_changes_to_deliver)
+            m_changes_to_deliver = std::make_shared<CollectionChangeSet>();
+        for (auto filter : key_path_filters())
+            filter->changes_to_deliver = m_changes_to_deliver;
         return have_callbacks();
     }
 
@@ -285,22 +558,39 @@ bool CollectionNotifier::deliver(Realm& realm, SharedGroup& sg, std::exception_p
         return false;
     }
 
-    bool should_call_callbacks = do_deliver(sg);
-    m_changes_to_deliver = std::move(m_accumulated_changes);
+    // Leave the changes to be merged with later ones if there's nothing to
+    // deliver yet
+    if (!do_deliver(sg))
+        return false;
+
+    auto finalize = [](CollectionChangeBuilder& accumulated) {
+        auto changes = std::make_shared<CollectionChangeSet>(std::move(accumulated));
+        accumulated = {};
+
+        // fixup modifications to be source rows rather than dest rows
+        // FIXME: the actual change calculations should be updated to just calculate
+        // the correct thing instead
+        changes->modifications.erase_at(changes->insertions);
+        changes->modifications.shift_for_insert_at(changes->deletions);
+        return changes;
+    };
 
-    // fixup modifications to be source rows rather than dest rows
-    // FIXME: the actual change calculations should be updated to just calculate
-    // the correct thing instead
-    m_changes_to_deliver.modifications.erase_at(m_changes_to_deliver.insertions);
-    m_changes_to_deliver.modifications.shift_for_insert_at(m_changes_to_deliver.deletions);
+    // The changeset is shared between all of the callbacks rather than copied
+    // for each, and likewise for each key path filter
+    m_changes_to_deliver = finalize(m_accumulated_changes);
+    for (auto filter : key_path_filters())
+        filter->changes_to_deliver = finalize(filter->accumulated_changes);
 
-    return should_call_callbacks && have_callbacks();
+    return have_callbacks();
 }
 
 void CollectionNotifier::call_callbacks()
 {
-    while (auto fn = next_callback()) {
-        fn(m_changes_to_deliver, m_error);
+    while (true) {
+        auto next = next_callback();
+        if (!next.first)
+            break;
+        next.first(std::move(next.second), m_error);
     }
 
     if (m_error) {
@@ -311,21 +601,24 @@ void CollectionNotifier::call_callbacks()
     }
 }
 
-CollectionChangeCallback CollectionNotifier::next_callback()
+std::pair<SharedCollectionChangeCallback, std::shared_ptr<const CollectionChangeSet>>
+CollectionNotifier::next_callback()
 {
     std::lock_guard<std::mutex> callback_lock(m_callback_mutex);
 
     for (++m_callback_index; m_callback_index < m_callbacks.size(); ++m_callback_index) {
         auto& callback = m_callbacks[m_callback_index];
-        if (!m_error && callback.initial_delivered && m_changes_to_deliver.empty()) {
+        auto& changes = callback.filter == npos ? m_changes_to_deliver
+                                                : m_key_path_filters[callback.filter]->changes_to_deliver;
+        if (!m_error && callback.initial_delivered && changes->empty()) {
             continue;
         }
         callback.initial_delivered = true;
-        return callback.fn;
+        return {callback.fn, changes};
     }
 
     m_callback_index = npos;
-    return nullptr;
+    return {nullptr, nullptr};
 }
 
 void CollectionNotifier::attach_to(SharedGroup& sg)
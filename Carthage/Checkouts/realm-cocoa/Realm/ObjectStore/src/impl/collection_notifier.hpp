@@ -20,6 +20,7 @@
 #define REALM_BACKGROUND_COLLECTION_HPP
 
 #include "impl/collection_change_builder.hpp"
+#include "util/flat_index_map.hpp"
 
 #include <realm/group_shared.hpp>
 
@@ -27,6 +28,7 @@
 #include <atomic>
 #include <exception>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
 
@@ -41,12 +43,11 @@ struct ListChangeInfo {
     CollectionChangeBuilder* changes;
 };
 
-struct TransactionChangeInfo {
-    std::vector<bool> table_modifications_needed;
-    std::vector<bool> table_moves_needed;
-    std::vector<ListChangeInfo> lists;
-    std::vector<CollectionChangeBuilder> tables;
-};
+struct TransactionChangeInfo;
+
+// The columns which a key path filtered callback is interested in, as
+// (table index, column index) pairs sorted by table and then column
+using ColumnFilter = std::vector<std::pair<size_t, size_t>>;
 
 class DeepChangeChecker {
 public:
@@ -59,8 +60,11 @@ public:
         std::vector<OutgoingLink> links;
     };
 
+    // If `filter` is non-null, only modifications to the columns in it are
+    // considered, and only links in it are followed
     DeepChangeChecker(TransactionChangeInfo const& info, Table const& root_table,
-                      std::vector<RelatedTable> const& related_tables);
+                      std::vector<RelatedTable> const& related_tables,
+                      ColumnFilter const* filter = nullptr);
 
     bool operator()(size_t row_ndx);
 
@@ -75,6 +79,7 @@ private:
     IndexSet const* const m_root_modifications;
     std::vector<IndexSet> m_not_modified;
     std::vector<RelatedTable> const& m_related_tables;
+    ColumnFilter const* m_filter;
 
     struct Path {
         size_t table;
@@ -84,11 +89,59 @@ private:
     };
     std::array<Path, 16> m_current_path;
 
+    bool row_modified(size_t table_ndx, size_t row_ndx) const;
     bool check_row(Table const& table, size_t row_ndx, size_t depth = 0);
     bool check_outgoing_links(size_t table_ndx, Table const& table,
                               size_t row_ndx, size_t depth = 0);
 };
 
+// The rows of each table which were either modified or link to a modified row,
+// directly or through any number of other rows. This is calculated by walking
+// backlinks outwards from the modified rows, so each table only has to be
+// processed once per transaction no matter how many notifiers observe it,
+// rather than walking forward links for every row of every collection.
+class DirtyRowClosure {
+public:
+    // Get a function which reports if a row of `root_table` is dirty,
+    // calculating the dirty rows for any of `related_tables` which no previous
+    // caller needed. The tables calculated for one notifier are shared with
+    // later ones, which may be running on other worker threads.
+    std::function<bool (size_t)> get_checker(TransactionChangeInfo const& info, Table const& root_table,
+                                             std::vector<DeepChangeChecker::RelatedTable> const& related_tables);
+
+    // Discard the calculated rows so that this can be reused for another
+    // transaction. Must not be called concurrently with get_checker().
+    void clear() { m_rows.clear(); }
+
+private:
+    std::mutex m_mutex;
+    // Indexed by table, and null for tables which haven't been calculated yet.
+    // Each table's rows never change once calculated, as they only depend on
+    // the tables which it links to, which must have been calculated at the
+    // same time or earlier. The maps are used as sets of row indices, so that
+    // the cost is proportional to the number of dirty rows rather than to the
+    // size of the tables; the values are unused.
+    std::vector<std::unique_ptr<util::FlatIndexMap>> m_rows;
+
+    void calculate(TransactionChangeInfo const& info, Table const& root_table,
+                   std::vector<DeepChangeChecker::RelatedTable> const& related_tables);
+};
+
+struct TransactionChangeInfo {
+    std::vector<bool> table_modifications_needed;
+    std::vector<bool> table_moves_needed;
+    std::vector<ListChangeInfo> lists;
+    std::vector<CollectionChangeBuilder> tables;
+    // Tables for which the modified rows of each column are tracked in
+    // `columns` in addition to the modified rows in `tables`. Only meaningful
+    // for tables which also have table_modifications_needed set.
+    std::vector<bool> table_columns_needed;
+    // The modified rows of each column, indexed by table and then column
+    std::vector<std::vector<IndexSet>> columns;
+    // Filled in on demand once `tables` is complete
+    std::unique_ptr<DirtyRowClosure> dirty_rows = std::make_unique<DirtyRowClosure>();
+};
+
 // A base class for a notifier that keeps a collection up to date and/or
 // generates detailed change notifications on a background thread. This manages
 // most of the lifetime-management issues related to sharing an object between
@@ -108,8 +161,12 @@ public:
 
     // Add a callback to be called each time the collection changes
     // This can only be called from the target collection's thread
+    // If `key_paths` is non-empty, modifications are only reported for rows
+    // where a property on one of the key paths changed, and the callback is
+    // not called for changesets which are empty after that filtering
     // Returns a token which can be passed to remove_callback()
-    size_t add_callback(CollectionChangeCallback callback);
+    size_t add_callback(CollectionChangeCallback callback, KeyPathArray key_paths = {});
+    size_t add_callback(SharedCollectionChangeCallback callback, KeyPathArray key_paths = {});
     // Remove a previously added token. The token is no longer valid after
     // calling this function and must not be used again. This function can be
     // called from any thread.
@@ -135,6 +192,9 @@ public:
     void call_callbacks();
 
     bool is_alive() const noexcept;
+    // The Realm which this notifier delivers to, or nullptr if it has been
+    // unregistered. Unlike get_realm(), can be called from any thread.
+    Realm* get_target_realm() const noexcept;
 
     // Attach the handed-over query to `sg`. Must not be already attached to a SharedGroup.
     void attach_to(SharedGroup& sg);
@@ -150,17 +210,39 @@ public:
     void prepare_handover();
     bool deliver(Realm&, SharedGroup&, std::exception_ptr);
 
+    // Check if deliver() asked for the notifiers to be run again, clearing
+    // the request. The coordinator checks this after releasing its locks.
+    bool take_run_request() noexcept { return m_run_requested.exchange(false); }
+
     template <typename T>
     class Handle;
 
 protected:
     bool have_callbacks() const noexcept { return m_have_callbacks; }
-    void add_changes(CollectionChangeBuilder change) { m_accumulated_changes.merge(std::move(change)); }
+    void add_changes(CollectionChangeBuilder change);
     void set_table(Table const& table);
     std::unique_lock<std::mutex> lock_target();
 
+    // Ask for the notifiers to be run again even if there are no new commits.
+    // Can be called from do_deliver().
+    void request_run() noexcept { m_run_requested = true; }
+
+    // The root table and all of the tables reachable from it via links
+    std::vector<DeepChangeChecker::RelatedTable> const& related_tables() const noexcept { return m_related_tables; }
+
     std::function<bool (size_t)> get_modification_checker(TransactionChangeInfo const&, Table const&);
 
+    // Determine which of `modifications`, which are indices into the new
+    // version of the collection, should be reported to the callbacks using
+    // each key path filter. `row_at` maps an index to the row index in
+    // `root_table`, and `direct_modifications` are modifications to the
+    // collection itself rather than to the rows in it, which are reported
+    // regardless of filter.
+    void calculate_filtered_modifications(TransactionChangeInfo const& info, Table const& root_table,
+                                          IndexSet const& modifications,
+                                          std::function<size_t (size_t)> row_at,
+                                          IndexSet const& direct_modifications = {});
+
 private:
     virtual void do_attach_to(SharedGroup&) = 0;
     virtual void do_detach_from(SharedGroup&) = 0;
@@ -176,16 +258,36 @@ private:
 
     std::exception_ptr m_error;
     CollectionChangeBuilder m_accumulated_changes;
-    CollectionChangeSet m_changes_to_deliver;
+    std::shared_ptr<const CollectionChangeSet> m_changes_to_deliver;
 
     std::vector<DeepChangeChecker::RelatedTable> m_related_tables;
 
     struct Callback {
-        CollectionChangeCallback fn;
+        SharedCollectionChangeCallback fn;
         size_t token;
         bool initial_delivered;
+        // Index in m_key_path_filters, or npos if not filtered
+        size_t filter;
     };
 
+    // A distinct set of key paths used by at least one callback, along with
+    // the changes calculated for it. Filters are never removed once added, so
+    // that the worker thread can use them without holding m_callback_mutex.
+    struct KeyPathFilter {
+        KeyPathArray key_paths;
+        ColumnFilter columns;
+        // Written by calculate_filtered_modifications() and consumed by add_changes()
+        IndexSet modifications;
+        // Equivalents of m_accumulated_changes and m_changes_to_deliver
+        CollectionChangeBuilder accumulated_changes;
+        std::shared_ptr<const CollectionChangeSet> changes_to_deliver;
+    };
+    std::vector<std::unique_ptr<KeyPathFilter>> m_key_path_filters;
+
+    // Get the filters which currently exist. Acquires m_callback_mutex.
+    std::vector<KeyPathFilter*> key_path_filters();
+    ColumnFilter resolve_key_paths(KeyPathArray const& key_paths) const;
+
     // Currently registered callbacks and a mutex which must always be held
     // while doing anything with them or m_callback_index
     std::mutex m_callback_mutex;
@@ -197,11 +299,13 @@ private:
     // some extra work.
     std::atomic<bool> m_have_callbacks = {false};
 
+    std::atomic<bool> m_run_requested = {false};
+
     // Iteration variable for looping over callbacks
     // remove_callback() updates this when needed
     size_t m_callback_index = npos;
 
-    CollectionChangeCallback next_callback();
+    std::pair<SharedCollectionChangeCallback, std::shared_ptr<const CollectionChangeSet>> next_callback();
 };
 
 // A smart pointer to a CollectionNotifier that unregisters the notifier when
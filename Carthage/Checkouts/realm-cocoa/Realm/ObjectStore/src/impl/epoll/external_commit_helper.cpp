@@ -0,0 +1,255 @@
+////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2016 Realm Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+////////////////////////////////////////////////////////////////////////////
+
+#include "impl/external_commit_helper.hpp"
+#include "impl/realm_coordinator.hpp"
+
+#include <assert.h>
+#include <condition_variable>
+#include <cstdio>
+#include <errno.h>
+#include <fcntl.h>
+#include <mutex>
+#include <pthread.h>
+#include <sstream>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <typeinfo>
+#include <unistd.h>
+#include <unordered_map>
+
+using namespace realm;
+using namespace realm::_impl;
+
+namespace {
+// Write a byte to a pipe to notify anyone waiting for data on the pipe
+void notify_fd(int fd)
+{
+    while (true) {
+        char c = 0;
+        ssize_t ret = write(fd, &c, 1);
+        if (ret == 1) {
+            break;
+        }
+
+        // If the pipe's buffer is full, we need to read some of the old data in
+        // it to make space. We don't just read in the code waiting for
+        // notifications so that we can notify multiple waiters with a single
+        // write.
+        assert(ret == -1 && errno == EAGAIN);
+        char buff[1024];
+        read(fd, buff, sizeof buff);
+    }
+}
+} // anonymous namespace
+
+namespace realm {
+namespace _impl {
+// The thread which waits for changes to any of the named pipes for the
+// ExternalCommitHelpers in this process and calls on_change() on the
+// corresponding coordinator
+class DaemonThread {
+public:
+    static DaemonThread& shared();
+
+    void add(ExternalCommitHelper& helper);
+    // Stop listening for notifications for the helper, blocking until any
+    // in-progress call to on_change() for it has completed
+    void remove(ExternalCommitHelper& helper);
+
+private:
+    DaemonThread();
+    void listen();
+
+    ExternalCommitHelper::FdHolder m_epfd;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    // The helpers which are currently registered, keyed by their pipe fd
+    std::unordered_map<int, ExternalCommitHelper*> m_helpers;
+    // The helper whose coordinator's on_change() is currently being called
+    ExternalCommitHelper* m_current = nullptr;
+
+    std::thread m_thread;
+};
+} // namespace _impl
+} // namespace realm
+
+DaemonThread& DaemonThread::shared()
+{
+    // Intentionally leaked so that the thread never has to be joined during
+    // static destruction
+    static DaemonThread* daemon_thread = new DaemonThread;
+    return *daemon_thread;
+}
+
+DaemonThread::DaemonThread()
+{
+    m_epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epfd == -1) {
+        throw std::system_error(errno, std::system_category());
+    }
+
+    m_thread = std::thread([=] {
+        try {
+            listen();
+        }
+        catch (std::exception const& e) {
+            fprintf(stderr, "uncaught exception in notifier thread: %s: %s\n", typeid(e).name(), e.what());
+            throw;
+        }
+        catch (...) {
+            fprintf(stderr, "uncaught exception in notifier thread\n");
+            throw;
+        }
+    });
+}
+
+void DaemonThread::add(ExternalCommitHelper& helper)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLET;
+    event.data.fd = helper.m_notify_fd;
+    int ret = epoll_ctl(m_epfd, EPOLL_CTL_ADD, helper.m_notify_fd, &event);
+    if (ret == -1) {
+        throw std::system_error(errno, std::system_category());
+    }
+    m_helpers[helper.m_notify_fd] = &helper;
+}
+
+void DaemonThread::remove(ExternalCommitHelper& helper)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    int ret = epoll_ctl(m_epfd, EPOLL_CTL_DEL, helper.m_notify_fd, nullptr);
+    assert(ret == 0);
+    static_cast<void>(ret);
+    m_helpers.erase(helper.m_notify_fd);
+
+    // The coordinator may be destroyed from within its own on_change(), in
+    // which case there's nothing to wait for
+    if (std::this_thread::get_id() != m_thread.get_id()) {
+        m_cv.wait(lock, [&] { return m_current != &helper; });
+    }
+}
+
+void DaemonThread::listen()
+{
+    // Linux limits thread names to 15 characters
+    int name_ret = pthread_setname_np(pthread_self(), "Realm notifier");
+    assert(name_ret == 0);
+    static_cast<void>(name_ret);
+
+    struct epoll_event events[16];
+    while (true) {
+        int ret = epoll_wait(m_epfd, events, sizeof(events) / sizeof(events[0]), -1);
+
+        if (ret == -1 && errno == EINTR) {
+            // Interrupted system call, try again.
+            continue;
+        }
+        assert(ret >= 0);
+
+        for (int i = 0; i < ret; ++i) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            // The helper may have been removed after epoll_wait() returned
+            auto it = m_helpers.find(events[i].data.fd);
+            if (it == m_helpers.end()) {
+                continue;
+            }
+            auto helper = m_current = it->second;
+            lock.unlock();
+
+            helper->m_parent.on_change();
+
+            lock.lock();
+            m_current = nullptr;
+            m_cv.notify_all();
+        }
+    }
+}
+
+void ExternalCommitHelper::FdHolder::close()
+{
+    if (m_fd != -1) {
+        ::close(m_fd);
+    }
+    m_fd = -1;
+}
+
+ExternalCommitHelper::ExternalCommitHelper(RealmCoordinator& parent)
+: m_parent(parent)
+{
+    auto path = parent.get_path() + ".note";
+
+    // Create and open the named pipe
+    int ret = mkfifo(path.c_str(), 0600);
+    if (ret == -1) {
+        int err = errno;
+        if (err == ENOTSUP) {
+            // Filesystem doesn't support named pipes, so try putting it in tmp instead
+            // Hash collisions are okay here because they just result in doing
+            // extra work, as opposed to correctness problems
+            std::ostringstream ss;
+
+            const char* tmp_dir_env = getenv("TMPDIR");
+            std::string tmp_dir(tmp_dir_env ? tmp_dir_env : "/tmp");
+            ss << tmp_dir;
+            if (tmp_dir.back() != '/')
+              ss << '/';
+            ss << "realm_" << std::hash<std::string>()(path) << ".note";
+            path = ss.str();
+            ret = mkfifo(path.c_str(), 0600);
+            err = errno;
+        }
+        // the fifo already existing isn't an error
+        if (ret == -1 && err != EEXIST) {
+            throw std::system_error(err, std::system_category());
+        }
+    }
+
+    m_notify_fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (m_notify_fd == -1) {
+        throw std::system_error(errno, std::system_category());
+    }
+
+    // Make writing to the pipe return -1 when the pipe's buffer is full
+    // rather than blocking until there's space available
+    ret = fcntl(m_notify_fd, F_SETFL, O_NONBLOCK);
+    if (ret == -1) {
+        throw std::system_error(errno, std::system_category());
+    }
+
+    DaemonThread::shared().add(*this);
+}
+
+ExternalCommitHelper::~ExternalCommitHelper()
+{
+    DaemonThread::shared().remove(*this);
+}
+
+void ExternalCommitHelper::notify_others()
+{
+    notify_fd(m_notify_fd);
+}
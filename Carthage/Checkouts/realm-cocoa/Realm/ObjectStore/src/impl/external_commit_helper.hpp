@@ -25,6 +25,8 @@
 #include "impl/apple/external_commit_helper.hpp"
 #elif REALM_ANDROID || REALM_PLATFORM_NODE
 #include "impl/android/external_commit_helper.hpp"
+#elif defined(__linux__)
+#include "impl/epoll/external_commit_helper.hpp"
 #else
 #include "impl/generic/external_commit_helper.hpp"
 #endif
@@ -95,6 +95,10 @@ void ListNotifier::run()
         return;
     }
 
+    // Modifications made via the list itself rather than to the target rows
+    // are reported to key path filtered callbacks too
+    IndexSet direct_modifications = m_change.modifications;
+
     auto row_did_change = get_modification_checker(*m_info, m_lv->get_target_table());
     for (size_t i = 0; i < m_lv->size(); ++i) {
         if (m_change.modifications.contains(i))
@@ -110,6 +114,10 @@ void ListNotifier::run()
             m_change.modifications.add(move.to);
     }
 
+    calculate_filtered_modifications(*m_info, m_lv->get_target_table(), m_change.modifications,
+                                     [&](size_t ndx) { return m_lv->get(ndx).get_index(); },
+                                     direct_modifications);
+
     m_prev_size = m_lv->size();
 }
 
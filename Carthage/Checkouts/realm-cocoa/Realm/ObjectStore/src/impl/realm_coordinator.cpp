@@ -24,6 +24,7 @@
 #include "impl/weak_realm_notifier.hpp"
 #include "object_schema.hpp"
 #include "object_store.hpp"
+#include "parser/query_builder.hpp"
 #include "schema.hpp"
 
 #include <realm/commit_log.hpp>
@@ -31,12 +32,240 @@
 #include <realm/lang_bind_helper.hpp>
 #include <realm/string_data.hpp>
 
-#include <unordered_map>
 #include <algorithm>
+#include <condition_variable>
+#include <thread>
+#include <unordered_map>
 
 using namespace realm;
 using namespace realm::_impl;
 
+namespace realm {
+namespace _impl {
+// A fixed set of threads used to run the async notifiers for multiple
+// SharedGroups in parallel
+class NotifierThreadPool {
+public:
+    NotifierThreadPool(size_t thread_count)
+    {
+        for (size_t i = 0; i < thread_count; ++i)
+            m_threads.emplace_back([=] { work(i + 1); });
+    }
+
+    ~NotifierThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_shutdown = true;
+        }
+        m_cv.notify_all();
+        for (auto& thread : m_threads)
+            thread.join();
+    }
+
+    // Call fn(i) for each i in [0, count), with fn(0) called on the calling
+    // thread and the rest on the pool's threads. Blocks until all of them
+    // have completed, and then rethrows the first exception thrown by any of them.
+    void run(size_t count, std::function<void (size_t)> fn)
+    {
+        REALM_ASSERT(count > 0 && count <= m_threads.size() + 1);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_fn = std::move(fn);
+            m_count = count;
+            m_remaining = count - 1;
+            m_errors.assign(count, nullptr);
+            ++m_generation;
+        }
+        m_cv.notify_all();
+
+        std::exception_ptr error;
+        try {
+            m_fn(0);
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done_cv.wait(lock, [&] { return m_remaining == 0; });
+        m_errors[0] = error;
+        m_fn = nullptr;
+        for (auto& worker_error : m_errors) {
+            if (worker_error)
+                std::rethrow_exception(worker_error);
+        }
+    }
+
+private:
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::condition_variable m_done_cv;
+
+    std::function<void (size_t)> m_fn;
+    std::vector<std::exception_ptr> m_errors;
+    size_t m_count = 0;
+    size_t m_remaining = 0;
+    uint64_t m_generation = 0;
+    bool m_shutdown = false;
+
+    void work(size_t index)
+    {
+        uint64_t generation = 0;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_cv.wait(lock, [&] { return m_shutdown || m_generation != generation; });
+            if (m_shutdown)
+                return;
+            generation = m_generation;
+            if (index >= m_count)
+                continue;
+
+            lock.unlock();
+            std::exception_ptr error;
+            try {
+                m_fn(index);
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+            lock.lock();
+
+            m_errors[index] = error;
+            if (--m_remaining == 0)
+                m_done_cv.notify_one();
+        }
+    }
+};
+
+// A thread which runs a coordinator's async notifiers at a scheduled time,
+// so that waiting for the coalescing window to pass doesn't block the thread
+// which reported the commit (which for some ExternalCommitHelpers is shared by
+// every coordinator in the process)
+class NotifierScheduler {
+public:
+    NotifierScheduler(std::weak_ptr<RealmCoordinator> coordinator)
+    : m_state(std::make_shared<State>())
+    {
+        // The thread holds its own reference to the state, as it may outlive
+        // the scheduler if the coordinator is destroyed on it
+        auto state = m_state;
+        m_thread = std::thread([state, coordinator] { work(*state, coordinator); });
+    }
+
+    ~NotifierScheduler()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_state->mutex);
+            m_state->shutdown = true;
+        }
+        m_state->cv.notify_one();
+        // The coordinator is destroyed on this thread if the scheduler thread
+        // held the last reference to it, in which case it'll exit on its own
+        if (m_thread.get_id() == std::this_thread::get_id())
+            m_thread.detach();
+        else
+            m_thread.join();
+    }
+
+    // Run the notifiers at the given time, or at the currently scheduled time
+    // if that's sooner
+    void schedule(std::chrono::steady_clock::time_point time)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_state->mutex);
+            if (m_state->scheduled && m_state->time <= time)
+                return;
+            m_state->scheduled = true;
+            m_state->time = time;
+        }
+        m_state->cv.notify_one();
+    }
+
+private:
+    struct State {
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool shutdown = false;
+        bool scheduled = false;
+        std::chrono::steady_clock::time_point time;
+    };
+    std::shared_ptr<State> m_state;
+    std::thread m_thread;
+
+    static void work(State& state, std::weak_ptr<RealmCoordinator> const& weak_coordinator)
+    {
+        std::unique_lock<std::mutex> lock(state.mutex);
+        while (!state.shutdown) {
+            if (!state.scheduled) {
+                state.cv.wait(lock);
+                continue;
+            }
+            if (std::chrono::steady_clock::now() < state.time) {
+                state.cv.wait_until(lock, state.time);
+                continue;
+            }
+
+            state.scheduled = false;
+            lock.unlock();
+            if (auto coordinator = weak_coordinator.lock())
+                coordinator->run_notifiers_and_notify();
+            lock.lock();
+        }
+    }
+};
+
+// A cache of the TransactionChangeInfo objects used to track the changes made
+// by each commit, which are reused between runs of the async notifiers rather
+// than being freed after each run. Released objects are cleared, but their
+// containers keep their capacity, so once the pool has warmed up tracking the
+// changes for a commit mostly doesn't have to allocate.
+class TransactionChangeInfoPool {
+public:
+    std::unique_ptr<TransactionChangeInfo> acquire()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_high_water_mark = std::max(m_high_water_mark, ++m_in_use);
+        if (m_free.empty())
+            return std::make_unique<TransactionChangeInfo>();
+        auto info = std::move(m_free.back());
+        m_free.pop_back();
+        return info;
+    }
+
+    void release(std::unique_ptr<TransactionChangeInfo> info)
+    {
+        info->table_modifications_needed.clear();
+        info->table_moves_needed.clear();
+        info->lists.clear();
+        info->tables.clear();
+        info->table_columns_needed.clear();
+        info->columns.clear();
+        info->dirty_rows->clear();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        --m_in_use;
+        m_free.push_back(std::move(info));
+    }
+
+    // The largest number of objects which have been in use at once, which is
+    // also the number of objects which the pool holds on to
+    size_t high_water_mark() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_high_water_mark;
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<TransactionChangeInfo>> m_free;
+    size_t m_in_use = 0;
+    size_t m_high_water_mark = 0;
+};
+} // namespace _impl
+} // namespace realm
+
 static std::mutex s_coordinator_mutex;
 static std::unordered_map<std::string, std::weak_ptr<RealmCoordinator>> s_coordinators_per_path;
 
@@ -99,6 +328,11 @@ std::shared_ptr<Realm> RealmCoordinator::get_realm(Realm::Config config)
     }
 
     auto realm = Realm::make_shared_realm(std::move(config));
+    {
+        std::lock_guard<std::mutex> scheduler_lock(m_scheduler_mutex);
+        m_weak_this = shared_from_this();
+    }
+
     if (!config.read_only() && !m_notifier && config.automatic_change_notifications) {
         try {
             m_notifier = std::make_unique<ExternalCommitHelper>(*this);
@@ -129,13 +363,19 @@ void RealmCoordinator::update_schema(Schema const& schema, uint64_t schema_versi
         throw MismatchedConfigException("Realm at path '%1' already opened with a different schema version.", m_config.path);
     }
 
+    if (schema_version != m_schema_version || !(schema == m_schema)) {
+        m_predicate_cache->clear();
+    }
     m_schema = schema;
     m_schema_version = schema_version;
 
     // FIXME: notify realms of the schema change
 }
 
-RealmCoordinator::RealmCoordinator() = default;
+RealmCoordinator::RealmCoordinator()
+: m_predicate_cache(std::make_unique<query_builder::PredicateCache>())
+{
+}
 
 RealmCoordinator::~RealmCoordinator()
 {
@@ -265,6 +505,7 @@ void RealmCoordinator::register_notifier(std::shared_ptr<CollectionNotifier> not
 
 void RealmCoordinator::clean_up_dead_notifiers()
 {
+    std::vector<CollectionNotifier*> removed;
     auto swap_remove = [&](auto& container) {
         bool did_remove = false;
         for (size_t i = 0; i < container.size(); ++i) {
@@ -274,6 +515,7 @@ void RealmCoordinator::clean_up_dead_notifiers()
             // Ensure the notifier is destroyed here even if there's lingering refs
             // to the async notifier elsewhere
             container[i]->release_data();
+            removed.push_back(container[i].get());
 
             if (container.size() > i + 1)
                 container[i] = std::move(container.back());
@@ -285,12 +527,21 @@ void RealmCoordinator::clean_up_dead_notifiers()
     };
 
     if (swap_remove(m_notifiers)) {
-        // Make sure we aren't holding on to read versions needlessly if there
-        // are no notifiers left, but don't close them entirely as opening shared
-        // groups is expensive
-        if (m_notifiers.empty() && m_notifier_sg) {
-            REALM_ASSERT_3(m_notifier_sg->get_transact_stage(), ==, SharedGroup::transact_Reading);
-            m_notifier_sg->end_read();
+        for (auto& worker : m_notifier_workers) {
+            auto it = remove_if(begin(worker.notifiers), end(worker.notifiers), [&](auto const& notifier) {
+                return find(begin(removed), end(removed), notifier.get()) != end(removed);
+            });
+            if (it == end(worker.notifiers))
+                continue;
+            worker.notifiers.erase(it, end(worker.notifiers));
+
+            // Make sure we aren't holding on to read versions needlessly if there
+            // are no notifiers left, but don't close them entirely as opening shared
+            // groups is expensive
+            if (worker.notifiers.empty() && worker.sg) {
+                REALM_ASSERT_3(worker.sg->get_transact_stage(), ==, SharedGroup::transact_Reading);
+                worker.sg->end_read();
+            }
         }
     }
     if (swap_remove(m_new_notifiers)) {
@@ -299,12 +550,80 @@ void RealmCoordinator::clean_up_dead_notifiers()
             m_advancer_sg->end_read();
         }
     }
+
+    update_notifiers_by_realm();
+}
+
+void RealmCoordinator::update_notifiers_by_realm()
+{
+    m_notifiers_by_realm.clear();
+    for (auto& notifier : m_notifiers) {
+        if (auto realm = notifier->get_target_realm())
+            m_notifiers_by_realm[realm].push_back(notifier);
+    }
 }
 
 void RealmCoordinator::on_change()
 {
+    using namespace std::chrono;
+
+    if (!m_config.notification_min_interval.count() && m_config.notification_run_cost_factor <= 0) {
+        run_notifiers_and_notify();
+        return;
+    }
+
+    // Run the notifiers once the coalescing window has passed, so that
+    // further commits in the meantime are picked up by the same run. The
+    // notifiers always advance to the latest version, so the changes from
+    // every skipped version are merged into their changesets.
+    auto now = steady_clock::now();
+    steady_clock::time_point wake;
+    {
+        std::lock_guard<std::mutex> lock(m_scheduler_mutex);
+        wake = std::min(m_last_notifier_run + m_notifier_run_interval,
+                        now + duration_cast<steady_clock::duration>(m_config.notification_max_latency));
+    }
+    schedule_notifier_run(std::max(wake, now));
+}
+
+void RealmCoordinator::wake_notifier_thread()
+{
+    schedule_notifier_run(std::chrono::steady_clock::now());
+}
+
+void RealmCoordinator::schedule_notifier_run(std::chrono::steady_clock::time_point time)
+{
+    std::lock_guard<std::mutex> lock(m_scheduler_mutex);
+    if (!m_notifier_scheduler) {
+        // There's nothing to run the notifiers for if no Realm was ever opened
+        // or the coordinator is being destroyed
+        if (m_weak_this.expired())
+            return;
+        m_notifier_scheduler = std::make_unique<NotifierScheduler>(m_weak_this);
+    }
+    m_notifier_scheduler->schedule(time);
+}
+
+void RealmCoordinator::run_notifiers_and_notify()
+{
+    using namespace std::chrono;
+
+    std::lock_guard<std::mutex> run_lock(m_run_mutex);
+    auto start = steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(m_scheduler_mutex);
+        m_last_notifier_run = start;
+    }
+
     run_async_notifiers();
 
+    auto cost = duration_cast<steady_clock::duration>((steady_clock::now() - start)
+                                                      * m_config.notification_run_cost_factor);
+    {
+        std::lock_guard<std::mutex> lock(m_scheduler_mutex);
+        m_notifier_run_interval = std::max<steady_clock::duration>(m_config.notification_min_interval, cost);
+    }
+
     std::lock_guard<std::mutex> lock(m_realm_mutex);
     for (auto& realm : m_weak_realm_notifiers) {
         realm.notify();
@@ -314,10 +633,11 @@ void RealmCoordinator::on_change()
 namespace {
 class IncrementalChangeInfo {
 public:
-    IncrementalChangeInfo(SharedGroup& sg,
+    IncrementalChangeInfo(TransactionChangeInfoPool& pool,
+                          SharedGroup& sg,
                           SchemaMode schema_mode,
                           std::vector<std::shared_ptr<_impl::CollectionNotifier>>& notifiers)
-    : m_sg(sg), m_schema_mode(schema_mode)
+    : m_pool(pool), m_sg(sg), m_schema_mode(schema_mode)
     {
         if (notifiers.empty())
             return;
@@ -330,16 +650,14 @@ public:
         // all forward to the latest version in a single pass over the transaction log
         std::sort(notifiers.begin(), notifiers.end(), cmp);
 
-        // Preallocate the required amount of space in the vector so that we can
-        // safely give out pointers to within the vector
-        size_t count = 1;
-        for (auto it = notifiers.begin(), next = it + 1; next != notifiers.end(); ++it, ++next) {
-            if (cmp(*it, *next))
-                ++count;
-        }
-        m_info.reserve(count);
-        m_info.resize(1);
-        m_current = &m_info[0];
+        m_info.push_back(m_pool.acquire());
+        m_current = m_info.back().get();
+    }
+
+    ~IncrementalChangeInfo()
+    {
+        for (auto& info : m_info)
+            m_pool.release(std::move(info));
     }
 
     TransactionChangeInfo& current() const { return *m_current; }
@@ -348,11 +666,14 @@ public:
     {
         if (version != m_sg.get_version_of_current_transaction()) {
             transaction::advance(m_sg, *m_current, version);
-            m_info.push_back({
-                m_current->table_modifications_needed,
-                m_current->table_moves_needed,
-                std::move(m_current->lists)});
-            m_current = &m_info.back();
+            auto next = m_pool.acquire();
+            next->table_modifications_needed = m_current->table_modifications_needed;
+            next->table_moves_needed = m_current->table_moves_needed;
+            next->table_columns_needed = m_current->table_columns_needed;
+            // Swap rather than move so that the pooled info's capacity is kept
+            next->lists.swap(m_current->lists);
+            m_info.push_back(std::move(next));
+            m_current = m_info.back().get();
             return true;
         }
         return false;
@@ -371,15 +692,24 @@ public:
         // the notifiers see the complete set of changes from their first version to
         // the most recent one
         for (size_t i = m_info.size() - 1; i > 0; --i) {
-            auto& cur = m_info[i];
+            auto& cur = *m_info[i];
             if (cur.tables.empty())
                 continue;
-            auto& prev = m_info[i - 1];
+            auto& prev = *m_info[i - 1];
             if (prev.tables.empty()) {
                 prev.tables = cur.tables;
+                prev.table_columns_needed = cur.table_columns_needed;
+                prev.columns = cur.columns;
                 continue;
             }
 
+            // The per-column modifications can't be merged without also
+            // tracking how each column's rows moved, so the notifiers for the
+            // earlier version fall back to treating every modified row as
+            // having had all of its columns modified
+            prev.table_columns_needed.clear();
+            prev.columns.clear();
+
             for (size_t j = 0; j < prev.tables.size() && j < cur.tables.size(); ++j) {
                 prev.tables[j].merge(CollectionChangeBuilder{cur.tables[j]});
             }
@@ -401,7 +731,8 @@ public:
     }
 
 private:
-    std::vector<TransactionChangeInfo> m_info;
+    TransactionChangeInfoPool& m_pool;
+    std::vector<std::unique_ptr<TransactionChangeInfo>> m_info;
     TransactionChangeInfo* m_current = nullptr;
     SharedGroup& m_sg;
     SchemaMode m_schema_mode;
@@ -418,21 +749,57 @@ void RealmCoordinator::run_async_notifiers()
         return;
     }
 
+    // Assign each new notifier to the worker with the fewest notifiers. They
+    // then stay attached to that worker's SharedGroup until they're removed.
+    size_t worker_count = std::max<size_t>(m_config.async_notifier_thread_count, 1);
+    if (m_notifier_workers.size() < worker_count)
+        m_notifier_workers.resize(worker_count);
+    worker_count = m_notifier_workers.size();
+
+    auto new_notifiers = std::move(m_new_notifiers);
+    std::vector<std::vector<std::shared_ptr<CollectionNotifier>>> new_worker_notifiers(worker_count);
+    for (auto& notifier : new_notifiers) {
+        auto notifier_count = [&](size_t i) {
+            return m_notifier_workers[i].notifiers.size() + new_worker_notifiers[i].size();
+        };
+        size_t worker = 0;
+        for (size_t i = 1; i < worker_count; ++i) {
+            if (notifier_count(i) < notifier_count(worker))
+                worker = i;
+        }
+        new_worker_notifiers[worker].push_back(notifier);
+    }
+
+    std::vector<size_t> active_workers;
+    for (size_t i = 0; i < worker_count; ++i) {
+        if (!m_notifier_workers[i].notifiers.empty() || !new_worker_notifiers[i].empty())
+            active_workers.push_back(i);
+    }
+
     if (!m_async_error) {
-        open_helper_shared_group();
+        for (size_t i : active_workers)
+            open_helper_shared_group(m_notifier_workers[i]);
     }
 
     if (m_async_error) {
-        std::move(m_new_notifiers.begin(), m_new_notifiers.end(), std::back_inserter(m_notifiers));
-        m_new_notifiers.clear();
+        // Release the read transactions on any of the workers which were
+        // opened for the new notifiers
+        for (auto& worker : m_notifier_workers) {
+            if (worker.sg && worker.notifiers.empty() && worker.sg->get_transact_stage() == SharedGroup::transact_Reading)
+                worker.sg->end_read();
+        }
+        std::move(new_notifiers.begin(), new_notifiers.end(), std::back_inserter(m_notifiers));
+        update_notifiers_by_realm();
         return;
     }
 
     SharedGroup::VersionID version;
 
     // Advance all of the new notifiers to the most recent version, if any
-    auto new_notifiers = std::move(m_new_notifiers);
-    IncrementalChangeInfo new_notifier_change_info(*m_advancer_sg, m_config.schema_mode, new_notifiers);
+    if (!m_change_info_pool)
+        m_change_info_pool = std::make_unique<TransactionChangeInfoPool>();
+    IncrementalChangeInfo new_notifier_change_info(*m_change_info_pool, *m_advancer_sg,
+                                                   m_config.schema_mode, new_notifiers);
 
     if (!new_notifiers.empty()) {
         REALM_ASSERT_3(m_advancer_sg->get_transact_stage(), ==, SharedGroup::transact_Reading);
@@ -464,61 +831,135 @@ void RealmCoordinator::run_async_notifiers()
         version = m_advancer_sg->get_version_of_current_transaction();
         m_advancer_sg->end_read();
     }
+    else if (active_workers.size() > 1) {
+        // Each of the workers has to be advanced to the same version, so pick
+        // the latest one up front rather than letting each pick their own
+        REALM_ASSERT(m_advancer_sg);
+        m_advancer_sg->begin_read();
+        version = m_advancer_sg->get_version_of_current_transaction();
+        m_advancer_sg->end_read();
+    }
     REALM_ASSERT_3(m_advancer_sg->get_transact_stage(), ==, SharedGroup::transact_Ready);
 
-    // Make a copy of the notifiers vector and then release the lock to avoid
+    // Make a copy of the notifiers vectors and then release the lock to avoid
     // blocking other threads trying to register or unregister notifiers while we run them
     auto notifiers = m_notifiers;
+    std::vector<std::vector<std::shared_ptr<CollectionNotifier>>> worker_notifiers(worker_count);
+    for (size_t i : active_workers)
+        worker_notifiers[i] = m_notifier_workers[i].notifiers;
     lock.unlock();
 
-    // Advance the non-new notifiers to the same version as we advanced the new
-    // ones to (or the latest if there were no new ones)
-    IncrementalChangeInfo change_info(*m_notifier_sg, m_config.schema_mode, notifiers);
-    for (auto& notifier : notifiers) {
-        notifier->add_required_change_info(change_info.current());
+    // Tracking the changes while advancing to the new version is much more
+    // expensive than just advancing, so when there are multiple workers whose
+    // existing notifiers are all at the same version, track the changes for
+    // all of them while advancing one worker and share the result
+    size_t tracking_worker = npos;
+    bool share_change_info = active_workers.size() > 1;
+    for (size_t i : active_workers) {
+        if (worker_notifiers[i].empty())
+            continue;
+        if (tracking_worker == npos)
+            tracking_worker = i;
+        else if (m_notifier_workers[i].sg->get_version_of_current_transaction()
+                 != m_notifier_workers[tracking_worker].sg->get_version_of_current_transaction())
+            share_change_info = false;
     }
-    change_info.advance_to_final(version);
 
-    // Attach the new notifiers to the main SG and move them to the main list
-    for (auto& notifier : new_notifiers) {
-        notifier->attach_to(*m_notifier_sg);
+    std::vector<std::shared_ptr<CollectionNotifier>> shared_notifiers;
+    std::unique_ptr<IncrementalChangeInfo> shared_change_info;
+    if (share_change_info && tracking_worker != npos) {
+        for (size_t i : active_workers)
+            shared_notifiers.insert(shared_notifiers.end(), worker_notifiers[i].begin(), worker_notifiers[i].end());
+        shared_change_info = std::make_unique<IncrementalChangeInfo>(*m_change_info_pool,
+                                                                     *m_notifier_workers[tracking_worker].sg,
+                                                                     m_config.schema_mode, shared_notifiers);
+        for (auto& notifier : shared_notifiers) {
+            notifier->add_required_change_info(shared_change_info->current());
+        }
+        shared_change_info->advance_to_final(version);
     }
-    std::move(new_notifiers.begin(), new_notifiers.end(), std::back_inserter(notifiers));
 
-    // Change info is now all ready, so the notifiers can now perform their
-    // background work
-    for (auto& notifier : notifiers) {
-        notifier->run();
+    auto run_worker = [&](size_t i) {
+        auto& sg = *m_notifier_workers[i].sg;
+
+        // Advance the non-new notifiers to the same version as we advanced the new
+        // ones to (or the latest if there were no new ones). The change info
+        // has to outlive the calls to run() below, as the notifiers hold
+        // pointers into it.
+        std::unique_ptr<IncrementalChangeInfo> change_info;
+        if (shared_change_info) {
+            if (i != tracking_worker)
+                transaction::advance(sg, nullptr, m_config.schema_mode, version);
+        }
+        else {
+            change_info = std::make_unique<IncrementalChangeInfo>(*m_change_info_pool, sg,
+                                                                  m_config.schema_mode, worker_notifiers[i]);
+            for (auto& notifier : worker_notifiers[i]) {
+                notifier->add_required_change_info(change_info->current());
+            }
+            change_info->advance_to_final(version);
+        }
+
+        // Attach the new notifiers to the worker's SG
+        for (auto& notifier : new_worker_notifiers[i]) {
+            notifier->attach_to(sg);
+        }
+
+        // Change info is now all ready, so the notifiers can now perform their
+        // background work
+        for (auto& notifier : worker_notifiers[i]) {
+            notifier->run();
+        }
+        for (auto& notifier : new_worker_notifiers[i]) {
+            notifier->run();
+        }
+    };
+
+    if (active_workers.size() == 1) {
+        run_worker(active_workers.front());
+    }
+    else {
+        if (!m_notifier_thread_pool)
+            m_notifier_thread_pool = std::make_unique<NotifierThreadPool>(worker_count - 1);
+        m_notifier_thread_pool->run(active_workers.size(), [&](size_t i) {
+            run_worker(active_workers[i]);
+        });
     }
 
     // Reacquire the lock while updating the fields that are actually read on
-    // other threads
+    // other threads. The handover is always prepared in the same order
+    // regardless of which workers the notifiers ran on.
+    std::move(new_notifiers.begin(), new_notifiers.end(), std::back_inserter(notifiers));
     lock.lock();
     for (auto& notifier : notifiers) {
         notifier->prepare_handover();
     }
+    for (size_t i : active_workers) {
+        auto& worker = m_notifier_workers[i].notifiers;
+        std::move(new_worker_notifiers[i].begin(), new_worker_notifiers[i].end(), std::back_inserter(worker));
+    }
     m_notifiers = std::move(notifiers);
     clean_up_dead_notifiers();
 }
 
-void RealmCoordinator::open_helper_shared_group()
+void RealmCoordinator::open_helper_shared_group(NotifierWorker& worker)
 {
-    if (!m_notifier_sg) {
+    if (!worker.sg) {
         try {
             std::unique_ptr<Group> read_only_group;
-            Realm::open_with_config(m_config, m_notifier_history, m_notifier_sg, read_only_group, nullptr);
+            Realm::open_with_config(m_config, worker.history, worker.sg, read_only_group, nullptr);
             REALM_ASSERT(!read_only_group);
-            m_notifier_sg->begin_read();
+            worker.sg->begin_read();
         }
         catch (...) {
             // Store the error to be passed to the async notifiers
             m_async_error = std::current_exception();
-            m_notifier_sg = nullptr;
-            m_notifier_history = nullptr;
+            worker.sg = nullptr;
+            worker.history = nullptr;
         }
     }
-    else if (m_notifiers.empty()) {
-        m_notifier_sg->begin_read();
+    else if (worker.notifiers.empty()) {
+        worker.sg->begin_read();
     }
 }
 
@@ -527,7 +968,10 @@ void RealmCoordinator::advance_to_ready(Realm& realm)
     decltype(m_notifiers) notifiers;
 
     auto& sg = Realm::Internal::get_shared_group(realm);
+    bool wake_requested = false;
 
+    // All of the notifiers which have run are at the same version, so this
+    // normally stops at the first one
     auto get_notifier_version = [&] {
         for (auto& notifier : m_notifiers) {
             auto version = notifier->version();
@@ -570,15 +1014,22 @@ void RealmCoordinator::advance_to_ready(Realm& realm)
         if (version != sg.get_version_of_current_transaction())
             continue;
 
-        // Query version now matches the SG version, so we can deliver them
-        for (auto& notifier : m_notifiers) {
+        // Query version now matches the SG version, so we can deliver them.
+        // Only this Realm's notifiers can accept the delivery.
+        auto it = m_notifiers_by_realm.find(&realm);
+        if (it == m_notifiers_by_realm.end())
+            break;
+        for (auto& notifier : it->second) {
             if (notifier->deliver(realm, sg, m_async_error)) {
                 notifiers.push_back(notifier);
             }
+            wake_requested |= notifier->take_run_request();
         }
         break;
     }
 
+    if (wake_requested)
+        wake_notifier_thread();
     for (auto& notifier : notifiers) {
         notifier->call_callbacks();
     }
@@ -588,16 +1039,29 @@ void RealmCoordinator::process_available_async(Realm& realm)
 {
     auto& sg = Realm::Internal::get_shared_group(realm);
     decltype(m_notifiers) notifiers;
+    bool wake_requested = false;
     {
         std::lock_guard<std::mutex> lock(m_notifier_mutex);
-        for (auto& notifier : m_notifiers) {
+        auto it = m_notifiers_by_realm.find(&realm);
+        if (it == m_notifiers_by_realm.end())
+            return;
+        for (auto& notifier : it->second) {
             if (notifier->deliver(realm, sg, m_async_error)) {
                 notifiers.push_back(notifier);
             }
+            wake_requested |= notifier->take_run_request();
         }
     }
 
+    if (wake_requested)
+        wake_notifier_thread();
     for (auto& notifier : notifiers) {
         notifier->call_callbacks();
     }
 }
+
+size_t RealmCoordinator::change_info_high_water_mark() const
+{
+    std::lock_guard<std::mutex> lock(m_notifier_mutex);
+    return m_change_info_pool ? m_change_info_pool->high_water_mark() : 0;
+}
@@ -21,7 +21,9 @@
 
 #include "shared_realm.hpp"
 
+#include <chrono>
 #include <mutex>
+#include <unordered_map>
 
 namespace realm {
 class Replication;
@@ -29,9 +31,16 @@ class Schema;
 class SharedGroup;
 class StringData;
 
+namespace query_builder {
+class PredicateCache;
+}
+
 namespace _impl {
 class CollectionNotifier;
 class ExternalCommitHelper;
+class NotifierScheduler;
+class NotifierThreadPool;
+class TransactionChangeInfoPool;
 class WeakRealmNotifier;
 
 // RealmCoordinator manages the weak cache of Realm instances and communication
@@ -61,6 +70,11 @@ public:
     // path, including those in other processes
     void send_commit_notifications();
 
+    // Run the async notifiers on the coordinator's scheduler thread as soon as
+    // possible, without waiting for a new commit. Unlike
+    // send_commit_notifications() this only affects this process.
+    void wake_notifier_thread();
+
     // Clear the weak Realm cache for all paths
     // Should only be called in test code, as continuing to use the previously
     // cached instances will have odd results
@@ -77,7 +91,9 @@ public:
     // Do not call directly
     void unregister_realm(Realm* realm);
 
-    // Called by m_notifier when there's a new commit to send notifications for
+    // Called by m_notifier when there's a new commit to send notifications for.
+    // If commits are being coalesced this only schedules the run of the async
+    // notifiers on the coordinator's scheduler thread and returns immediately.
     void on_change();
 
     // Update the cached schema
@@ -90,6 +106,16 @@ public:
     void advance_to_ready(Realm& realm);
     void process_available_async(Realm& realm);
 
+    // The largest number of sets of per-transaction change information which
+    // the async notifiers have needed at once. This many are kept allocated
+    // for reuse between runs of the notifiers.
+    size_t change_info_high_water_mark() const;
+
+    // Compiled query predicates for this Realm file. The compiled predicates
+    // refer to the file's column indices, so they can't be shared between
+    // files, and the cache is cleared whenever the schema changes.
+    query_builder::PredicateCache& predicate_cache() { return *m_predicate_cache; }
+
 private:
     Realm::Config m_config;
     Schema m_schema;
@@ -98,14 +124,29 @@ private:
     std::mutex m_realm_mutex;
     std::vector<WeakRealmNotifier> m_weak_realm_notifiers;
 
-    std::mutex m_notifier_mutex;
+    mutable std::mutex m_notifier_mutex;
     std::vector<std::shared_ptr<_impl::CollectionNotifier>> m_new_notifiers;
     std::vector<std::shared_ptr<_impl::CollectionNotifier>> m_notifiers;
-
-    // SharedGroup used for actually running async notifiers
-    // Will have a read transaction iff m_notifiers is non-empty
-    std::unique_ptr<Replication> m_notifier_history;
-    std::unique_ptr<SharedGroup> m_notifier_sg;
+    // m_notifiers grouped by the Realm they deliver to, so that refreshing a
+    // Realm only has to look at that Realm's notifiers. Rebuilt by
+    // clean_up_dead_notifiers() each time m_notifiers changes.
+    std::unordered_map<Realm*, std::vector<std::shared_ptr<_impl::CollectionNotifier>>> m_notifiers_by_realm;
+
+    // SharedGroups used for actually running async notifiers, along with the
+    // notifiers attached to each of them. Each worker's SharedGroup will have
+    // a read transaction iff its notifiers vector is non-empty.
+    struct NotifierWorker {
+        std::unique_ptr<Replication> history;
+        std::unique_ptr<SharedGroup> sg;
+        std::vector<std::shared_ptr<_impl::CollectionNotifier>> notifiers;
+    };
+    std::vector<NotifierWorker> m_notifier_workers;
+
+    // Threads used to run all but the first worker when there is more than one
+    std::unique_ptr<NotifierThreadPool> m_notifier_thread_pool;
+
+    // Recycled change tracking info for the async notifiers. Created on first use.
+    std::unique_ptr<TransactionChangeInfoPool> m_change_info_pool;
 
     // SharedGroup used to advance notifiers in m_new_notifiers to the main shared
     // group's transaction version
@@ -114,15 +155,43 @@ private:
     std::unique_ptr<SharedGroup> m_advancer_sg;
     std::exception_ptr m_async_error;
 
+    std::unique_ptr<query_builder::PredicateCache> m_predicate_cache;
+
+    // Held while running the async notifiers and notifying the Realms, as
+    // they can be run from both the scheduler thread and on_change()
+    std::mutex m_run_mutex;
+
+    // Guards the fields below
+    std::mutex m_scheduler_mutex;
+    // When the last run of the async notifiers started and the minimum time
+    // until the next one should start
+    std::chrono::steady_clock::time_point m_last_notifier_run;
+    std::chrono::steady_clock::duration m_notifier_run_interval{0};
+    // Thread used to run the async notifiers at a later time when commits are
+    // being coalesced. Created on first use.
+    std::unique_ptr<NotifierScheduler> m_notifier_scheduler;
+    // Set by get_realm(), as shared_from_this() can't be used by on_change()
+    // once the coordinator has started being destroyed
+    std::weak_ptr<RealmCoordinator> m_weak_this;
+
+    // Must be the last member so that it's destroyed first, as it can call
+    // on_change() on another thread until then
     std::unique_ptr<_impl::ExternalCommitHelper> m_notifier;
 
     // must be called with m_notifier_mutex locked
     void pin_version(uint_fast64_t version, uint_fast32_t index);
 
     void run_async_notifiers();
-    void open_helper_shared_group();
+    // Run the async notifiers and then tell each Realm that there's new
+    // results available
+    void run_notifiers_and_notify();
+    void schedule_notifier_run(std::chrono::steady_clock::time_point time);
+    void open_helper_shared_group(NotifierWorker& worker);
     void advance_helper_shared_group_to_latest();
     void clean_up_dead_notifiers();
+    void update_notifiers_by_realm();
+
+    friend class NotifierScheduler;
 };
 
 } // namespace _impl
@@ -18,18 +18,262 @@
 
 #include "impl/results_notifier.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <set>
+
 using namespace realm;
 using namespace realm::_impl;
 
+namespace {
+// Timestamps can't be summed
+struct NoSum { };
+
+// A sum of floating point values which values can be removed from again.
+// Non-finite values are counted rather than added, as once the running sum
+// is NaN (or inf) subtracting the value back out can never undo it, and the
+// finite values use compensated summation so that rounding errors don't
+// build up as values are added and removed.
+class FloatSum {
+public:
+    void add(double value)
+    {
+        if (std::isnan(value))
+            ++m_nan;
+        else if (std::isinf(value))
+            ++(value > 0 ? m_positive_inf : m_negative_inf);
+        else
+            add_finite(value);
+    }
+
+    void subtract(double value)
+    {
+        if (std::isnan(value))
+            --m_nan;
+        else if (std::isinf(value))
+            --(value > 0 ? m_positive_inf : m_negative_inf);
+        else
+            add_finite(-value);
+    }
+
+    double value() const
+    {
+        if (m_nan || (m_positive_inf && m_negative_inf))
+            return std::numeric_limits<double>::quiet_NaN();
+        if (m_positive_inf)
+            return std::numeric_limits<double>::infinity();
+        if (m_negative_inf)
+            return -std::numeric_limits<double>::infinity();
+        return m_sum + m_compensation;
+    }
+
+private:
+    double m_sum = 0;
+    // The low-order bits lost from m_sum by each addition
+    double m_compensation = 0;
+    size_t m_nan = 0;
+    size_t m_positive_inf = 0;
+    size_t m_negative_inf = 0;
+
+    void add_finite(double value)
+    {
+        double sum = m_sum + value;
+        if (std::abs(m_sum) >= std::abs(value))
+            m_compensation += (m_sum - sum) + value;
+        else
+            m_compensation += (value - sum) + m_sum;
+        m_sum = sum;
+    }
+};
+
+template<typename T> struct AggregateTraits;
+template<> struct AggregateTraits<int64_t> {
+    using Sum = int64_t;
+    static int64_t get(Table const& table, size_t col, size_t row) { return table.get_int(col, row); }
+};
+template<> struct AggregateTraits<float> {
+    using Sum = FloatSum;
+    static float get(Table const& table, size_t col, size_t row) { return table.get_float(col, row); }
+};
+template<> struct AggregateTraits<double> {
+    using Sum = FloatSum;
+    static double get(Table const& table, size_t col, size_t row) { return table.get_double(col, row); }
+};
+template<> struct AggregateTraits<Timestamp> {
+    using Sum = NoSum;
+    static Timestamp get(Table const& table, size_t col, size_t row) { return table.get_timestamp(col, row); }
+};
+
+template<typename Sum, typename T> void add_to_sum(Sum& sum, T value) { sum += value; }
+template<typename Sum, typename T> void subtract_from_sum(Sum& sum, T value) { sum -= value; }
+template<typename T> void add_to_sum(FloatSum& sum, T value) { sum.add(value); }
+template<typename T> void subtract_from_sum(FloatSum& sum, T value) { sum.subtract(value); }
+void add_to_sum(NoSum&, Timestamp) { }
+void subtract_from_sum(NoSum&, Timestamp) { }
+
+template<typename Sum> util::Optional<Mixed> sum_value(Sum sum) { return Mixed(sum); }
+util::Optional<Mixed> sum_value(FloatSum const& sum) { return Mixed(sum.value()); }
+util::Optional<Mixed> sum_value(NoSum) { return util::none; }
+template<typename Sum> util::Optional<Mixed> average_value(Sum sum, size_t count)
+{
+    if (count == 0)
+        return util::none;
+    return Mixed(double(sum) / count);
+}
+util::Optional<Mixed> average_value(FloatSum const& sum, size_t count)
+{
+    if (count == 0)
+        return util::none;
+    return Mixed(sum.value() / count);
+}
+util::Optional<Mixed> average_value(NoSum, size_t) { return util::none; }
+
+// NaN has no place in an ordering, so it's left out of the min and max
+template<typename T> bool is_nan(T) { return false; }
+bool is_nan(float value) { return std::isnan(value); }
+bool is_nan(double value) { return std::isnan(value); }
+
+template<typename T>
+class TypedAggregateTracker : public AggregateTracker {
+public:
+    TypedAggregateTracker(size_t column) : m_column(column) { }
+
+    void reset(Table const& table, std::vector<size_t> const& rows) override
+    {
+        m_values.clear();
+        m_sorted_values.clear();
+        m_sum = {};
+        m_count = 0;
+
+        m_values.reserve(rows.size());
+        for (auto row : rows)
+            m_values.push_back(read(table, row));
+    }
+
+    void update(Table const& table, std::vector<size_t> const& rows,
+                CollectionChangeBuilder const& changes) override
+    {
+        // The changeset has deletions as old indices, and insertions and
+        // modifications as new indices, so a single pass over the new rows
+        // while walking the old values in step visits every changed row
+        for (auto i : changes.deletions.as_indexes())
+            remove(m_values[i]);
+
+        std::vector<util::Optional<T>> values;
+        values.reserve(rows.size());
+
+        auto deleted = changes.deletions.as_indexes().begin(), deleted_end = changes.deletions.as_indexes().end();
+        auto inserted = changes.insertions.as_indexes().begin(), inserted_end = changes.insertions.as_indexes().end();
+        auto modified = changes.modifications.as_indexes().begin(), modified_end = changes.modifications.as_indexes().end();
+        size_t old_ndx = 0;
+
+        for (size_t i = 0; i < rows.size(); ++i) {
+            while (modified != modified_end && *modified < i)
+                ++modified;
+            if (inserted != inserted_end && *inserted == i) {
+                ++inserted;
+                values.push_back(read(table, rows[i]));
+                continue;
+            }
+
+            while (deleted != deleted_end && *deleted == old_ndx) {
+                ++deleted;
+                ++old_ndx;
+            }
+            REALM_ASSERT_DEBUG(old_ndx < m_values.size());
+            auto& old_value = m_values[old_ndx++];
+            if (modified != modified_end && *modified == i) {
+                remove(old_value);
+                values.push_back(read(table, rows[i]));
+            }
+            else {
+                values.push_back(std::move(old_value));
+            }
+        }
+
+        m_values = std::move(values);
+    }
+
+    AggregateValues values() const override
+    {
+        AggregateValues values;
+        if (!m_sorted_values.empty()) {
+            values.min = Mixed(*m_sorted_values.begin());
+            values.max = Mixed(*m_sorted_values.rbegin());
+        }
+        values.sum = sum_value(m_sum);
+        values.average = average_value(m_sum, m_count);
+        values.count = m_count;
+        return values;
+    }
+
+private:
+    using Sum = typename AggregateTraits<T>::Sum;
+
+    const size_t m_column;
+    // The value for each row of the results, in the same order
+    std::vector<util::Optional<T>> m_values;
+    // The non-null, non-NaN values, for the min and max
+    std::multiset<T> m_sorted_values;
+    Sum m_sum = {};
+    size_t m_count = 0;
+
+    util::Optional<T> read(Table const& table, size_t row)
+    {
+        if (table.is_null(m_column, row))
+            return util::none;
+        T value = AggregateTraits<T>::get(table, m_column, row);
+        add_to_sum(m_sum, value);
+        ++m_count;
+        if (!is_nan(value))
+            m_sorted_values.insert(value);
+        return value;
+    }
+
+    void remove(util::Optional<T> const& value)
+    {
+        if (!value)
+            return;
+        subtract_from_sum(m_sum, *value);
+        // Start again from an exact zero once every value has been removed
+        if (--m_count == 0)
+            m_sum = {};
+        if (!is_nan(*value))
+            m_sorted_values.erase(m_sorted_values.find(*value));
+    }
+};
+} // anonymous namespace
+
+std::unique_ptr<AggregateTracker> AggregateTracker::create(Table const& table, size_t column)
+{
+    switch (table.get_column_type(column)) {
+        case type_Int:       return std::make_unique<TypedAggregateTracker<int64_t>>(column);
+        case type_Float:     return std::make_unique<TypedAggregateTracker<float>>(column);
+        case type_Double:    return std::make_unique<TypedAggregateTracker<double>>(column);
+        case type_Timestamp: return std::make_unique<TypedAggregateTracker<Timestamp>>(column);
+        default:             return nullptr;
+    }
+}
+
 ResultsNotifier::ResultsNotifier(Results& target)
 : CollectionNotifier(target.get_realm())
 , m_target_results(&target)
 , m_target_is_in_table_order(target.is_in_table_order())
+, m_max_moved_rows(target.get_realm()->config().max_notification_moved_rows)
+, m_defer_runs_while_pending(target.get_realm()->config().defer_notifier_runs_while_pending)
+, m_window_offset(target.get_window_offset())
+, m_window_count(target.get_window_count())
 {
     Query q = target.get_query();
     set_table(*q.get_table());
     m_query_handover = Realm::Internal::get_shared_group(*get_realm()).export_for_handover(q, MutableSourcePayload::Move);
     SortDescriptor::generate_patch(target.get_sort(), m_sort_handover);
+    if (m_sort_handover && q.produces_results_in_table_order()) {
+        auto const& columns = m_sort_handover->columns;
+        m_sort_is_on_own_columns = std::all_of(begin(columns), end(columns),
+                                               [](auto const& column) { return column.size() == 1; });
+    }
 }
 
 void ResultsNotifier::target_results_moved(Results& old_target, Results& new_target)
@@ -40,6 +284,19 @@ void ResultsNotifier::target_results_moved(Results& old_target, Results& new_tar
     m_target_results = &new_target;
 }
 
+std::shared_ptr<AggregateValues const> ResultsNotifier::add_aggregate(std::unique_ptr<AggregateTracker> tracker,
+                                                                      AggregateValues initial)
+{
+    auto aggregate = std::make_unique<Aggregate>();
+    aggregate->tracker = std::move(tracker);
+    aggregate->delivered = std::make_shared<AggregateValues>(std::move(initial));
+    auto delivered = aggregate->delivered;
+
+    std::lock_guard<std::mutex> lock(m_aggregate_mutex);
+    m_aggregates.push_back(std::move(aggregate));
+    return delivered;
+}
+
 void ResultsNotifier::release_data() noexcept
 {
     m_query = nullptr;
@@ -100,41 +357,148 @@ bool ResultsNotifier::need_to_run()
     return true;
 }
 
+bool ResultsNotifier::can_calculate_changes_incrementally(CollectionChangeBuilder const& table_changes) const
+{
+    // Rows can only enter or leave the results or change position without
+    // being modified themselves if the query or sort depends on other tables
+    if (m_sort ? !m_sort_is_on_own_columns : !m_target_is_in_table_order)
+        return false;
+    // Rows move in and out of a window when rows before it are inserted or
+    // removed, without being modified themselves
+    if (m_window_offset != 0 || m_window_count != npos)
+        return false;
+    if (related_tables().size() != 1)
+        return false;
+
+    // The table-level changeset only has everything we need if both
+    // modifications and moves were tracked for the table
+    size_t table_ndx = m_query->get_table()->get_index_in_group();
+    if (table_ndx >= m_info->table_modifications_needed.size() || !m_info->table_modifications_needed[table_ndx])
+        return false;
+    if (table_ndx >= m_info->table_moves_needed.size() || !m_info->table_moves_needed[table_ndx])
+        return false;
+
+    // Each changed row costs a few binary searches, so once more rows have
+    // changed than the table has the full diff is cheaper. This is deliberately
+    // not relative to the size of the results, as a small result set over a
+    // large table is where skipping the full diff helps the most.
+    size_t changed = table_changes.deletions.count() + table_changes.insertions.count()
+                   + table_changes.modifications.count();
+    return changed <= m_query->get_table()->size();
+}
+
+void ResultsNotifier::map_previous_rows(CollectionChangeBuilder const& table_changes)
+{
+    auto const& moves = table_changes.moves;
+    for (auto& idx : m_previous_rows) {
+        if (idx == npos)
+            continue;
+        auto it = lower_bound(begin(moves), end(moves), idx,
+                              [](auto const& a, auto b) { return a.from < b; });
+        if (it != moves.end() && it->from == idx)
+            idx = it->to;
+        else if (table_changes.deletions.contains(idx))
+            idx = npos;
+        else
+            REALM_ASSERT_DEBUG(!table_changes.insertions.contains(idx));
+    }
+}
+
+void ResultsNotifier::defer_run()
+{
+    // Rather than rerunning the query, keep the previous rows up to date with
+    // the changes to the table and remember which of them were modified, so
+    // that the eventual run can report everything since the last delivery
+    m_run_deferred = true;
+
+    size_t table_ndx = m_query->get_table()->get_index_in_group();
+    if (table_ndx < m_info->tables.size())
+        map_previous_rows(m_info->tables[table_ndx]);
+
+    m_previous_rows_modified.resize(m_previous_rows.size());
+    auto row_did_change = get_modification_checker(*m_info, *m_query->get_table());
+    for (size_t i = 0; i < m_previous_rows.size(); ++i) {
+        if (!m_previous_rows_modified[i] && m_previous_rows[i] != npos && row_did_change(m_previous_rows[i]))
+            m_previous_rows_modified[i] = true;
+    }
+}
+
+std::vector<size_t> ResultsNotifier::get_rows_in_window() const
+{
+    // Only the rows inside the window are diffed, so the changes for a
+    // windowed Results are in terms of positions within the window
+    size_t begin = std::min(m_window_offset, m_tv.size());
+    size_t end = begin + std::min(m_window_count, m_tv.size() - begin);
+
+    std::vector<size_t> rows;
+    rows.reserve(end - begin);
+    for (size_t i = begin; i < end; ++i)
+        rows.push_back(m_tv[i].get_index());
+    return rows;
+}
+
 void ResultsNotifier::calculate_changes()
 {
     size_t table_ndx = m_query->get_table()->get_index_in_group();
     if (m_initial_run_complete) {
         auto changes = table_ndx < m_info->tables.size() ? &m_info->tables[table_ndx] : nullptr;
 
-        std::vector<size_t> next_rows;
-        next_rows.reserve(m_tv.size());
-        for (size_t i = 0; i < m_tv.size(); ++i)
-            next_rows.push_back(m_tv[i].get_index());
-
-        if (changes) {
-            auto const& moves = changes->moves;
-            for (auto& idx : m_previous_rows) {
-                auto it = lower_bound(begin(moves), end(moves), idx,
-                                      [](auto const& a, auto b) { return a.from < b; });
-                if (it != moves.end() && it->from == idx)
-                    idx = it->to;
-                else if (changes->deletions.contains(idx))
-                    idx = npos;
-                else
-                    REALM_ASSERT_DEBUG(!changes->insertions.contains(idx));
+        auto next_rows = get_rows_in_window();
+
+        // Modifications from deferred runs aren't in the table changes
+        bool have_deferred_modifications = !m_previous_rows_modified.empty();
+        if (changes && !have_deferred_modifications && can_calculate_changes_incrementally(*changes)) {
+            if (m_sort)
+                m_changes = CollectionChangeBuilder::calculate_incremental_sorted(m_previous_rows, next_rows, *changes);
+            else
+                m_changes = CollectionChangeBuilder::calculate_incremental(m_previous_rows, next_rows, *changes);
+            m_previous_rows = std::move(next_rows);
+            return;
+        }
+
+        if (changes)
+            map_previous_rows(*changes);
+
+        auto row_did_change = get_modification_checker(*m_info, *m_query->get_table());
+        if (have_deferred_modifications) {
+            std::vector<size_t> modified;
+            for (size_t i = 0; i < m_previous_rows.size(); ++i) {
+                if (m_previous_rows_modified[i] && m_previous_rows[i] != npos)
+                    modified.push_back(m_previous_rows[i]);
             }
+            std::sort(modified.begin(), modified.end());
+            m_previous_rows_modified.clear();
+
+            row_did_change = [modified = std::move(modified), row_did_change = std::move(row_did_change)](size_t row) {
+                return std::binary_search(modified.begin(), modified.end(), row) || row_did_change(row);
+            };
         }
 
-        m_changes = CollectionChangeBuilder::calculate(m_previous_rows, next_rows,
-                                                       get_modification_checker(*m_info, *m_query->get_table()),
-                                                       m_target_is_in_table_order && !m_sort);
+        m_changes = CollectionChangeBuilder::calculate(m_previous_rows, next_rows, std::move(row_did_change),
+                                                       m_target_is_in_table_order && !m_sort,
+                                                       m_max_moved_rows);
 
         m_previous_rows = std::move(next_rows);
     }
     else {
-        m_previous_rows.resize(m_tv.size());
-        for (size_t i = 0; i < m_tv.size(); ++i)
-            m_previous_rows[i] = m_tv[i].get_index();
+        m_previous_rows = get_rows_in_window();
+    }
+}
+
+void ResultsNotifier::update_aggregates()
+{
+    std::lock_guard<std::mutex> lock(m_aggregate_mutex);
+    auto& table = *m_query->get_table();
+    for (auto& aggregate : m_aggregates) {
+        // Aggregates added since the last run are aligned with the rows seen
+        // by the target thread rather than m_previous_rows, so they start over
+        if (aggregate->needs_reset || !m_initial_run_complete) {
+            aggregate->tracker->reset(table, m_previous_rows);
+            aggregate->needs_reset = false;
+        }
+        else {
+            aggregate->tracker->update(table, m_previous_rows, m_changes);
+        }
     }
 }
 
@@ -143,18 +507,41 @@ void ResultsNotifier::run()
     if (!need_to_run())
         return;
 
+    if (m_defer_runs_while_pending && m_initial_run_complete && m_result_pending) {
+        defer_run();
+        return;
+    }
+
+    // The query itself is always rerun over the whole table, as the TableView
+    // handed over to the target thread can only be built by find_all(). Only
+    // the diff against the previous rows is calculated incrementally.
     m_query->sync_view_if_needed();
-    m_tv = m_query->find_all();
     if (m_sort) {
+        m_tv = m_query->find_all();
         m_tv.sort(m_sort);
     }
+    else {
+        // See Results::update_tableview()
+        size_t window_end = m_window_count > npos - m_window_offset ? npos : m_window_offset + m_window_count;
+        m_tv = m_query->find_all(0, npos, window_end);
+    }
     m_last_seen_version = m_tv.sync_if_needed();
 
     calculate_changes();
+    if (m_initial_run_complete) {
+        calculate_filtered_modifications(*m_info, *m_query->get_table(), m_changes.modifications,
+                                         [&](size_t ndx) { return m_previous_rows[ndx]; });
+    }
+    update_aggregates();
 }
 
 void ResultsNotifier::do_prepare_handover(SharedGroup& sg)
 {
+    if (m_run_deferred) {
+        // The pending result is now out of date, and delivering it would
+        // report changes which don't match the version it's delivered at
+        m_tv_handover.reset();
+    }
     if (!m_tv.is_attached()) {
         return;
     }
@@ -163,6 +550,15 @@ void ResultsNotifier::do_prepare_handover(SharedGroup& sg)
 
     m_initial_run_complete = true;
     m_tv_handover = sg.export_for_handover(m_tv, MutableSourcePayload::Move);
+    m_result_pending = true;
+
+    {
+        std::lock_guard<std::mutex> lock(m_aggregate_mutex);
+        for (auto& aggregate : m_aggregates) {
+            if (!aggregate->needs_reset)
+                aggregate->handover = aggregate->tracker->values();
+        }
+    }
 
     add_changes(std::move(m_changes));
     REALM_ASSERT(m_changes.empty());
@@ -192,10 +588,28 @@ bool ResultsNotifier::do_deliver(SharedGroup& sg)
 
     REALM_ASSERT(!m_query_handover);
 
+    // The target has caught up, so ask for the deferred run to happen now.
+    // Nothing is delivered until then, and the changes accumulated so far are
+    // kept to be merged with that run's.
+    m_result_pending = false;
+    if (m_run_deferred.exchange(false)) {
+        m_tv_handover.reset();
+        request_run();
+        return false;
+    }
+
     if (m_tv_handover) {
         m_tv_handover->version = version();
         Results::Internal::set_table_view(*m_target_results,
                                           std::move(*sg.import_from_handover(std::move(m_tv_handover))));
+
+        std::lock_guard<std::mutex> lock(m_aggregate_mutex);
+        for (auto& aggregate : m_aggregates) {
+            if (aggregate->handover) {
+                *aggregate->delivered = std::move(*aggregate->handover);
+                aggregate->handover = util::none;
+            }
+        }
     }
     REALM_ASSERT(!m_tv_handover);
     return true;
@@ -23,15 +23,55 @@
 #include "results.hpp"
 
 #include <realm/group_shared.hpp>
+#include <realm/mixed.hpp>
+
+#include <atomic>
+#include <mutex>
 
 namespace realm {
 namespace _impl {
+// The aggregates of a column over the rows of a Results
+struct AggregateValues {
+    util::Optional<Mixed> min;
+    util::Optional<Mixed> max;
+    // Always none for Timestamp columns
+    util::Optional<Mixed> sum;
+    util::Optional<Mixed> average;
+    // The number of non-null values
+    size_t count = 0;
+};
+
+// Maintains the aggregates of a single column as the rows of the results
+// change, so that they only have to be calculated from scratch once
+class AggregateTracker {
+public:
+    virtual ~AggregateTracker() = default;
+
+    // Recalculate the aggregates for the given rows of the table
+    virtual void reset(Table const& table, std::vector<size_t> const& rows) = 0;
+    // Update the aggregates from the rows they were last calculated for to
+    // `rows`, where `changes` is the changeset between the two
+    virtual void update(Table const& table, std::vector<size_t> const& rows,
+                        CollectionChangeBuilder const& changes) = 0;
+    virtual AggregateValues values() const = 0;
+
+    // Returns nullptr if the column's type can't be aggregated
+    static std::unique_ptr<AggregateTracker> create(Table const& table, size_t column);
+};
+
 class ResultsNotifier : public CollectionNotifier {
 public:
     ResultsNotifier(Results& target);
 
     void target_results_moved(Results& old_target, Results& new_target);
 
+    // Start maintaining aggregates with the given tracker. Returns the values
+    // as of the most recently delivered version, which are initially
+    // `initial` and are updated on the target thread before the callbacks are
+    // called.
+    std::shared_ptr<AggregateValues const> add_aggregate(std::unique_ptr<AggregateTracker> tracker,
+                                                         AggregateValues initial);
+
 private:
     // Target Results to update
     // Can only be used with lock_target() held
@@ -44,6 +84,17 @@ private:
     SortDescriptor::HandoverPatch m_sort_handover;
     SortDescriptor m_sort;
     bool m_target_is_in_table_order;
+    // True if the results are sorted only on columns of the table itself and
+    // the query does not restrict them to a LinkView, so that only rows which
+    // were changed can change position
+    bool m_sort_is_on_own_columns = false;
+    // From the Realm's config; see Realm::Config::max_notification_moved_rows
+    size_t m_max_moved_rows;
+    // See Realm::Config::defer_notifier_runs_while_pending
+    bool m_defer_runs_while_pending;
+    // See Results::limit()
+    size_t m_window_offset;
+    size_t m_window_count;
 
     // The TableView resulting from running the query. Will be detached unless
     // the query was (re)run since the last time the handover object was created
@@ -65,8 +116,37 @@ private:
     // can lead to deliver() being called before that
     bool m_initial_run_complete = false;
 
+    // Set while the result of the last run is waiting for the target thread
+    // to pick it up, in which case rerunning the query would be wasted work
+    std::atomic<bool> m_result_pending{false};
+    // Set when run() skipped rerunning the query because the previous result
+    // was pending. The result is then discarded rather than delivered, and
+    // the next run is requested once the target thread catches up.
+    std::atomic<bool> m_run_deferred{false};
+    // Whether the row at each index of m_previous_rows was modified in a
+    // version whose run was deferred
+    std::vector<bool> m_previous_rows_modified;
+
+    struct Aggregate {
+        // Updated in run() along with m_previous_rows
+        std::unique_ptr<AggregateTracker> tracker;
+        bool needs_reset = true;
+        // Written in prepare_handover() and read in deliver()
+        util::Optional<AggregateValues> handover;
+        // Written in deliver() and read by the target thread
+        std::shared_ptr<AggregateValues> delivered;
+    };
+    // Guards the vector itself, as aggregates are added from the target thread
+    std::mutex m_aggregate_mutex;
+    std::vector<std::unique_ptr<Aggregate>> m_aggregates;
+
     bool need_to_run();
+    void defer_run();
+    void map_previous_rows(CollectionChangeBuilder const& table_changes);
     void calculate_changes();
+    std::vector<size_t> get_rows_in_window() const;
+    void update_aggregates();
+    bool can_calculate_changes_incrementally(CollectionChangeBuilder const& table_changes) const;
 
     void run() override;
     void do_prepare_handover(SharedGroup&) override;
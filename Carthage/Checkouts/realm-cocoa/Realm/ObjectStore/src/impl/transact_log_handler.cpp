@@ -26,6 +26,7 @@
 #include <realm/group_shared.hpp>
 #include <realm/lang_bind_helper.hpp>
 #include <algorithm>
+#include <map>
 
 using namespace realm;
 
@@ -222,9 +223,15 @@ void adjust_for_move(size_t& value, size_t from, size_t to)
 class TransactLogObserver : public TransactLogValidationMixin, public MarkDirtyMixin<TransactLogObserver> {
     using ColumnInfo = BindingContext::ColumnInfo;
     using ObserverState = BindingContext::ObserverState;
+    using ObservedRows = std::multimap<size_t, size_t>;
 
-    // Observed table rows which need change information
+    // Observed table rows which need change information. Invalidated
+    // observers are marked by setting their row to npos and are removed from
+    // the vector before it's passed to the context.
     std::vector<ObserverState> m_observers;
+    // For each table, the observed rows mapped to their index in m_observers,
+    // so that row operations only have to visit the observers they affect
+    std::vector<ObservedRows> m_observed_rows;
     // Userdata pointers for rows which have been deleted
     std::vector<void *> invalidated;
     // Delegate to send change information to
@@ -252,12 +259,47 @@ class TransactLogObserver : public TransactLogValidationMixin, public MarkDirtyM
         }
     }
 
-    // Remove the given observer from the list of observed objects and add it
-    // to the listed of invalidated objects
-    void invalidate(ObserverState *o)
+    // Get the observed rows for the current table, or null if none are observed
+    ObservedRows* observed_rows()
     {
-        invalidated.push_back(o->info);
-        m_observers.erase(m_observers.begin() + (o - &m_observers[0]));
+        auto tbl_ndx = current_table();
+        if (tbl_ndx >= m_observed_rows.size() || m_observed_rows[tbl_ndx].empty())
+            return nullptr;
+        return &m_observed_rows[tbl_ndx];
+    }
+
+    // Mark the given observer as removed from the list of observed objects and
+    // add it to the listed of invalidated objects
+    void invalidate(size_t observer_ndx)
+    {
+        auto& o = m_observers[observer_ndx];
+        invalidated.push_back(o.info);
+        o.row_ndx = npos;
+    }
+
+    // Change the row of each observer from `first` onwards by `shift`. The
+    // shift must not move any of them to before the rows prior to `first`.
+    static void shift_rows(ObservedRows& rows, std::vector<ObserverState>& observers,
+                           ObservedRows::iterator first, ptrdiff_t shift)
+    {
+        std::vector<std::pair<size_t, size_t>> shifted(first, rows.end());
+        rows.erase(first, rows.end());
+        for (auto& row : shifted) {
+            row.first += shift;
+            observers[row.second].row_ndx = row.first;
+            rows.emplace_hint(rows.end(), row);
+        }
+    }
+
+    // Remove the invalidated observers before passing the list to the context
+    void remove_invalidated()
+    {
+        if (invalidated.empty())
+            return;
+        m_observers.erase(remove_if(begin(m_observers), end(m_observers),
+                                    [](auto const& o) { return o.row_ndx == npos; }),
+                          end(m_observers));
+        m_observed_rows.clear();
     }
 
 public:
@@ -268,6 +310,12 @@ public:
         auto old_version = sg.get_version_of_current_transaction();
         if (context) {
             m_observers = context->get_observed_rows();
+            for (size_t i = 0; i < m_observers.size(); ++i) {
+                auto tbl_ndx = m_observers[i].table_ndx;
+                if (m_observed_rows.size() <= tbl_ndx)
+                    m_observed_rows.resize(tbl_ndx + 1);
+                m_observed_rows[tbl_ndx].emplace(m_observers[i].row_ndx, i);
+            }
         }
         if (m_observers.empty()) {
             if (schema_mode) {
@@ -283,15 +331,17 @@ public:
         }
 
         func(*this);
+        remove_invalidated();
         context->did_change(m_observers, invalidated);
     }
 
     // Mark the given row/col as needing notifications sent
     void mark_dirty(size_t row_ndx, size_t col_ndx)
     {
-        auto it = lower_bound(begin(m_observers), end(m_observers), ObserverState{current_table(), row_ndx, nullptr});
-        if (it != end(m_observers) && it->table_ndx == current_table() && it->row_ndx == row_ndx) {
-            get_change(*it, col_ndx).kind = ColumnInfo::Kind::Set;
+        if (auto rows = observed_rows()) {
+            auto range = rows->equal_range(row_ndx);
+            for (auto it = range.first; it != range.second; ++it)
+                get_change(m_observers[it->second], col_ndx).kind = ColumnInfo::Kind::Set;
         }
     }
 
@@ -299,6 +349,7 @@ public:
     // is advanced
     void parse_complete()
     {
+        remove_invalidated();
         m_context->will_change(m_observers, invalidated);
     }
 
@@ -308,6 +359,7 @@ public:
             if (observer.table_ndx >= table_ndx)
                 ++observer.table_ndx;
         }
+        insert_empty_at(m_observed_rows, table_ndx);
         TransactLogValidationMixin::insert_group_level_table(table_ndx, prior_size, name);
         return true;
     }
@@ -315,29 +367,37 @@ public:
     bool insert_empty_rows(size_t row_ndx, size_t num_rows, size_t prior_size, bool)
     {
         if (row_ndx != prior_size) {
-            for (auto& observer : m_observers) {
-                if (observer.row_ndx >= row_ndx)
-                    observer.row_ndx += num_rows;
-            }
+            if (auto rows = observed_rows())
+                shift_rows(*rows, m_observers, rows->lower_bound(row_ndx), num_rows);
         }
         return true;
     }
 
     bool erase_rows(size_t row_ndx, size_t, size_t last_row_ndx, bool unordered)
     {
-        for (size_t i = 0; i < m_observers.size(); ++i) {
-            auto& o = m_observers[i];
-            if (o.table_ndx == current_table()) {
-                if (o.row_ndx == row_ndx) {
-                    invalidate(&o);
-                    --i;
-                }
-                else if (unordered && o.row_ndx == last_row_ndx) {
-                    o.row_ndx = row_ndx;
-                }
-                else if (!unordered && o.row_ndx > row_ndx) {
-                    o.row_ndx -= 1;
-                }
+        auto rows = observed_rows();
+        if (!rows)
+            return true;
+
+        auto range = rows->equal_range(row_ndx);
+        for (auto it = range.first; it != range.second; ++it)
+            invalidate(it->second);
+        auto next = rows->erase(range.first, range.second);
+
+        if (!unordered) {
+            shift_rows(*rows, m_observers, next, -1);
+        }
+        else if (row_ndx != last_row_ndx) {
+            // The last row is moved over the erased one, and is always at the
+            // end of the ordered rows
+            range = rows->equal_range(last_row_ndx);
+            std::vector<size_t> moved;
+            for (auto it = range.first; it != range.second; ++it)
+                moved.push_back(it->second);
+            rows->erase(range.first, range.second);
+            for (auto observer_ndx : moved) {
+                m_observers[observer_ndx].row_ndx = row_ndx;
+                rows->emplace(row_ndx, observer_ndx);
             }
         }
         return true;
@@ -345,14 +405,10 @@ public:
 
     bool clear_table()
     {
-        for (size_t i = 0; i < m_observers.size(); ) {
-            auto& o = m_observers[i];
-            if (o.table_ndx == current_table()) {
-                invalidate(&o);
-            }
-            else {
-                ++i;
-            }
+        if (auto rows = observed_rows()) {
+            for (auto const& row : *rows)
+                invalidate(row.second);
+            rows->clear();
         }
         return true;
     }
@@ -360,11 +416,10 @@ public:
     bool select_link_list(size_t col, size_t row, size_t)
     {
         m_active_linklist = nullptr;
-        for (auto& o : m_observers) {
-            if (o.table_ndx == current_table() && o.row_ndx == row) {
-                m_active_linklist = &get_change(o, col);
-                break;
-            }
+        if (auto rows = observed_rows()) {
+            auto it = rows->find(row);
+            if (it != rows->end())
+                m_active_linklist = &get_change(m_observers[it->second], col);
         }
         return true;
     }
@@ -474,8 +529,9 @@ public:
 
     bool insert_column(size_t ndx, DataType, StringData, bool)
     {
-        for (auto& observer : m_observers) {
-            if (observer.table_ndx == current_table()) {
+        if (auto rows = observed_rows()) {
+            for (auto const& row : *rows) {
+                auto& observer = m_observers[row.second];
                 expand_to(observer, ndx);
                 insert_empty_at(observer.changes, ndx);
             }
@@ -485,8 +541,9 @@ public:
 
     bool move_column(size_t from, size_t to)
     {
-        for (auto& observer : m_observers) {
-            if (observer.table_ndx == current_table()) {
+        if (auto rows = observed_rows()) {
+            for (auto const& row : *rows) {
+                auto& observer = m_observers[row.second];
                 // have to initialize the columns one past the moved one so that
                 // we can later initialize any more columns after that
                 expand_to(observer, std::max(from, to) + 1);
@@ -500,6 +557,7 @@ public:
     {
         for (auto& observer : m_observers)
             adjust_for_move(observer.table_ndx, from, to);
+        rotate(m_observed_rows, from, to);
         return true;
     }
 
@@ -537,14 +595,32 @@ class LinkViewObserver : public TransactLogValidationMixin, public MarkDirtyMixi
         return tbl_ndx < m_info.table_moves_needed.size() && m_info.table_moves_needed[tbl_ndx];
     }
 
+    // Get the modified rows of each column of the current table, or null if
+    // they aren't being tracked
+    std::vector<IndexSet>* get_column_changes()
+    {
+        auto tbl_ndx = current_table();
+        if (tbl_ndx >= m_info.table_columns_needed.size() || !m_info.table_columns_needed[tbl_ndx])
+            return nullptr;
+        if (m_info.columns.size() <= tbl_ndx)
+            m_info.columns.resize(std::max(m_info.columns.size() * 2, tbl_ndx + 1));
+        return &m_info.columns[tbl_ndx];
+    }
+
 public:
     LinkViewObserver(_impl::TransactionChangeInfo& info)
     : m_info(info) { }
 
-    void mark_dirty(size_t row, size_t)
+    void mark_dirty(size_t row, size_t col)
     {
-        if (auto change = get_change())
+        if (auto change = get_change()) {
             change->modify(row);
+            if (auto columns = get_column_changes()) {
+                if (columns->size() <= col)
+                    columns->resize(col + 1);
+                (*columns)[col].add(row);
+            }
+        }
     }
 
     void parse_complete()
@@ -626,6 +702,10 @@ public:
         REALM_ASSERT(!unordered);
         if (auto change = get_change())
             change->insert(row_ndx, num_rows_to_insert, need_move_info());
+        if (auto columns = get_column_changes()) {
+            for (auto& column : *columns)
+                column.shift_for_insert_at(row_ndx, num_rows_to_insert);
+        }
 
         return true;
     }
@@ -650,6 +730,16 @@ public:
 
         if (auto change = get_change())
             change->move_over(row_ndx, last_row, need_move_info());
+        if (auto columns = get_column_changes()) {
+            // The last row is moved into the place of the erased row
+            for (auto& column : *columns) {
+                bool last_row_modified = row_ndx != last_row && column.contains(last_row);
+                column.remove(last_row);
+                column.remove(row_ndx);
+                if (last_row_modified)
+                    column.add(row_ndx);
+            }
+        }
         return true;
     }
 
@@ -661,6 +751,10 @@ public:
         m_info.lists.erase(it, end(m_info.lists));
         if (auto change = get_change())
             change->clear(std::numeric_limits<size_t>::max());
+        if (auto columns = get_column_changes()) {
+            for (auto& column : *columns)
+                column.clear();
+        }
         return true;
     }
 
@@ -670,6 +764,8 @@ public:
             if (list.table_ndx == current_table() && list.col_ndx >= ndx)
                 ++list.col_ndx;
         }
+        if (auto columns = get_column_changes())
+            insert_empty_at(*columns, ndx);
         return true;
     }
 
@@ -682,6 +778,8 @@ public:
         insert_empty_at(m_info.tables, ndx);
         insert_empty_at(m_info.table_moves_needed, ndx);
         insert_empty_at(m_info.table_modifications_needed, ndx);
+        insert_empty_at(m_info.table_columns_needed, ndx);
+        insert_empty_at(m_info.columns, ndx);
         return true;
     }
 
@@ -691,6 +789,8 @@ public:
             if (list.table_ndx == current_table())
                 adjust_for_move(list.col_ndx, from, to);
         }
+        if (auto columns = get_column_changes())
+            rotate(*columns, from, to);
         return true;
     }
 
@@ -701,6 +801,8 @@ public:
         rotate(m_info.tables, from, to);
         rotate(m_info.table_modifications_needed, from, to);
         rotate(m_info.table_moves_needed, from, to);
+        rotate(m_info.table_columns_needed, from, to);
+        rotate(m_info.columns, from, to);
         return true;
     }
 
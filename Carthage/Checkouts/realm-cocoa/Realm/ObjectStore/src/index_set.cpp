@@ -30,14 +30,15 @@ const size_t IndexSet::npos;
 template<typename T>
 void MutableChunkedRangeVectorIterator<T>::set(size_t front, size_t back)
 {
-    this->m_outer->count -= this->m_inner->second - this->m_inner->first;
+    ptrdiff_t delta = (back - front) - (this->m_inner->second - this->m_inner->first);
     if (this->offset() == 0) {
         this->m_outer->begin = front;
     }
     if (this->m_inner == &this->m_outer->data.back()) {
         this->m_outer->end = back;
     }
-    this->m_outer->count += back - front;
+    this->m_outer->count += delta;
+    m_parent->adjust_count_before(this->m_outer, delta);
     this->m_inner->first = front;
     this->m_inner->second = back;
 }
@@ -52,6 +53,7 @@ void MutableChunkedRangeVectorIterator<T>::adjust(ptrdiff_t front, ptrdiff_t bac
         this->m_outer->end += back;
     }
     this->m_outer->count += -front + back;
+    m_parent->adjust_count_before(this->m_outer, -front + back);
     this->m_inner->first += front;
     this->m_inner->second += back;
 }
@@ -80,6 +82,7 @@ void ChunkedRangeVector::push_back(value_type value)
         range.end = value.second;
     }
     else {
+        m_count_before.push_back(empty() ? 0 : m_count_before.back() + m_data.back().count);
         m_data.push_back({{std::move(value)}, value.first, value.second, value.second - value.first});
     }
     verify();
@@ -96,6 +99,7 @@ ChunkedRangeVector::iterator ChunkedRangeVector::insert(iterator pos, value_type
     auto& chunk = *pos.m_outer;
     pos.m_inner = &*chunk.data.insert(pos.m_outer->data.begin() + pos.offset(), value);
     chunk.count += value.second - value.first;
+    adjust_count_before(pos.m_outer, value.second - value.first);
     chunk.begin = std::min(chunk.begin, value.first);
     chunk.end = std::max(chunk.end, value.second);
 
@@ -127,6 +131,8 @@ ChunkedRangeVector::iterator ChunkedRangeVector::ensure_space(iterator pos)
     new_pos->begin = new_pos->data.front().first;
     new_pos->end = new_pos->data.back().second;
     new_pos->count = moved_count;
+    auto prev_count_before = m_count_before[prev - m_data.begin()];
+    m_count_before.insert(m_count_before.begin() + (new_pos - m_data.begin()), prev_count_before + prev->count);
 
     if (offset >= to_move) {
         pos.m_outer = new_pos;
@@ -146,9 +152,11 @@ ChunkedRangeVector::iterator ChunkedRangeVector::erase(iterator pos)
     auto offset = pos.offset();
     auto& chunk = *pos.m_outer;
     chunk.count -= pos->second - pos->first;
+    adjust_count_before(pos.m_outer, -ptrdiff_t(pos->second - pos->first));
     chunk.data.erase(chunk.data.begin() + offset);
 
     if (chunk.data.size() == 0) {
+        m_count_before.erase(m_count_before.begin() + (pos.m_outer - m_data.begin()));
         pos.m_outer = m_data.erase(pos.m_outer);
         pos.m_end = m_data.end();
         pos.m_inner = pos.m_outer == m_data.end() ? nullptr : &pos.m_outer->data.front();
@@ -169,6 +177,24 @@ ChunkedRangeVector::iterator ChunkedRangeVector::erase(iterator pos)
     return pos;
 }
 
+void ChunkedRangeVector::adjust_count_before(ChunkVector::iterator chunk, ptrdiff_t delta)
+{
+    if (delta == 0)
+        return;
+    for (auto it = m_count_before.begin() + (chunk - m_data.begin()) + 1; it != m_count_before.end(); ++it)
+        *it += delta;
+}
+
+void ChunkedRangeVector::rebuild_count_before()
+{
+    m_count_before.resize(m_data.size());
+    size_t count_before = 0;
+    for (size_t i = 0; i < m_data.size(); ++i) {
+        m_count_before[i] = count_before;
+        count_before += m_data[i].count;
+    }
+}
+
 void ChunkedRangeVector::verify() const noexcept
 {
 #ifdef REALM_DEBUG
@@ -179,7 +205,12 @@ void ChunkedRangeVector::verify() const noexcept
         prev_end = range.second;
     }
 
-    for (auto& chunk : m_data) {
+    REALM_ASSERT(m_count_before.size() == m_data.size());
+    size_t count_before = 0;
+    for (size_t i = 0; i < m_data.size(); ++i) {
+        auto& chunk = m_data[i];
+        REALM_ASSERT(m_count_before[i] == count_before);
+        count_before += chunk.count;
         REALM_ASSERT(!chunk.data.empty());
         REALM_ASSERT(chunk.data.front().first == chunk.begin);
         REALM_ASSERT(chunk.data.back().second == chunk.end);
@@ -200,9 +231,9 @@ public:
     ChunkedRangeVectorBuilder(ChunkedRangeVector const& expected);
     void push_back(size_t index);
     void push_back(std::pair<size_t, size_t> range);
-    std::vector<ChunkedRangeVector::Chunk> finalize();
+    ChunkedRangeVector::ChunkVector finalize();
 private:
-    std::vector<ChunkedRangeVector::Chunk> m_data;
+    ChunkedRangeVector::ChunkVector m_data;
     size_t m_outer_pos = 0;
 };
 
@@ -241,7 +272,7 @@ void ChunkedRangeVectorBuilder::push_back(std::pair<size_t, size_t> range)
         chunk.end = chunk.data.back().second;
         ++m_outer_pos;
         if (m_outer_pos >= m_data.size())
-            m_data.push_back({{range}, range.first, 0, 1});
+            m_data.push_back({{range}, range.first, 0, range.second - range.first});
         else {
             auto& chunk = m_data[m_outer_pos];
             chunk.data.push_back(range);
@@ -251,7 +282,7 @@ void ChunkedRangeVectorBuilder::push_back(std::pair<size_t, size_t> range)
     }
 }
 
-std::vector<ChunkedRangeVector::Chunk> ChunkedRangeVectorBuilder::finalize()
+ChunkedRangeVector::ChunkVector ChunkedRangeVectorBuilder::finalize()
 {
     if (!m_data.empty()) {
         m_data.resize(m_outer_pos + 1);
@@ -278,45 +309,29 @@ bool IndexSet::contains(size_t index) const
 
 size_t IndexSet::count(size_t start_index, size_t end_index) const
 {
-    auto it = const_cast<IndexSet*>(this)->find(start_index);
-    const auto end = this->end();
-    if (it == end || it->first >= end_index) {
+    if (start_index >= end_index)
         return 0;
-    }
-    if (it->second >= end_index)
-        return std::min(it->second, end_index) - std::max(it->first, start_index);
-
-    size_t ret = 0;
+    return count_before(end_index) - count_before(start_index);
+}
 
-    if (start_index > it->first || it.offset() != 0) {
-        // Start index is in the middle of a chunk, so start by counting the
-        // rest of that chunk
-        ret = it->second - std::max(it->first, start_index);
-        for (++it; it != end && it->second < end_index && it.offset() != 0; ++it) {
-            ret += it->second - it->first;
-        }
-        if (it != end && it->first < end_index && it.offset() != 0)
-            ret += end_index - it->first;
-        if (it == end || it->second >= end_index)
-            return ret;
-    }
+size_t IndexSet::count_before(size_t index) const
+{
+    if (empty())
+        return 0;
 
-    // Now count all complete chunks that fall within the range
-    while (it != end && it.outer()->end <= end_index) {
-        REALM_ASSERT_DEBUG(it.offset() == 0);
-        ret += it.outer()->count;
-        it.next_chunk();
-    }
+    // Find the first chunk which has any indices at or after the target, as
+    // everything before it can be counted with the chunk's running count
+    auto chunk = std::upper_bound(m_data.begin(), m_data.end(), index,
+                                  [](size_t index, auto const& chunk) { return index < chunk.end; });
+    if (chunk == m_data.end())
+        return m_count_before.back() + m_data.back().count;
 
-    // Cound all complete ranges within the last chunk
-    while (it != end && it->second <= end_index) {
-        ret += it->second - it->first;
-        ++it;
+    size_t ret = m_count_before[chunk - m_data.begin()];
+    for (auto range : chunk->data) {
+        if (range.first >= index)
+            break;
+        ret += std::min(range.second, index) - range.first;
     }
-
-    // And finally add in the partial last range
-    if (it != end && it->first < end_index)
-        ret += end_index - it->first;
     return ret;
 }
 
@@ -327,12 +342,12 @@ IndexSet::iterator IndexSet::find(size_t index)
 
 IndexSet::iterator IndexSet::find(size_t index, iterator begin)
 {
-    auto it = std::find_if(begin.outer(), m_data.end(),
-                           [&](auto const& lft) { return lft.end > index; });
+    auto it = std::upper_bound(begin.outer(), m_data.end(), index,
+                               [](size_t index, auto const& chunk) { return index < chunk.end; });
     if (it == m_data.end())
         return end();
     if (index < it->begin)
-        return iterator(it, m_data.end(), &it->data[0]);
+        return iterator(*this, it, &it->data[0]);
     auto inner_begin = it->data.begin();
     if (it == begin.outer())
         inner_begin += begin.offset();
@@ -340,7 +355,7 @@ IndexSet::iterator IndexSet::find(size_t index, iterator begin)
                                   [&](auto const& lft, auto) { return lft.second <= index; });
     REALM_ASSERT_DEBUG(inner != it->data.end());
 
-    return iterator(it, m_data.end(), &*inner);
+    return iterator(*this, it, &*inner);
 }
 
 void IndexSet::add(size_t index)
@@ -358,17 +373,8 @@ void IndexSet::add(IndexSet const& other)
 
 size_t IndexSet::add_shifted(size_t index)
 {
-    iterator it = begin(), end = this->end();
-
-    // Shift for any complete chunks before the target
-    for (; it != end && it.outer()->end <= index; it.next_chunk())
-        index += it.outer()->count;
-
-    // And any ranges within the last partial chunk
-    for (; it != end && it->first <= index; ++it)
-        index += it->second - it->first;
-
-    do_add(it, index);
+    index = shift(index);
+    do_add(find(index), index);
     return index;
 }
 
@@ -413,6 +419,7 @@ void IndexSet::add_shifted_by(IndexSet const& shifted_by, IndexSet const& values
 
     copy(old_it, old_end, std::back_inserter(builder));
     m_data = builder.finalize();
+    rebuild_count_before();
 
 #ifdef REALM_DEBUG
     REALM_ASSERT((size_t)std::distance(as_indexes().begin(), as_indexes().end()) == expected);
@@ -482,6 +489,7 @@ void IndexSet::insert_at(IndexSet const& positions)
         builder.push_back(*begin2);
 
     m_data = builder.finalize();
+    rebuild_count_before();
 }
 
 void IndexSet::shift_for_insert_at(size_t index, size_t count)
@@ -530,6 +538,7 @@ void IndexSet::shift_for_insert_at(realm::IndexSet const& values)
         builder.push_back(*begin1 + shift);
 
     m_data = builder.finalize();
+    rebuild_count_before();
 }
 
 void IndexSet::erase_at(size_t index)
@@ -568,29 +577,17 @@ void IndexSet::erase_at(IndexSet const& positions)
         builder.push_back(*begin1 - shift);
 
     m_data = builder.finalize();
+    rebuild_count_before();
 }
 
 size_t IndexSet::erase_or_unshift(size_t index)
 {
-    auto shifted = index;
-    iterator it = begin(), end = this->end();
-
-    // Shift for any complete chunks before the target
-    for (; it != end && it.outer()->end <= index; it.next_chunk())
-        shifted -= it.outer()->count;
-
-    // And any ranges within the last partial chunk
-    for (; it != end && it->second <= index; ++it)
-        shifted -= it->second - it->first;
-
-    if (it == end)
-        return shifted;
-
-    if (it->first <= index)
-        shifted = npos;
+    auto it = find(index);
+    if (it == end())
+        return index - count_before(index);
 
+    auto shifted = it->first <= index ? npos : index - count_before(index);
     do_erase(it, index);
-
     return shifted;
 }
 
@@ -655,8 +652,26 @@ void IndexSet::remove(realm::IndexSet const& values)
 
 size_t IndexSet::shift(size_t index) const
 {
-    // FIXME: optimize
-    for (auto range : *this) {
+    if (empty())
+        return index;
+
+    // `chunk.begin - count_before` is the first index which would be shifted
+    // by the chunk, and is non-decreasing over the chunks, so the last chunk
+    // which shifts the index can be found with a binary search. All of the
+    // chunks before it shift the index by their full count.
+    size_t low = 0, high = m_data.size();
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (index < m_data[mid].begin - m_count_before[mid])
+            high = mid;
+        else
+            low = mid + 1;
+    }
+    if (low == 0)
+        return index;
+
+    index += m_count_before[low - 1];
+    for (auto range : m_data[low - 1].data) {
         if (range.first > index)
             break;
         index += range.second - range.first;
@@ -667,12 +682,13 @@ size_t IndexSet::shift(size_t index) const
 size_t IndexSet::unshift(size_t index) const
 {
     REALM_ASSERT_DEBUG(!contains(index));
-    return index - count(0, index);
+    return index - count_before(index);
 }
 
 void IndexSet::clear()
 {
     m_data.clear();
+    m_count_before.clear();
 }
 
 IndexSet::iterator IndexSet::do_add(iterator it, size_t index)
@@ -19,6 +19,8 @@
 #ifndef REALM_INDEX_SET_HPP
 #define REALM_INDEX_SET_HPP
 
+#include "util/small_vector.hpp"
+
 #include <cstddef>
 #include <cstdlib>
 #include <initializer_list>
@@ -29,6 +31,7 @@
 
 namespace realm {
 namespace _impl {
+struct ChunkedRangeVector;
 template<typename OuterIterator>
 class MutableChunkedRangeVectorIterator;
 
@@ -75,7 +78,9 @@ private:
 template<typename OuterIterator>
 class MutableChunkedRangeVectorIterator : public ChunkedRangeVectorIterator<OuterIterator> {
 public:
-    using ChunkedRangeVectorIterator<OuterIterator>::ChunkedRangeVectorIterator;
+    using value_type = typename ChunkedRangeVectorIterator<OuterIterator>::value_type;
+
+    MutableChunkedRangeVectorIterator(ChunkedRangeVector& parent, OuterIterator outer, value_type* inner);
 
     // Set this iterator to the given range and update the parent if needed
     void set(size_t begin, size_t end);
@@ -84,17 +89,28 @@ public:
     void adjust(ptrdiff_t front, ptrdiff_t back);
     // Shift this iterator by the given amount and update the parent if needed
     void shift(ptrdiff_t distance);
+
+private:
+    ChunkedRangeVector* m_parent;
 };
 
 // A vector which stores ranges in chunks with a maximum size
+//
+// Most sets hold only a few ranges, so the first chunk and the first few
+// ranges of each chunk are stored inline, and a set with a single chunk of up
+// to four ranges makes no heap allocations at all. Iterators hold pointers
+// into the chunks, and so are invalidated by moving the set.
 struct ChunkedRangeVector {
     struct Chunk {
-        std::vector<std::pair<size_t, size_t>> data;
+        util::SmallVector<std::pair<size_t, size_t>, 4> data;
         size_t begin;
         size_t end;
         size_t count;
     };
-    std::vector<Chunk> m_data;
+    using ChunkVector = util::SmallVector<Chunk, 1>;
+    ChunkVector m_data;
+    // The total count of all of the chunks before each chunk in m_data
+    util::SmallVector<size_t, 1> m_count_before;
 
     using value_type = std::pair<size_t, size_t>;
     using iterator = MutableChunkedRangeVectorIterator<typename decltype(m_data)::iterator>;
@@ -106,8 +122,8 @@ struct ChunkedRangeVector {
     static const size_t max_size = 4096 / sizeof(std::pair<size_t, size_t>);
 #endif
 
-    iterator begin() { return empty() ? end() : iterator(m_data.begin(), m_data.end(), &m_data[0].data[0]); }
-    iterator end() { return iterator(m_data.end(), m_data.end(), nullptr); }
+    iterator begin() { return empty() ? end() : iterator(*this, m_data.begin(), &m_data[0].data[0]); }
+    iterator end() { return iterator(*this, m_data.end(), nullptr); }
     const_iterator begin() const { return cbegin(); }
     const_iterator end() const { return cend(); }
     const_iterator cbegin() const { return empty() ? cend() : const_iterator(m_data.cbegin(), m_data.end(), &m_data[0].data[0]); }
@@ -120,6 +136,12 @@ struct ChunkedRangeVector {
     void push_back(value_type value);
     iterator ensure_space(iterator pos);
 
+    // Update the running counts of the chunks after `chunk` for a change in
+    // the number of indices in `chunk`
+    void adjust_count_before(ChunkVector::iterator chunk, ptrdiff_t delta);
+    // Recalculate all of the running counts after replacing m_data
+    void rebuild_count_before();
+
     void verify() const noexcept;
 };
 } // namespace _impl
@@ -246,6 +268,8 @@ private:
     iterator do_add(iterator pos, size_t index);
     void do_erase(iterator it, size_t index);
     iterator do_remove(iterator it, size_t index, size_t count);
+    // Count the number of indices in the set which are less than the index
+    size_t count_before(size_t index) const;
 
     void shift_until_end_by(iterator begin, ptrdiff_t shift);
 };
@@ -319,6 +343,13 @@ inline void ChunkedRangeVectorIterator<T>::next_chunk()
     ++m_outer;
     m_inner = m_outer != m_end ? &m_outer->data[0] : nullptr;
 }
+
+template<typename T>
+inline MutableChunkedRangeVectorIterator<T>::MutableChunkedRangeVectorIterator(ChunkedRangeVector& parent, T outer, value_type* inner)
+: ChunkedRangeVectorIterator<T>(outer, parent.m_data.end(), inner)
+, m_parent(&parent)
+{
+}
 } // namespace _impl
 
 } // namespace realm
@@ -214,14 +214,25 @@ size_t hash<realm::List>::operator()(realm::List const& list) const
 }
 }
 
-NotificationToken List::add_notification_callback(CollectionChangeCallback cb)
+void List::prepare_notifier()
 {
     verify_attached();
     if (!m_notifier) {
         m_notifier = std::make_shared<ListNotifier>(m_link_view, m_realm);
         RealmCoordinator::register_notifier(m_notifier);
     }
-    return {m_notifier, m_notifier->add_callback(std::move(cb))};
+}
+
+NotificationToken List::add_notification_callback(CollectionChangeCallback cb, KeyPathArray key_paths)
+{
+    prepare_notifier();
+    return {m_notifier, m_notifier->add_callback(std::move(cb), std::move(key_paths))};
+}
+
+NotificationToken List::add_notification_callback(SharedCollectionChangeCallback cb, KeyPathArray key_paths)
+{
+    prepare_notifier();
+    return {m_notifier, m_notifier->add_callback(std::move(cb), std::move(key_paths))};
 }
 
 List::OutOfBoundsIndexException::OutOfBoundsIndexException(size_t r, size_t c)
@@ -81,7 +81,8 @@ public:
 
     bool operator==(List const& rgt) const noexcept;
 
-    NotificationToken add_notification_callback(CollectionChangeCallback cb);
+    NotificationToken add_notification_callback(CollectionChangeCallback cb, KeyPathArray key_paths = {});
+    NotificationToken add_notification_callback(SharedCollectionChangeCallback cb, KeyPathArray key_paths = {});
 
     // These are implemented in object_accessor.hpp
     template <typename ValueType, typename ContextType>
@@ -116,6 +117,7 @@ private:
     _impl::CollectionNotifier::Handle<_impl::CollectionNotifier> m_notifier;
 
     void verify_valid_row(size_t row_ndx, bool insertion = false) const;
+    void prepare_notifier();
 
     friend struct std::hash<List>;
 };
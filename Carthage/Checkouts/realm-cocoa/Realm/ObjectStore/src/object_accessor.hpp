@@ -27,7 +27,11 @@
 #include "shared_realm.hpp"
 #include "util/format.hpp"
 
+#include <algorithm>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <realm/link_view.hpp>
 #include <realm/table_view.hpp>
 
@@ -44,10 +48,23 @@ namespace realm {
         template<typename ValueType, typename ContextType>
         inline ValueType get_property_value(ContextType ctx, std::string prop_name);
 
+        // property getter/setter for a property handle obtained from this object's ObjectSchema
+        template<typename ValueType, typename ContextType>
+        inline void set_property_value(ContextType ctx, ObjectSchema::PropertyHandle prop, ValueType value, bool try_update);
+
+        template<typename ValueType, typename ContextType>
+        inline ValueType get_property_value(ContextType ctx, ObjectSchema::PropertyHandle prop);
+
         // create an Object from a native representation
         template<typename ValueType, typename ContextType>
         static inline Object create(ContextType ctx, SharedRealm realm, const ObjectSchema &object_schema, ValueType value, bool try_update);
 
+        // create or update Objects for each of a batch of native representations
+        // returns the row index of the object for each of the values
+        template<typename ValueType, typename ContextType>
+        static inline std::vector<size_t> create_all(ContextType ctx, SharedRealm realm, const ObjectSchema &object_schema,
+                                                     std::vector<ValueType> const& values, bool try_update);
+
         template<typename ValueType, typename ContextType>
         static Object get_for_primary_key(ContextType ctx, SharedRealm realm, const ObjectSchema &object_schema, ValueType primary_value);
 
@@ -69,6 +86,11 @@ namespace realm {
 
         template<typename ValueType, typename ContextType>
         static size_t get_for_primary_key_impl(ContextType ctx, const ConstTableRef &table, const Property &primary_prop, ValueType primary_value);
+
+        template<typename ValueType, typename ContextType, typename HasDefault>
+        inline void populate(ContextType ctx, ValueType value, bool created, bool try_update, HasDefault&& has_default);
+
+        static inline bool links_to_own_type(const Schema &schema, const ObjectSchema &object_schema);
         
         inline void verify_attached();
     };
@@ -187,6 +209,18 @@ namespace realm {
         return get_property_value_impl<ValueType>(ctx, *prop);
     }
 
+    template <typename ValueType, typename ContextType>
+    inline void Object::set_property_value(ContextType ctx, ObjectSchema::PropertyHandle prop, ValueType value, bool try_update)
+    {
+        set_property_value_impl(ctx, m_object_schema->property_for_handle(prop), value, try_update);
+    }
+
+    template <typename ValueType, typename ContextType>
+    inline ValueType Object::get_property_value(ContextType ctx, ObjectSchema::PropertyHandle prop)
+    {
+        return get_property_value_impl<ValueType>(ctx, m_object_schema->property_for_handle(prop));
+    }
+
     template <typename ValueType, typename ContextType>
     inline void Object::set_property_value_impl(ContextType ctx, const Property &property, ValueType value, bool try_update)
     {
@@ -350,26 +384,123 @@ namespace realm {
 
         // populate
         Object object(realm, object_schema, table->get(row_index));
-        for (const Property& prop : object_schema.persisted_properties) {
+        object.populate(ctx, value, created, try_update, [&](const Property& prop) {
+            return Accessor::has_default_value_for_property(ctx, realm.get(), object_schema, prop.name);
+        });
+        return object;
+    }
+
+    template<typename ValueType, typename ContextType>
+    inline std::vector<size_t> Object::create_all(ContextType ctx, SharedRealm realm, const ObjectSchema &object_schema,
+                                                  std::vector<ValueType> const& values, bool try_update)
+    {
+        using Accessor = NativeAccessor<ValueType, ContextType>;
+
+        if (!realm->is_in_transaction()) {
+            throw MutationOutsideTransactionException("Can only create objects within a transaction.");
+        }
+
+        realm::TableRef table = ObjectStore::table_for_object_type(realm->read_group(), object_schema.name);
+        const Property *primary_prop = object_schema.primary_key_property();
+
+        // Populating an object can create objects of the same type from nested
+        // values, whose primary key lookups need to see every earlier object in
+        // the batch fully populated and none of the later ones, so fall back to
+        // creating the objects one at a time
+        if (primary_prop && links_to_own_type(realm->schema(), object_schema)) {
+            std::vector<size_t> rows;
+            rows.reserve(values.size());
+            for (auto& value : values)
+                rows.push_back(create(ctx, realm, object_schema, value, try_update).row().get_index());
+            return rows;
+        }
+
+        std::vector<size_t> rows(values.size(), realm::not_found);
+        std::vector<bool> created(values.size(), true);
+        // index of the earlier value in the batch which has the same primary key
+        std::vector<size_t> duplicate_of;
+
+        if (primary_prop) {
+            // Look up all of the existing objects before creating any rows
+            std::unordered_map<int64_t, size_t> int_keys;
+            std::unordered_map<std::string, size_t> string_keys;
+            duplicate_of.resize(values.size(), realm::npos);
+            for (size_t i = 0; i < values.size(); ++i) {
+                ValueType primary_value = Accessor::dict_value_for_key(ctx, values[i], object_schema.primary_key);
+
+                size_t first_with_key;
+                if (primary_prop->type == PropertyType::String)
+                    first_with_key = string_keys.emplace(Accessor::to_string(ctx, primary_value), i).first->second;
+                else
+                    first_with_key = int_keys.emplace(Accessor::to_long(ctx, primary_value), i).first->second;
+                if (first_with_key == i)
+                    rows[i] = get_for_primary_key_impl(ctx, table, *primary_prop, primary_value);
+
+                if (first_with_key != i || rows[i] != realm::not_found) {
+                    if (!try_update) {
+                        throw std::logic_error(util::format("Attempting to create an object of type '%1' with an existing primary key value.", object_schema.name));
+                    }
+                    created[i] = false;
+                    if (first_with_key != i)
+                        duplicate_of[i] = first_with_key;
+                }
+            }
+        }
+
+        // Create all of the new rows at once
+        size_t new_rows = std::count(created.begin(), created.end(), true);
+        size_t row_index = new_rows ? table->add_empty_row(new_rows) : 0;
+        for (size_t i = 0; i < values.size(); ++i) {
+            if (created[i])
+                rows[i] = row_index++;
+            else if (duplicate_of.size() && duplicate_of[i] != realm::npos)
+                rows[i] = rows[duplicate_of[i]];
+        }
+
+        // Whether or not each property has a default value is checked at most
+        // once for the whole batch
+        enum class Default : char { Unknown, Yes, No };
+        std::vector<Default> has_default(object_schema.persisted_properties.size(), Default::Unknown);
+        auto check_default = [&](const Property& prop) {
+            auto& cached = has_default[&prop - object_schema.persisted_properties.data()];
+            if (cached == Default::Unknown) {
+                cached = Accessor::has_default_value_for_property(ctx, realm.get(), object_schema, prop.name)
+                       ? Default::Yes : Default::No;
+            }
+            return cached == Default::Yes;
+        };
+
+        for (size_t i = 0; i < values.size(); ++i) {
+            Object object(realm, object_schema, table->get(rows[i]));
+            object.populate(ctx, values[i], created[i], try_update, check_default);
+        }
+        return rows;
+    }
+
+    template<typename ValueType, typename ContextType, typename HasDefault>
+    inline void Object::populate(ContextType ctx, ValueType value, bool created, bool try_update, HasDefault&& has_default)
+    {
+        using Accessor = NativeAccessor<ValueType, ContextType>;
+
+        for (const Property& prop : m_object_schema->persisted_properties) {
             if (created || !prop.is_primary) {
                 if (Accessor::dict_has_value_for_key(ctx, value, prop.name)) {
-                    object.set_property_value_impl(ctx, prop, Accessor::dict_value_for_key(ctx, value, prop.name), try_update);
+                    set_property_value_impl(ctx, prop, Accessor::dict_value_for_key(ctx, value, prop.name), try_update);
                 }
                 else if (created) {
-                    if (Accessor::has_default_value_for_property(ctx, realm.get(), object_schema, prop.name)) {
-                        object.set_property_value_impl(ctx, prop, Accessor::default_value_for_property(ctx, realm.get(), object_schema, prop.name), try_update);
+                    if (has_default(prop)) {
+                        set_property_value_impl(ctx, prop, Accessor::default_value_for_property(ctx, m_realm.get(), *m_object_schema, prop.name), try_update);
                     }
                     else if (prop.is_nullable || prop.type == PropertyType::Array) {
-                        object.set_property_value_impl(ctx, prop, Accessor::null_value(ctx), try_update);
+                        set_property_value_impl(ctx, prop, Accessor::null_value(ctx), try_update);
                     }
                     else {
-                        throw MissingPropertyValueException(object_schema.name, prop.name,
+                        throw MissingPropertyValueException(m_object_schema->name, prop.name,
                             "Missing property value for property " + prop.name);
                     }
                 }
             }
         }
-        return object;
     }
 
     template<typename ValueType, typename ContextType>
@@ -399,6 +530,28 @@ namespace realm {
         }
     }
 
+    inline bool Object::links_to_own_type(const Schema &schema, const ObjectSchema &object_schema)
+    {
+        std::vector<const ObjectSchema*> pending = {&object_schema};
+        std::unordered_set<std::string> visited;
+        while (!pending.empty()) {
+            auto current = pending.back();
+            pending.pop_back();
+            for (auto& prop : current->persisted_properties) {
+                if (prop.type != PropertyType::Object && prop.type != PropertyType::Array)
+                    continue;
+                if (prop.object_type == object_schema.name)
+                    return true;
+                if (visited.insert(prop.object_type).second) {
+                    auto it = schema.find(prop.object_type);
+                    if (it != schema.end())
+                        pending.push_back(&*it);
+                }
+            }
+        }
+        return false;
+    }
+
     inline void Object::verify_attached() {
         if (!m_row.is_attached()) {
             throw InvalidatedObjectException(m_object_schema->name,
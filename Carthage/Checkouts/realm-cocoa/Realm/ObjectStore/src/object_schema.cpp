@@ -56,6 +56,7 @@ ObjectSchema::ObjectSchema(std::string name, std::initializer_list<Property> per
             primary_key = prop.name;
         }
     }
+    update_property_index();
 }
 
 ObjectSchema::ObjectSchema(Group const& group, StringData name, size_t index) : name(name) {
@@ -83,23 +84,87 @@ ObjectSchema::ObjectSchema(Group const& group, StringData name, size_t index) :
         }
         persisted_properties.push_back(std::move(property));
     }
+    update_property_index();
 
     primary_key = realm::ObjectStore::get_primary_key_for_object(group, name);
     set_primary_key_property();
 }
 
-Property *ObjectSchema::property_for_name(StringData name) {
-    for (auto& prop : persisted_properties) {
-        if (StringData(prop.name) == name) {
-            return &prop;
-        }
+static uint32_t hash_property_name(StringData name) noexcept
+{
+    // 32-bit FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < name.size(); ++i) {
+        hash ^= static_cast<unsigned char>(name[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void ObjectSchema::update_property_index()
+{
+    size_t count = persisted_properties.size() + computed_properties.size();
+
+    // Keep the load factor at or below one half so that probe sequences stay short
+    size_t capacity = 4;
+    while (capacity < count * 2)
+        capacity *= 2;
+    m_property_index.assign(capacity, IndexSlot{0, 0});
+
+    size_t mask = capacity - 1;
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t hash = hash_property_name(property_for_handle({i}).name);
+        size_t slot = hash & mask;
+        while (m_property_index[slot].position)
+            slot = (slot + 1) & mask;
+        m_property_index[slot] = {hash, static_cast<uint32_t>(i + 1)};
     }
-    for (auto& prop : computed_properties) {
-        if (StringData(prop.name) == name) {
-            return &prop;
+}
+
+ObjectSchema::PropertyHandle ObjectSchema::property_handle_for_name(StringData name) const
+{
+    size_t count = persisted_properties.size() + computed_properties.size();
+
+    if (!m_property_index.empty()) {
+        uint32_t hash = hash_property_name(name);
+        size_t mask = m_property_index.size() - 1;
+        for (size_t slot = hash & mask; m_property_index[slot].position; slot = (slot + 1) & mask) {
+            auto& entry = m_property_index[slot];
+            if (entry.hash != hash)
+                continue;
+            // The property vectors may have been modified since the index was
+            // built, so the entry has to be checked against the actual property
+            size_t index = entry.position - 1;
+            if (index < count && StringData(property_for_handle({index}).name) == name)
+                return {index};
         }
     }
-    return nullptr;
+
+    // Not finding the property in the index is only conclusive if nothing
+    // has been modified since it was built, which we can't know
+    for (size_t i = 0; i < count; ++i) {
+        if (StringData(property_for_handle({i}).name) == name)
+            return {i};
+    }
+    return {};
+}
+
+Property& ObjectSchema::property_for_handle(PropertyHandle handle)
+{
+    REALM_ASSERT_DEBUG(handle);
+    if (handle.index < persisted_properties.size())
+        return persisted_properties[handle.index];
+    return computed_properties[handle.index - persisted_properties.size()];
+}
+
+const Property& ObjectSchema::property_for_handle(PropertyHandle handle) const
+{
+    return const_cast<ObjectSchema *>(this)->property_for_handle(handle);
+}
+
+Property *ObjectSchema::property_for_name(StringData name) {
+    auto handle = property_handle_for_name(name);
+    return handle ? &property_for_handle(handle) : nullptr;
 }
 
 const Property *ObjectSchema::property_for_name(StringData name) const {
@@ -21,6 +21,7 @@
 
 #include <realm/string_data.hpp>
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -45,6 +46,19 @@ public:
     std::vector<Property> computed_properties;
     std::string primary_key;
 
+    // A property resolved by name which can be used to repeatedly look up the
+    // property without comparing names. Handles are valid for this
+    // ObjectSchema and copies of it for as long as the properties are not
+    // added, removed or reordered.
+    struct PropertyHandle {
+        size_t index = -1;
+        explicit operator bool() const noexcept { return index != size_t(-1); }
+    };
+
+    PropertyHandle property_handle_for_name(StringData name) const;
+    Property& property_for_handle(PropertyHandle handle);
+    const Property& property_for_handle(PropertyHandle handle) const;
+
     Property *property_for_name(StringData name);
     const Property *property_for_name(StringData name) const;
     Property *primary_key_property() {
@@ -56,9 +70,23 @@ public:
 
     void validate(Schema const& schema, std::vector<ObjectSchemaValidationException>& exceptions) const;
 
+    // Rebuild the name index used by property_for_name() after modifying
+    // persisted_properties or computed_properties directly. Lookups remain
+    // correct without doing so, but may fall back to a linear scan.
+    void update_property_index();
+
     friend bool operator==(ObjectSchema const& a, ObjectSchema const& b);
 
 private:
+    // Open-addressing hash table over the combined list of persisted and then
+    // computed properties. A position of zero marks an empty slot, and other
+    // positions are one greater than the index of the property.
+    struct IndexSlot {
+        uint32_t hash;
+        uint32_t position;
+    };
+    std::vector<IndexSlot> m_property_index;
+
     void set_primary_key_property();
 };
 }
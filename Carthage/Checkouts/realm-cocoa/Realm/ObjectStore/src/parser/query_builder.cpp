@@ -77,41 +77,74 @@ struct FalseExpression : realm::Expression {
 };
 
 using KeyPath = std::vector<std::string>;
+// Split on '.' the same way std::getline() would: an empty string has no
+// components and a trailing '.' doesn't add an empty one
 KeyPath key_path_from_string(const std::string &s) {
-    std::stringstream ss(s);
-    std::string item;
     KeyPath key_path;
-    while (std::getline(ss, item, '.')) {
-        key_path.push_back(item);
+    size_t start = 0;
+    while (start < s.size()) {
+        size_t end = s.find('.', start);
+        if (end == std::string::npos) {
+            end = s.size();
+        }
+        key_path.push_back(s.substr(start, end - start));
+        start = end + 1;
     }
     return key_path;
 }
 
-struct PropertyExpression
+CompiledPredicate::KeyPath resolve_key_path(const Schema &schema, Schema::const_iterator desc, const std::string &key_path_string)
 {
+    precondition(desc != schema.end(), "Object type not found in schema");
+
+    KeyPath key_path = key_path_from_string(key_path_string);
+    CompiledPredicate::KeyPath resolved;
     const Property *prop = nullptr;
-    std::vector<size_t> indexes;
-    std::function<Table *()> table_getter;
+    for (size_t index = 0; index < key_path.size(); index++) {
+        if (prop) {
+            precondition(prop->type == PropertyType::Object || prop->type == PropertyType::Array,
+                         util::format("Property '%1' is not a link in object of type '%2'", key_path[index], desc->name));
+            resolved.link_columns.push_back(prop->table_column);
 
-    PropertyExpression(Query &query, const Schema &schema, Schema::const_iterator desc, const std::string &key_path_string)
-    {
-        KeyPath key_path = key_path_from_string(key_path_string);
-        for (size_t index = 0; index < key_path.size(); index++) {
-            if (prop) {
-                precondition(prop->type == PropertyType::Object || prop->type == PropertyType::Array,
-                             util::format("Property '%1' is not a link in object of type '%2'", key_path[index], desc->name));
-                indexes.push_back(prop->table_column);
+        }
+        prop = desc->property_for_name(key_path[index]);
+        precondition(prop != nullptr,
+                     util::format("No property '%1' on object of type '%2'", key_path[index], desc->name));
 
-            }
-            prop = desc->property_for_name(key_path[index]);
-            precondition(prop != nullptr,
-                         util::format("No property '%1' on object of type '%2'", key_path[index], desc->name));
+        if (prop->object_type.size()) {
+            desc = schema.find(prop->object_type);
+        }
+    }
+    resolved.property = *prop;
+    return resolved;
+}
 
-            if (prop->object_type.size()) {
-                desc = schema.find(prop->object_type);
+// Resolve every key path used in the predicate which hasn't already been resolved
+void resolve_key_paths(const Predicate &pred, const Schema &schema, Schema::const_iterator desc,
+                       std::unordered_map<std::string, CompiledPredicate::KeyPath> &key_paths)
+{
+    if (pred.type == Predicate::Type::Comparison) {
+        for (auto &expr : pred.cmpr.expr) {
+            if (expr.type == parser::Expression::Type::KeyPath && !key_paths.count(expr.s)) {
+                key_paths.emplace(expr.s, resolve_key_path(schema, desc, expr.s));
             }
         }
+    }
+    for (auto &sub : pred.cpnd.sub_predicates) {
+        resolve_key_paths(sub, schema, desc, key_paths);
+    }
+}
+
+struct PropertyExpression
+{
+    const Property *prop = nullptr;
+    std::vector<size_t> indexes;
+    std::function<Table *()> table_getter;
 
+    PropertyExpression(Query &query, const CompiledPredicate::KeyPath &key_path)
+    : prop(&key_path.property)
+    , indexes(key_path.link_columns)
+    {
         table_getter = [&] {
             auto& tbl = query.get_table();
             for (size_t col : indexes) {
@@ -521,13 +554,12 @@ bool expression_is_null(const parser::Expression &expr, Arguments &args) {
     return false;
 }
 
-void add_comparison_to_query(Query &query, const Predicate &pred, Arguments &args, const Schema &schema, const std::string &type)
+void add_comparison_to_query(Query &query, const Predicate &pred, Arguments &args, const CompiledPredicate &compiled)
 {
     const Predicate::Comparison &cmpr = pred.cmpr;
     auto t0 = cmpr.expr[0].type, t1 = cmpr.expr[1].type;
-    auto object_schema = schema.find(type);
     if (t0 == parser::Expression::Type::KeyPath && t1 != parser::Expression::Type::KeyPath) {
-        PropertyExpression expr(query, schema, object_schema, cmpr.expr[0].s);
+        PropertyExpression expr(query, compiled.key_paths.at(cmpr.expr[0].s));
         if (expression_is_null(cmpr.expr[1], args)) {
             do_add_null_comparison_to_query(query, cmpr, expr);
         }
@@ -536,7 +568,7 @@ void add_comparison_to_query(Query &query, const Predicate &pred, Arguments &arg
         }
     }
     else if (t0 != parser::Expression::Type::KeyPath && t1 == parser::Expression::Type::KeyPath) {
-        PropertyExpression expr(query, schema, object_schema, cmpr.expr[1].s);
+        PropertyExpression expr(query, compiled.key_paths.at(cmpr.expr[1].s));
         if (expression_is_null(cmpr.expr[0], args)) {
             do_add_null_comparison_to_query(query, cmpr, expr);
         }
@@ -549,7 +581,7 @@ void add_comparison_to_query(Query &query, const Predicate &pred, Arguments &arg
     }
 }
 
-void update_query_with_predicate(Query &query, const Predicate &pred, Arguments &arguments, const Schema &schema, const std::string &type)
+void update_query_with_predicate(Query &query, const Predicate &pred, Arguments &arguments, const CompiledPredicate &compiled)
 {
     if (pred.negate) {
         query.Not();
@@ -559,7 +591,7 @@ void update_query_with_predicate(Query &query, const Predicate &pred, Arguments
         case Predicate::Type::And:
             query.group();
             for (auto &sub : pred.cpnd.sub_predicates) {
-                update_query_with_predicate(query, sub, arguments, schema, type);
+                update_query_with_predicate(query, sub, arguments, compiled);
             }
             if (!pred.cpnd.sub_predicates.size()) {
                 query.and_query(std::unique_ptr<realm::Expression>(new TrueExpression));
@@ -571,7 +603,7 @@ void update_query_with_predicate(Query &query, const Predicate &pred, Arguments
             query.group();
             for (auto &sub : pred.cpnd.sub_predicates) {
                 query.Or();
-                update_query_with_predicate(query, sub, arguments, schema, type);
+                update_query_with_predicate(query, sub, arguments, compiled);
             }
             if (!pred.cpnd.sub_predicates.size()) {
                 query.and_query(std::unique_ptr<realm::Expression>(new FalseExpression));
@@ -580,7 +612,7 @@ void update_query_with_predicate(Query &query, const Predicate &pred, Arguments
             break;
 
         case Predicate::Type::Comparison: {
-            add_comparison_to_query(query, pred, arguments, schema, type);
+            add_comparison_to_query(query, pred, arguments, compiled);
             break;
         }
         case Predicate::Type::True:
@@ -600,14 +632,93 @@ void update_query_with_predicate(Query &query, const Predicate &pred, Arguments
 namespace realm {
 namespace query_builder {
 
+CompiledPredicate::CompiledPredicate(Predicate pred, const Schema &schema, const std::string &objectType)
+: predicate(std::move(pred))
+{
+    resolve_key_paths(predicate, schema, schema.find(objectType), key_paths);
+}
+
 void apply_predicate(Query &query, const Predicate &predicate, Arguments &arguments, const Schema &schema, const std::string &objectType)
 {
-    update_query_with_predicate(query, predicate, arguments, schema, objectType);
+    apply_predicate(query, CompiledPredicate(predicate, schema, objectType), arguments);
+}
+
+void apply_predicate(Query &query, const CompiledPredicate &predicate, Arguments &arguments)
+{
+    update_query_with_predicate(query, predicate.predicate, arguments, predicate);
 
     // Test the constructed query in core
     std::string validateMessage = query.validate();
     precondition(validateMessage.empty(), validateMessage.c_str());
 }
 
+PredicateCache::PredicateCache(size_t capacity)
+: m_capacity(capacity)
+{
+}
+
+std::shared_ptr<const CompiledPredicate> PredicateCache::get(const std::string &query, const std::string &objectType,
+                                                             const Schema &schema, uint64_t schemaVersion)
+{
+    Key key{query, objectType, schemaVersion};
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_index.find(key);
+        if (it != m_index.end()) {
+            ++m_hits;
+            m_entries.splice(m_entries.begin(), m_entries, it->second);
+            return it->second->second;
+        }
+        ++m_misses;
+    }
+
+    // Parse and resolve without holding the lock as this is the expensive
+    // part. If another thread compiles the same predicate concurrently the
+    // first one to finish is kept.
+    auto compiled = std::make_shared<const CompiledPredicate>(parser::parse(query), schema, objectType);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+        return it->second->second;
+    }
+    if (m_capacity == 0) {
+        return compiled;
+    }
+    if (m_entries.size() >= m_capacity) {
+        m_index.erase(m_entries.back().first);
+        m_entries.pop_back();
+    }
+    m_entries.emplace_front(std::move(key), compiled);
+    m_index.emplace(m_entries.front().first, m_entries.begin());
+    return compiled;
+}
+
+size_t PredicateCache::hits() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hits;
+}
+
+size_t PredicateCache::misses() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_misses;
+}
+
+void PredicateCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_index.clear();
+    m_entries.clear();
+}
+
+size_t PredicateCache::KeyHash::operator()(const Key &key) const
+{
+    size_t hash = std::hash<std::string>()(key.query);
+    hash = hash * 31 + std::hash<std::string>()(key.object_type);
+    return hash * 31 + std::hash<uint64_t>()(key.schema_version);
+}
+
 }
 }
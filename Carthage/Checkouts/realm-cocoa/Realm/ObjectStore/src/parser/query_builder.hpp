@@ -21,6 +21,12 @@
 
 #include "parser.hpp"
 #include "object_accessor.hpp"
+#include "property.hpp"
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 namespace realm {
 class Query;
@@ -32,6 +38,70 @@ class Arguments;
 void apply_predicate(Query &query, const parser::Predicate &predicate, Arguments &arguments,
                      const Schema &schema, const std::string &objectType);
 
+// A parsed predicate along with the properties each of its key paths refer to,
+// so that it can be applied to queries repeatedly with only the arguments
+// needing to be converted each time
+struct CompiledPredicate {
+    // A key path resolved to the property it refers to and the columns of the
+    // links which have to be followed to reach that property
+    struct KeyPath {
+        Property property;
+        std::vector<size_t> link_columns;
+    };
+
+    parser::Predicate predicate;
+    std::unordered_map<std::string, KeyPath> key_paths;
+
+    CompiledPredicate(parser::Predicate predicate, const Schema &schema, const std::string &objectType);
+};
+
+void apply_predicate(Query &query, const CompiledPredicate &predicate, Arguments &arguments);
+
+// A thread-safe cache of compiled predicates keyed on the query string, object
+// type and schema version, which discards the least recently used predicate
+// once it holds `capacity` of them. The resolved key paths include column
+// indices and the key doesn't include the Realm file, so a cache must only be
+// used for a single file; RealmCoordinator::predicate_cache() is the one for
+// each file.
+class PredicateCache {
+  public:
+    PredicateCache(size_t capacity=256);
+
+    // Get the compiled form of `query`, parsing and compiling it if needed
+    std::shared_ptr<const CompiledPredicate> get(const std::string &query, const std::string &objectType,
+                                                 const Schema &schema, uint64_t schemaVersion);
+
+    // The number of calls to get() which did and did not find a cached predicate
+    size_t hits() const;
+    size_t misses() const;
+
+    void clear();
+
+  private:
+    struct Key {
+        std::string query;
+        std::string object_type;
+        uint64_t schema_version;
+
+        bool operator==(const Key &other) const
+        {
+            return schema_version == other.schema_version && query == other.query && object_type == other.object_type;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key &key) const;
+    };
+    using Entry = std::pair<Key, std::shared_ptr<const CompiledPredicate>>;
+
+    mutable std::mutex m_mutex;
+    size_t m_capacity;
+    // Ordered from most to least recently used
+    std::list<Entry> m_entries;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> m_index;
+    size_t m_hits = 0;
+    size_t m_misses = 0;
+};
+
 class Arguments {
   public:
     virtual bool bool_for_argument(size_t argument_index) = 0;
@@ -26,10 +26,53 @@
 #include "util/compiler.hpp"
 #include "util/format.hpp"
 
+#include <algorithm>
 #include <stdexcept>
 
 using namespace realm;
 
+namespace {
+// Calculates aggregates over the rows inside the window of a Results, with the
+// same interface as TableView so that it can be used with the same getters
+class WindowAggregator {
+public:
+    WindowAggregator(Table const& table, std::vector<size_t> rows)
+    : m_table(table), m_rows(std::move(rows)) { }
+
+    size_t size() const { return m_rows.size(); }
+
+    util::Optional<Mixed> maximum_int(size_t column) const { return calculate(column).max; }
+    util::Optional<Mixed> maximum_float(size_t column) const { return calculate(column).max; }
+    util::Optional<Mixed> maximum_double(size_t column) const { return calculate(column).max; }
+    util::Optional<Mixed> maximum_timestamp(size_t column) const { return calculate(column).max; }
+
+    util::Optional<Mixed> minimum_int(size_t column) const { return calculate(column).min; }
+    util::Optional<Mixed> minimum_float(size_t column) const { return calculate(column).min; }
+    util::Optional<Mixed> minimum_double(size_t column) const { return calculate(column).min; }
+    util::Optional<Mixed> minimum_timestamp(size_t column) const { return calculate(column).min; }
+
+    util::Optional<Mixed> sum_int(size_t column) const { return calculate(column).sum; }
+    util::Optional<Mixed> sum_float(size_t column) const { return calculate(column).sum; }
+    util::Optional<Mixed> sum_double(size_t column) const { return calculate(column).sum; }
+
+    util::Optional<Mixed> average_int(size_t column) const { return calculate(column).average; }
+    util::Optional<Mixed> average_float(size_t column) const { return calculate(column).average; }
+    util::Optional<Mixed> average_double(size_t column) const { return calculate(column).average; }
+
+private:
+    Table const& m_table;
+    std::vector<size_t> m_rows;
+
+    _impl::AggregateValues calculate(size_t column) const
+    {
+        auto tracker = _impl::AggregateTracker::create(m_table, column);
+        REALM_ASSERT(tracker);
+        tracker->reset(m_table, m_rows);
+        return tracker->values();
+    }
+};
+} // anonymous namespace
+
 Results::Results() = default;
 Results::~Results() = default;
 
@@ -82,6 +125,9 @@ Results::Results(Results&& other)
 , m_link_view(std::move(other.m_link_view))
 , m_table(other.m_table)
 , m_sort(std::move(other.m_sort))
+, m_window_offset(other.m_window_offset)
+, m_window_count(other.m_window_count)
+, m_table_view_index(std::move(other.m_table_view_index))
 , m_notifier(std::move(other.m_notifier))
 , m_mode(other.m_mode)
 , m_update_policy(other.m_update_policy)
@@ -125,6 +171,32 @@ void Results::validate_write() const
         throw InvalidTransactionException("Must be in a write transaction");
 }
 
+size_t Results::window_end() const noexcept
+{
+    if (m_window_count > npos - m_window_offset)
+        return npos;
+    return m_window_offset + m_window_count;
+}
+
+size_t Results::window_size(size_t view_size) const noexcept
+{
+    if (view_size <= m_window_offset)
+        return 0;
+    return std::min(view_size - m_window_offset, m_window_count);
+}
+
+std::vector<size_t> Results::window_rows() const
+{
+    std::vector<size_t> rows;
+    size_t end = m_window_offset + window_size(m_table_view.size());
+    rows.reserve(end - std::min(m_window_offset, end));
+    for (size_t i = m_window_offset; i < end; ++i) {
+        if (m_table_view.is_row_attached(i))
+            rows.push_back(m_table_view.get_source_ndx(i));
+    }
+    return rows;
+}
+
 size_t Results::size()
 {
     validate_read();
@@ -134,10 +206,10 @@ size_t Results::size()
         case Mode::LinkView: return m_link_view->size();
         case Mode::Query:
             m_query.sync_view_if_needed();
-            return m_query.count();
+            return window_size(m_query.count(0, npos, window_end()));
         case Mode::TableView:
             update_tableview();
-            return m_table_view.size();
+            return window_size(m_table_view.size());
     }
     REALM_UNREACHABLE();
 }
@@ -185,8 +257,9 @@ RowExpr Results::get(size_t row_ndx)
         case Mode::Query:
         case Mode::TableView:
             update_tableview();
-            if (row_ndx >= m_table_view.size())
+            if (row_ndx >= window_size(m_table_view.size()))
                 break;
+            row_ndx += m_window_offset;
             if (m_update_policy == UpdatePolicy::Never && !m_table_view.is_row_attached(row_ndx))
                 return {};
             return m_table_view.get(row_ndx);
@@ -210,7 +283,9 @@ util::Optional<RowExpr> Results::first()
         case Mode::Query:
         case Mode::TableView:
             update_tableview();
-            return m_table_view.size() == 0 ? util::none : util::make_optional(m_table_view.front());
+            if (window_size(m_table_view.size()) == 0)
+                return util::none;
+            return util::make_optional(m_table_view.get(m_window_offset));
     }
     REALM_UNREACHABLE();
 }
@@ -230,7 +305,9 @@ util::Optional<RowExpr> Results::last()
         case Mode::Query:
         case Mode::TableView:
             update_tableview();
-            return m_table_view.size() == 0 ? util::none : util::make_optional(m_table_view.back());
+            if (size_t size = window_size(m_table_view.size()))
+                return util::make_optional(m_table_view.get(m_window_offset + size - 1));
+            return util::none;
     }
     REALM_UNREACHABLE();
 }
@@ -262,10 +339,13 @@ void Results::update_tableview(bool wants_notifications)
             return;
         case Mode::Query:
             m_query.sync_view_if_needed();
-            m_table_view = m_query.find_all();
+            // Without a sort the rows past the end of the window can't end up
+            // inside it, so the query can stop once the window is filled
+            m_table_view = m_sort ? m_query.find_all() : m_query.find_all(0, npos, window_end());
             if (m_sort) {
                 m_table_view.sort(m_sort);
             }
+            m_table_view_index.clear();
             m_mode = Mode::TableView;
             break;
         case Mode::TableView:
@@ -274,6 +354,8 @@ void Results::update_tableview(bool wants_notifications)
                 _impl::RealmCoordinator::register_notifier(m_notifier);
             }
             m_has_used_table_view = true;
+            if (!m_table_view.is_in_sync())
+                m_table_view_index.clear();
             m_table_view.sync_if_needed();
             break;
     }
@@ -310,11 +392,39 @@ size_t Results::index_of(size_t row_ndx)
         case Mode::Query:
         case Mode::TableView:
             update_tableview();
-            return m_table_view.find_by_source_ndx(row_ndx);
+            size_t ndx = find_in_table_view(row_ndx);
+            if (ndx == not_found || ndx < m_window_offset || ndx - m_window_offset >= m_window_count)
+                return not_found;
+            return ndx - m_window_offset;
     }
     REALM_UNREACHABLE();
 }
 
+size_t Results::find_in_table_view(size_t row_ndx)
+{
+    // TableView::find_by_source_ndx() is a linear scan, which makes looking up
+    // each row of the Results in turn quadratic, so instead build a map from
+    // source row to index once per version of the TableView. The changesets
+    // delivered to the notifier's callbacks aren't enough to patch it in
+    // place, as they don't cover rows moving within the table.
+    // A frozen TableView has its rows adjusted by every write without ever
+    // being resynced, so there's no point at which a map would be current.
+    if (m_update_policy == UpdatePolicy::Never)
+        return m_table_view.find_by_source_ndx(row_ndx);
+
+    if (m_table_view_index.empty()) {
+        size_t size = m_table_view.size();
+        m_table_view_index.reserve(size);
+        for (size_t i = 0; i < size; ++i) {
+            if (m_table_view.is_row_attached(i))
+                m_table_view_index.emplace(m_table_view.get_source_ndx(i), i);
+        }
+    }
+
+    auto it = m_table_view_index.find(row_ndx);
+    return it == m_table_view_index.end() ? not_found : it->second;
+}
+
 template<typename Int, typename Float, typename Double, typename Timestamp>
 util::Optional<Mixed> Results::aggregate(size_t column, bool return_none_for_empty,
                                          const char* name,
@@ -342,6 +452,12 @@ util::Optional<Mixed> Results::aggregate(size_t column, bool return_none_for_emp
             case Mode::Query:
             case Mode::TableView:
                 this->update_tableview();
+                if (is_windowed()) {
+                    WindowAggregator window(*m_table, window_rows());
+                    if (return_none_for_empty && window.size() == 0)
+                        return none;
+                    return util::Optional<Mixed>(getter(window));
+                }
                 if (return_none_for_empty && m_table_view.size() == 0)
                     return none;
                 return util::Optional<Mixed>(getter(m_table_view));
@@ -396,6 +512,34 @@ util::Optional<Mixed> Results::average(size_t column)
                      [=](auto const&) -> util::None { throw UnsupportedColumnTypeException{column, m_table, "average"}; });
 }
 
+LiveAggregate Results::live_aggregate(size_t column)
+{
+    validate_read();
+    if (!m_table)
+        return {};
+    if (column >= m_table->get_column_count())
+        throw OutOfBoundsIndexException{column, m_table->get_column_count()};
+
+    auto tracker = _impl::AggregateTracker::create(*m_table, column);
+    if (!tracker)
+        throw UnsupportedColumnTypeException{column, m_table, "aggregate"};
+
+    // The notifier's tracker starts from the rows it sees on its next run, so
+    // the values for the current version are calculated here once
+    std::vector<size_t> rows;
+    size_t count = size();
+    rows.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+        rows.push_back(get(i).get_index());
+    auto initial = _impl::AggregateTracker::create(*m_table, column);
+    initial->reset(*m_table, rows);
+
+    prepare_async();
+    auto values = m_notifier->add_aggregate(std::move(tracker), initial->values());
+    NotificationToken token{m_notifier, m_notifier->add_callback(CollectionChangeCallback([](CollectionChangeSet, std::exception_ptr) { }))};
+    return {std::move(values), std::move(token)};
+}
+
 void Results::clear()
 {
     switch (m_mode) {
@@ -411,6 +555,18 @@ void Results::clear()
         case Mode::TableView:
             validate_write();
             update_tableview();
+            m_table_view_index.clear();
+
+            if (is_windowed()) {
+                // Only the rows inside the window are removed. Removing them
+                // from the highest index down keeps the rest valid as the last
+                // row is moved over each one.
+                auto rows = window_rows();
+                std::sort(rows.begin(), rows.end(), std::greater<size_t>());
+                for (auto row : rows)
+                    m_table->move_last_over(row);
+                break;
+            }
 
             switch (m_update_policy) {
                 case UpdatePolicy::Auto:
@@ -483,12 +639,32 @@ TableView Results::get_tableview()
 
 Results Results::sort(realm::SortDescriptor&& sort) const
 {
-    return Results(m_realm, get_query(), std::move(sort));
+    Results results(m_realm, get_query(), std::move(sort));
+    results.m_window_offset = m_window_offset;
+    results.m_window_count = m_window_count;
+    return results;
 }
 
 Results Results::filter(Query&& q) const
 {
-    return Results(m_realm, get_query().and_query(std::move(q)), m_sort);
+    Results results(m_realm, get_query().and_query(std::move(q)), m_sort);
+    results.m_window_offset = m_window_offset;
+    results.m_window_count = m_window_count;
+    return results;
+}
+
+Results Results::limit(size_t offset, size_t count) const
+{
+    validate_read();
+    if (m_mode == Mode::Empty)
+        return Results();
+
+    // The new window is relative to the existing one
+    offset = std::min(offset, m_window_count);
+    Results results(m_realm, get_query(), m_sort);
+    results.m_window_offset = m_window_offset + offset;
+    results.m_window_count = std::min(count, m_window_count - offset);
+    return results;
 }
 
 Results Results::snapshot() const &
@@ -544,14 +720,20 @@ void Results::prepare_async()
 NotificationToken Results::async(std::function<void (std::exception_ptr)> target)
 {
     prepare_async();
-    auto wrap = [=](CollectionChangeSet, std::exception_ptr e) { target(e); };
+    auto wrap = [=](std::shared_ptr<const CollectionChangeSet>, std::exception_ptr e) { target(e); };
     return {m_notifier, m_notifier->add_callback(wrap)};
 }
 
-NotificationToken Results::add_notification_callback(CollectionChangeCallback cb)
+NotificationToken Results::add_notification_callback(CollectionChangeCallback cb, KeyPathArray key_paths)
+{
+    prepare_async();
+    return {m_notifier, m_notifier->add_callback(std::move(cb), std::move(key_paths))};
+}
+
+NotificationToken Results::add_notification_callback(SharedCollectionChangeCallback cb, KeyPathArray key_paths)
 {
     prepare_async();
-    return {m_notifier, m_notifier->add_callback(std::move(cb))};
+    return {m_notifier, m_notifier->add_callback(std::move(cb), std::move(key_paths))};
 }
 
 bool Results::is_in_table_order() const
@@ -580,12 +762,44 @@ void Results::Internal::set_table_view(Results& results, realm::TableView &&tv)
     }
 
     results.m_table_view = std::move(tv);
+    results.m_table_view_index.clear();
     results.m_mode = Mode::TableView;
     results.m_has_used_table_view = false;
     REALM_ASSERT(results.m_table_view.is_in_sync());
     REALM_ASSERT(results.m_table_view.is_attached());
 }
 
+LiveAggregate::LiveAggregate(std::shared_ptr<_impl::AggregateValues const> values, NotificationToken token)
+: m_values(std::move(values))
+, m_token(std::move(token))
+{
+}
+
+util::Optional<Mixed> LiveAggregate::max() const
+{
+    return m_values ? m_values->max : util::none;
+}
+
+util::Optional<Mixed> LiveAggregate::min() const
+{
+    return m_values ? m_values->min : util::none;
+}
+
+util::Optional<Mixed> LiveAggregate::average() const
+{
+    return m_values ? m_values->average : util::none;
+}
+
+util::Optional<Mixed> LiveAggregate::sum() const
+{
+    return m_values ? m_values->sum : util::none;
+}
+
+size_t LiveAggregate::count() const
+{
+    return m_values ? m_values->count : 0;
+}
+
 Results::OutOfBoundsIndexException::OutOfBoundsIndexException(size_t r, size_t c)
 : std::out_of_range(util::format("Requested index %1 greater than max %2", r, c))
 , requested(r), valid_count(c) {}
@@ -26,14 +26,19 @@
 #include <realm/table_view.hpp>
 #include <realm/util/optional.hpp>
 
+#include <unordered_map>
+
 namespace realm {
 template<typename T> class BasicRowExpr;
 using RowExpr = BasicRowExpr<Table>;
 class Mixed;
 class ObjectSchema;
 
+class LiveAggregate;
+
 namespace _impl {
     class ResultsNotifier;
+    struct AggregateValues;
 }
 
 class Results {
@@ -68,6 +73,7 @@ public:
     SortDescriptor const& get_sort() const noexcept { return m_sort; }
 
     // Get a tableview containing the same rows as this Results
+    // For a windowed Results this is the view which the window is taken from
     TableView get_tableview();
 
     // Get the object type which will be returned by get()
@@ -104,6 +110,18 @@ public:
     Results filter(Query&& q) const;
     Results sort(SortDescriptor&& sort) const;
 
+    // Create a new Results containing at most `count` rows starting at
+    // `offset` of this Results. The window is always applied after filtering
+    // and sorting, including any added with filter() or sort() afterwards.
+    // Without a sort the query stops once it has filled the window, and
+    // notifications report only changes to the rows inside the window, in
+    // terms of their positions within the window.
+    Results limit(size_t offset, size_t count) const;
+
+    // Get the window set by limit(); npos for the count means no limit
+    size_t get_window_offset() const noexcept { return m_window_offset; }
+    size_t get_window_count() const noexcept { return m_window_count; }
+
     // Return a snapshot of this Results that never updates to reflect changes in the underlying data.
     Results snapshot() const &;
     Results snapshot() &&;
@@ -118,6 +136,13 @@ public:
     util::Optional<Mixed> average(size_t column);
     util::Optional<Mixed> sum(size_t column);
 
+    // Get a handle to the min/max/average/sum of the given column which is
+    // kept up to date by the background notifier as the Results changes, rather
+    // than being recalculated on each read
+    // Throws UnsupportedColumnTypeException for non-numeric, non-timestamp columns
+    // Throws OutOfBoundsIndexException for an out-of-bounds column
+    LiveAggregate live_aggregate(size_t column);
+
     enum class Mode {
         Empty, // Backed by nothing (for missing tables)
         Table, // Backed directly by a Table
@@ -171,7 +196,12 @@ public:
     // The query will be run on a background thread and delivered to the callback,
     // and then rerun after each commit (if needed) and redelivered if it changed
     NotificationToken async(std::function<void (std::exception_ptr)> target);
-    NotificationToken add_notification_callback(CollectionChangeCallback cb);
+
+    // Add a callback to be called each time the Results changes. If key paths
+    // are supplied, modifications are only reported for objects where one of
+    // the named properties changed.
+    NotificationToken add_notification_callback(CollectionChangeCallback cb, KeyPathArray key_paths = {});
+    NotificationToken add_notification_callback(SharedCollectionChangeCallback cb, KeyPathArray key_paths = {});
 
     bool wants_background_updates() const { return m_wants_background_updates; }
 
@@ -199,6 +229,14 @@ private:
     Table* m_table = nullptr;
     SortDescriptor m_sort;
 
+    // The rows of the query which this Results is limited to
+    size_t m_window_offset = 0;
+    size_t m_window_count = npos;
+
+    // The index in m_table_view of each source row, built on the first call to
+    // index_of() after the TableView changes. Empty when not built.
+    std::unordered_map<size_t, size_t> m_table_view_index;
+
     _impl::CollectionNotifier::Handle<_impl::ResultsNotifier> m_notifier;
 
     Mode m_mode = Mode::Empty;
@@ -212,6 +250,15 @@ private:
     void validate_read() const;
     void validate_write() const;
 
+    bool is_windowed() const noexcept { return m_window_offset != 0 || m_window_count != npos; }
+    // The number of rows needed from the query to fill the window
+    size_t window_end() const noexcept;
+    // The number of rows of a view of the given size which are inside the window
+    size_t window_size(size_t view_size) const noexcept;
+    // The source rows of the TableView which are inside the window
+    std::vector<size_t> window_rows() const;
+    size_t find_in_table_view(size_t row_ndx);
+
     void prepare_async();
 
     template<typename Int, typename Float, typename Double, typename Timestamp>
@@ -222,6 +269,33 @@ private:
 
     void set_table_view(TableView&& tv);
 };
+
+// The aggregates of a column of a Results, maintained incrementally by the
+// Results' notifier from the changes to the rows of the Results. Reading them
+// is O(1), and they update to the new version at the same time as the
+// Results' notification callbacks are called.
+class LiveAggregate {
+public:
+    LiveAggregate() = default;
+
+    // As for the corresponding functions on Results, except that sum() and
+    // average() return none for timestamp columns rather than throwing
+    util::Optional<Mixed> max() const;
+    util::Optional<Mixed> min() const;
+    util::Optional<Mixed> average() const;
+    util::Optional<Mixed> sum() const;
+
+    // The number of non-null values in the column
+    size_t count() const;
+
+private:
+    friend class Results;
+    LiveAggregate(std::shared_ptr<_impl::AggregateValues const> values, NotificationToken token);
+
+    std::shared_ptr<_impl::AggregateValues const> m_values;
+    // Keeps the notifier running while the handle is alive
+    NotificationToken m_token;
+};
 }
 
 #endif /* REALM_RESULTS_HPP */
@@ -45,6 +45,11 @@ Schema::Schema(std::initializer_list<ObjectSchema> types) : Schema(base(types))
 
 Schema::Schema(base types) : base(std::move(types))
 {
+    // The ObjectSchemas are often built up by modifying their properties
+    // directly, so make sure their indexes are current
+    for (auto& object_schema : *this)
+        object_schema.update_property_index();
+
     std::sort(begin(), end(), [](ObjectSchema const& lft, ObjectSchema const& rgt) {
         return lft.name < rgt.name;
     });
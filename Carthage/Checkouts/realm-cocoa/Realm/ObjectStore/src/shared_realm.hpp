@@ -23,6 +23,7 @@
 
 #include <realm/util/optional.hpp>
 
+#include <chrono>
 #include <memory>
 #include <thread>
 
@@ -152,6 +153,40 @@ public:
         // everything can be done deterministically on one thread, and
         // speeds up tests that don't need notifications.
         bool automatic_change_notifications = true;
+        // The number of threads used to calculate change notifications.
+        // Each thread uses its own SharedGroup and notifiers stay on the
+        // thread they were first assigned to, so this only helps when there
+        // are many notifiers with expensive queries. Only the value from the
+        // first Realm opened for a path is used.
+        size_t async_notifier_thread_count = 1;
+        // The maximum number of rows which can be reported as moved in the
+        // notifications for sorted Results. If set, moves are calculated in
+        // O(N log N) time rather than the default O(N^2) worst case, and
+        // changes which move more rows than this are reported as every row
+        // being deleted and reinserted. Unlimited by default.
+        size_t max_notification_moved_rows = -1;
+
+        // Settings for coalescing commits which happen in quick succession
+        // into a single run of the async notifiers. Only the values from the
+        // first Realm opened for a path are used.
+        //
+        // The minimum time between the start of one run and the start of the
+        // next. Commits made while waiting are all included in the next run,
+        // with their changes merged. Zero disables coalescing.
+        std::chrono::milliseconds notification_min_interval{0};
+        // If non-zero, the time between runs is extended to this multiple of
+        // how long the previous run took, so that expensive notifiers are run
+        // less often while writes are happening continuously.
+        double notification_run_cost_factor = 0;
+        // The longest a run is ever delayed after the commit which triggered
+        // it, regardless of the two settings above.
+        std::chrono::milliseconds notification_max_latency{250};
+
+        // If set, a Results whose last notifier result hasn't been picked up
+        // by its thread yet skips rerunning its query for new commits until
+        // the thread catches up, at which point a single run reports all of
+        // the changes since the last delivered result.
+        bool defer_notifier_runs_while_pending = false;
     };
 
     // Get a cached Realm or create a new one if no cached copies exists
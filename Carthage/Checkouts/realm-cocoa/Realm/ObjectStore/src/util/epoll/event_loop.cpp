@@ -0,0 +1,110 @@
+////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2016 Realm Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+////////////////////////////////////////////////////////////////////////////
+
+#include "util/epoll/event_loop.hpp"
+
+#include <errno.h>
+#include <sys/epoll.h>
+#include <system_error>
+#include <unistd.h>
+
+using namespace realm;
+using namespace realm::util;
+
+std::shared_ptr<EventLoop> EventLoop::current()
+{
+    static thread_local std::shared_ptr<EventLoop> loop;
+    if (!loop) {
+        loop.reset(new EventLoop);
+    }
+    return loop;
+}
+
+EventLoop::EventLoop()
+: m_epfd(epoll_create1(EPOLL_CLOEXEC))
+{
+    if (m_epfd == -1) {
+        throw std::system_error(errno, std::system_category());
+    }
+}
+
+EventLoop::~EventLoop()
+{
+    ::close(m_epfd);
+}
+
+bool EventLoop::run_once(int timeout_ms)
+{
+    struct epoll_event events[16];
+    int ret = epoll_wait(m_epfd, events, sizeof(events) / sizeof(events[0]), timeout_ms);
+    if (ret == -1) {
+        if (errno == EINTR) {
+            return false;
+        }
+        throw std::system_error(errno, std::system_category());
+    }
+
+    bool ran_any = false;
+    for (int i = 0; i < ret; ++i) {
+        std::function<void()> callback;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            // The fd may have been removed after epoll_wait() returned
+            auto it = m_callbacks.find(events[i].data.fd);
+            if (it == m_callbacks.end()) {
+                continue;
+            }
+            callback = it->second;
+        }
+        // Called without the lock held so that the callback can add or
+        // remove fds
+        callback();
+        ran_any = true;
+    }
+    return ran_any;
+}
+
+void EventLoop::add(int fd, std::function<void()> callback)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(m_epfd, EPOLL_CTL_ADD, fd, &event) == -1) {
+        throw std::system_error(errno, std::system_category());
+    }
+    m_callbacks[fd] = std::move(callback);
+}
+
+void EventLoop::remove(int fd)
+{
+    std::function<void()> callback;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        epoll_ctl(m_epfd, EPOLL_CTL_DEL, fd, nullptr);
+        auto it = m_callbacks.find(fd);
+        if (it == m_callbacks.end()) {
+            return;
+        }
+        // Destroy the callback after releasing the lock, as it may own the
+        // state for the fd
+        callback = std::move(it->second);
+        m_callbacks.erase(it);
+    }
+}
@@ -0,0 +1,77 @@
+////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2016 Realm Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+////////////////////////////////////////////////////////////////////////////
+
+#ifndef REALM_EPOLL_EVENT_LOOP_HPP
+#define REALM_EPOLL_EVENT_LOOP_HPP
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace realm {
+namespace util {
+// A minimal epoll-based event loop which EventLoopSignal uses to deliver
+// notifications to the thread which created it, as Linux has no standard
+// per-thread run loop.
+//
+// Threads which already have an event loop of their own can add fd() to it
+// and call process_pending() when it becomes readable, while other threads can
+// block in run_once().
+class EventLoop {
+public:
+    // Get the event loop for the current thread, creating it if needed
+    static std::shared_ptr<EventLoop> current();
+
+    ~EventLoop();
+
+    // An epoll file descriptor which is readable whenever there are pending
+    // callbacks to run
+    int fd() const noexcept { return m_epfd; }
+
+    // Wait up to `timeout_ms` milliseconds (or forever if -1) for at least one
+    // pending callback, and then run all of the pending callbacks. Must only be
+    // called on the thread which owns the loop. Returns whether any callbacks
+    // were run.
+    bool run_once(int timeout_ms=-1);
+    // Run all of the pending callbacks without blocking
+    bool process_pending() { return run_once(0); }
+
+    // Call `callback` on the owning thread whenever `fd` is readable. The
+    // callback must consume the data which made the fd readable. Can be called
+    // from any thread.
+    void add(int fd, std::function<void()> callback);
+    // Stop listening for `fd`. A call to the callback for it which is already
+    // in progress on the owning thread may still complete after this returns.
+    void remove(int fd);
+
+private:
+    EventLoop();
+
+    int m_epfd;
+
+    std::mutex m_mutex;
+    std::unordered_map<int, std::function<void()>> m_callbacks;
+
+    EventLoop(EventLoop const&) = delete;
+    EventLoop& operator=(EventLoop const&) = delete;
+};
+} // namespace util
+} // namespace realm
+
+#endif // REALM_EPOLL_EVENT_LOOP_HPP
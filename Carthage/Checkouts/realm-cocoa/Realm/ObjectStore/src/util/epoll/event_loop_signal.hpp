@@ -0,0 +1,93 @@
+////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2016 Realm Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+////////////////////////////////////////////////////////////////////////////
+
+#include "util/epoll/event_loop.hpp"
+
+#include <errno.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace realm {
+namespace util {
+// An EventLoopSignal which uses an eventfd registered with the EventLoop for
+// the thread which created it, so notify() is a single write() from any thread
+// and the callback is invoked the next time that thread runs its EventLoop.
+template<typename Callback>
+class EventLoopSignal {
+public:
+    EventLoopSignal(Callback&& callback)
+    : m_event_loop(EventLoop::current())
+    , m_state(std::make_shared<State>(std::move(callback)))
+    {
+        auto state = m_state;
+        m_event_loop->add(m_state->fd, [state] {
+            uint64_t count;
+            // Reset the counter so that multiple notifications before the
+            // loop runs only invoke the callback once
+            if (read(state->fd, &count, sizeof(count)) == sizeof(count)) {
+                state->callback();
+            }
+        });
+    }
+
+    ~EventLoopSignal()
+    {
+        m_event_loop->remove(m_state->fd);
+    }
+
+    EventLoopSignal(EventLoopSignal&&) = delete;
+    EventLoopSignal& operator=(EventLoopSignal&&) = delete;
+    EventLoopSignal(EventLoopSignal const&) = delete;
+    EventLoopSignal& operator=(EventLoopSignal const&) = delete;
+
+    void notify()
+    {
+        uint64_t one = 1;
+        write(m_state->fd, &one, sizeof(one));
+    }
+
+private:
+    // Shared with the callback registered with the event loop so that the fd
+    // stays open until any in-progress invocation of the callback completes,
+    // even if the signal is destroyed on a different thread
+    struct State {
+        Callback callback;
+        int fd;
+
+        State(Callback&& callback)
+        : callback(std::move(callback))
+        , fd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+        {
+            if (fd == -1) {
+                throw std::system_error(errno, std::system_category());
+            }
+        }
+
+        ~State()
+        {
+            ::close(fd);
+        }
+    };
+
+    std::shared_ptr<EventLoop> m_event_loop;
+    std::shared_ptr<State> m_state;
+};
+} // namespace util
+} // namespace realm
@@ -27,6 +27,8 @@
 #include "util/apple/event_loop_signal.hpp"
 #elif REALM_ANDROID
 #include "util/android/event_loop_signal.hpp"
+#elif defined(__linux__)
+#include "util/epoll/event_loop_signal.hpp"
 #else
 #include "util/generic/event_loop_signal.hpp"
 #endif
@@ -0,0 +1,196 @@
+////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2016 Realm Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+////////////////////////////////////////////////////////////////////////////
+
+#ifndef REALM_FLAT_INDEX_MAP_HPP
+#define REALM_FLAT_INDEX_MAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace realm {
+namespace util {
+// A hash map from row index to row index, stored in a single open-addressed
+// array with linear probing. Unlike std::unordered_map, inserting doesn't
+// allocate once the table is large enough, and neighbouring lookups touch
+// neighbouring memory. Erasing shifts the following entries back rather than
+// leaving tombstones, so heavy churn doesn't degrade lookups.
+//
+// SIZE_MAX is reserved to mark empty slots, and cannot be used as a key.
+// Clearing the map keeps its capacity.
+class FlatIndexMap {
+public:
+    using value_type = std::pair<size_t, size_t>;
+
+    FlatIndexMap() = default;
+    FlatIndexMap(FlatIndexMap&& other) noexcept { *this = std::move(other); }
+    FlatIndexMap& operator=(FlatIndexMap&& other) noexcept
+    {
+        if (this == &other)
+            return *this;
+        m_slots = std::move(other.m_slots);
+        m_size = other.m_size;
+        m_shift = other.m_shift;
+        other.m_slots.clear();
+        other.m_size = 0;
+        return *this;
+    }
+
+    // Copying an empty map doesn't copy its (possibly large) capacity
+    FlatIndexMap(FlatIndexMap const& other) { *this = other; }
+    FlatIndexMap& operator=(FlatIndexMap const& other)
+    {
+        if (this == &other)
+            return *this;
+        if (other.m_size == 0) {
+            clear();
+            return *this;
+        }
+        m_slots = other.m_slots;
+        m_size = other.m_size;
+        m_shift = other.m_shift;
+        return *this;
+    }
+
+    size_t size() const noexcept { return m_size; }
+    bool empty() const noexcept { return m_size == 0; }
+
+    // Get a pointer to the value for `key`, or nullptr if it's not present.
+    // Invalidated by any modification of the map.
+    size_t* find(size_t key) noexcept
+    {
+        size_t i = find_slot(key);
+        return i == npos ? nullptr : &m_slots[i].second;
+    }
+
+    bool contains(size_t key) const noexcept { return find_slot(key) != npos; }
+
+    // Set the value for `key`, adding it if it's not already present
+    void set(size_t key, size_t value)
+    {
+        if ((m_size + 1) * 2 > m_slots.size())
+            grow();
+        for (size_t i = home(key); ; i = next(i)) {
+            if (m_slots[i].first == key) {
+                m_slots[i].second = value;
+                return;
+            }
+            if (m_slots[i].first == empty_key) {
+                m_slots[i] = {key, value};
+                ++m_size;
+                return;
+            }
+        }
+    }
+
+    // Remove `key` from the map, returning whether it was present
+    bool erase(size_t key) noexcept
+    {
+        if (m_size == 0)
+            return false;
+        size_t i = home(key);
+        for (; m_slots[i].first != key; i = next(i)) {
+            if (m_slots[i].first == empty_key)
+                return false;
+        }
+
+        // Shift back each following entry in the probe sequence which can
+        // legally live in the slot being vacated, so that there's never an
+        // empty slot between an entry and its home slot
+        for (size_t j = next(i); m_slots[j].first != empty_key; j = next(j)) {
+            size_t mask = m_slots.size() - 1;
+            if (((j - home(m_slots[j].first)) & mask) >= ((j - i) & mask)) {
+                m_slots[i] = m_slots[j];
+                i = j;
+            }
+        }
+        m_slots[i].first = empty_key;
+        --m_size;
+        return true;
+    }
+
+    void clear() noexcept
+    {
+        if (m_size == 0)
+            return;
+        for (auto& slot : m_slots)
+            slot.first = empty_key;
+        m_size = 0;
+    }
+
+    // Call fn(key, value) for each entry, in an unspecified order
+    template<typename Fn>
+    void for_each(Fn&& fn) const
+    {
+        if (m_size == 0)
+            return;
+        for (auto& slot : m_slots) {
+            if (slot.first != empty_key)
+                fn(slot.first, slot.second);
+        }
+    }
+
+private:
+    static constexpr size_t empty_key = SIZE_MAX;
+
+    std::vector<value_type> m_slots;
+    size_t m_size = 0;
+    // 64 minus log2 of the number of slots, so that the top bits of the hash
+    // can be used as the slot index
+    unsigned m_shift = 64;
+
+    size_t home(size_t key) const noexcept
+    {
+        // Fibonacci hashing, as the row indices used as keys are usually
+        // dense and would otherwise all land in neighbouring slots
+        return size_t((uint64_t(key) * 0x9E3779B97F4A7C15ull) >> m_shift);
+    }
+
+    size_t next(size_t i) const noexcept { return (i + 1) & (m_slots.size() - 1); }
+
+    static constexpr size_t npos = SIZE_MAX;
+    size_t find_slot(size_t key) const noexcept
+    {
+        if (m_size == 0)
+            return npos;
+        for (size_t i = home(key); ; i = next(i)) {
+            if (m_slots[i].first == key)
+                return i;
+            if (m_slots[i].first == empty_key)
+                return npos;
+        }
+    }
+
+    void grow()
+    {
+        std::vector<value_type> old;
+        old.swap(m_slots);
+        m_slots.assign(old.empty() ? 8 : old.size() * 2, value_type{size_t(empty_key), 0});
+        m_shift = old.empty() ? 61 : m_shift - 1;
+        m_size = 0;
+        for (auto& slot : old) {
+            if (slot.first != empty_key)
+                set(slot.first, slot.second);
+        }
+    }
+};
+} // namespace util
+} // namespace realm
+
+#endif // REALM_FLAT_INDEX_MAP_HPP
@@ -0,0 +1,268 @@
+////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2016 Realm Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+////////////////////////////////////////////////////////////////////////////
+
+#ifndef REALM_SMALL_VECTOR_HPP
+#define REALM_SMALL_VECTOR_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace realm {
+namespace util {
+// A vector which stores up to N elements inline before moving them to the
+// heap. Supports the subset of std::vector's interface which we need, with
+// pointers as iterators.
+//
+// Unlike std::vector, moving a SmallVector whose elements are stored inline
+// moves each of the elements, so pointers into it are not stable across moves.
+template<typename T, size_t N>
+class SmallVector {
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+    using reference = T&;
+    using const_reference = T const&;
+    using pointer = T*;
+    using const_pointer = T const*;
+    using iterator = T*;
+    using const_iterator = T const*;
+
+    SmallVector() noexcept = default;
+    // These delegate to the default constructor so that the elements copied so
+    // far are destroyed if copying one of them throws
+    SmallVector(std::initializer_list<T> values) : SmallVector() { assign(values.begin(), values.end()); }
+    template<typename Iterator>
+    SmallVector(Iterator first, Iterator last) : SmallVector() { assign(first, last); }
+
+    SmallVector(SmallVector const& other) : SmallVector() { assign(other.begin(), other.end()); }
+    SmallVector(SmallVector&& other) noexcept(std::is_nothrow_move_constructible<T>::value)
+    {
+        take(std::move(other));
+    }
+
+    SmallVector& operator=(SmallVector const& other)
+    {
+        if (this != &other)
+            assign(other.begin(), other.end());
+        return *this;
+    }
+
+    SmallVector& operator=(SmallVector&& other) noexcept(std::is_nothrow_move_constructible<T>::value)
+    {
+        if (this != &other) {
+            clear();
+            release_heap();
+            take(std::move(other));
+        }
+        return *this;
+    }
+
+    ~SmallVector()
+    {
+        clear();
+        release_heap();
+    }
+
+    iterator begin() noexcept { return m_begin; }
+    iterator end() noexcept { return m_begin + m_size; }
+    const_iterator begin() const noexcept { return m_begin; }
+    const_iterator end() const noexcept { return m_begin + m_size; }
+    const_iterator cbegin() const noexcept { return m_begin; }
+    const_iterator cend() const noexcept { return m_begin + m_size; }
+
+    size_t size() const noexcept { return m_size; }
+    size_t capacity() const noexcept { return m_capacity; }
+    bool empty() const noexcept { return m_size == 0; }
+    // Whether the elements are stored inline rather than on the heap
+    bool is_inline() const noexcept { return m_begin == inline_data(); }
+
+    T* data() noexcept { return m_begin; }
+    T const* data() const noexcept { return m_begin; }
+
+    T& operator[](size_t i) noexcept { return m_begin[i]; }
+    T const& operator[](size_t i) const noexcept { return m_begin[i]; }
+    T& front() noexcept { return m_begin[0]; }
+    T const& front() const noexcept { return m_begin[0]; }
+    T& back() noexcept { return m_begin[m_size - 1]; }
+    T const& back() const noexcept { return m_begin[m_size - 1]; }
+
+    void reserve(size_t capacity)
+    {
+        if (capacity <= m_capacity)
+            return;
+        if (capacity > std::numeric_limits<size_t>::max() / sizeof(T))
+            throw std::length_error("SmallVector::reserve");
+
+        std::unique_ptr<T, HeapDeleter> storage(static_cast<T*>(::operator new(capacity * sizeof(T))));
+        // Copy rather than move if moving can throw so that a failure leaves
+        // the existing elements untouched, as with std::vector
+        T* out = storage.get();
+        try {
+            for (auto& value : *this) {
+                new (out) T(std::move_if_noexcept(value));
+                ++out;
+            }
+        }
+        catch (...) {
+            destroy(storage.get(), out);
+            throw;
+        }
+        destroy(begin(), end());
+        release_heap();
+        m_begin = storage.release();
+        m_capacity = capacity;
+    }
+
+    void resize(size_t size)
+    {
+        if (size < m_size) {
+            destroy(begin() + size, end());
+            m_size = size;
+            return;
+        }
+        grow_for(size);
+        for (; m_size < size; ++m_size)
+            new (end()) T();
+    }
+
+    void clear() noexcept
+    {
+        destroy(begin(), end());
+        m_size = 0;
+    }
+
+    template<typename... Args>
+    T& emplace_back(Args&&... args)
+    {
+        if (m_size == m_capacity) {
+            // `args` may refer to an existing element, so construct the new
+            // element before moving the old ones
+            T value(std::forward<Args>(args)...);
+            grow_for(m_size + 1);
+            new (end()) T(std::move(value));
+        }
+        else {
+            new (end()) T(std::forward<Args>(args)...);
+        }
+        return m_begin[m_size++];
+    }
+
+    void push_back(T const& value) { emplace_back(value); }
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    void pop_back() noexcept
+    {
+        --m_size;
+        end()->~T();
+    }
+
+    iterator insert(const_iterator pos, T value)
+    {
+        size_t offset = pos - begin();
+        emplace_back(std::move(value));
+        std::rotate(begin() + offset, end() - 1, end());
+        return begin() + offset;
+    }
+
+    iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        auto it = begin() + (first - begin());
+        if (first == last)
+            return it;
+        auto new_end = std::move(begin() + (last - begin()), end(), it);
+        destroy(new_end, end());
+        m_size = new_end - begin();
+        return it;
+    }
+
+    template<typename Iterator>
+    void assign(Iterator first, Iterator last)
+    {
+        clear();
+        grow_for(std::distance(first, last));
+        for (; first != last; ++first, ++m_size)
+            new (end()) T(*first);
+    }
+
+private:
+    struct HeapDeleter {
+        void operator()(T* ptr) const noexcept { ::operator delete(ptr); }
+    };
+
+    T* m_begin = inline_data();
+    size_t m_size = 0;
+    size_t m_capacity = N;
+    typename std::aligned_storage<sizeof(T) * N, alignof(T)>::type m_inline;
+
+    T* inline_data() noexcept { return reinterpret_cast<T*>(&m_inline); }
+    T const* inline_data() const noexcept { return reinterpret_cast<T const*>(&m_inline); }
+
+    static void destroy(T* first, T* last) noexcept
+    {
+        for (; first != last; ++first)
+            first->~T();
+    }
+
+    void grow_for(size_t size)
+    {
+        if (size > m_capacity)
+            reserve(std::max(size, m_capacity * 2));
+    }
+
+    void release_heap() noexcept
+    {
+        if (!is_inline()) {
+            ::operator delete(m_begin);
+            m_begin = inline_data();
+            m_capacity = N;
+        }
+    }
+
+    // Requires this to be empty and inline
+    void take(SmallVector&& other) noexcept(std::is_nothrow_move_constructible<T>::value)
+    {
+        if (other.is_inline()) {
+            std::uninitialized_copy(std::make_move_iterator(other.begin()), std::make_move_iterator(other.end()),
+                                    inline_data());
+            m_size = other.m_size;
+            other.clear();
+        }
+        else {
+            m_begin = other.m_begin;
+            m_size = other.m_size;
+            m_capacity = other.m_capacity;
+            other.m_begin = other.inline_data();
+            other.m_size = 0;
+            other.m_capacity = N;
+        }
+    }
+};
+} // namespace util
+} // namespace realm
+
+#endif // REALM_SMALL_VECTOR_HPP
@@ -0,0 +1,44 @@
+////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2016 Realm Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+////////////////////////////////////////////////////////////////////////////
+
+#ifndef REALM_BENCHMARK_HPP
+#define REALM_BENCHMARK_HPP
+
+#include <chrono>
+#include <cstdio>
+
+namespace realm {
+namespace benchmark {
+// Run `fn` `iterations` times (after a single untimed warm-up run) and print
+// the average time per iteration
+template<typename Fn>
+void run(const char* name, size_t iterations, Fn&& fn)
+{
+    using namespace std::chrono;
+
+    fn();
+    auto start = steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+        fn();
+    auto elapsed = duration_cast<duration<double, std::micro>>(steady_clock::now() - start);
+    printf("%-60s %12.2f us\n", name, elapsed.count() / iterations);
+}
+} // namespace benchmark
+} // namespace realm
+
+#endif // REALM_BENCHMARK_HPP
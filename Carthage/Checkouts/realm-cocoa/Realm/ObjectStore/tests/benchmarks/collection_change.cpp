@@ -0,0 +1,187 @@
+////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2016 Realm Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+////////////////////////////////////////////////////////////////////////////
+
+#include "benchmark.hpp"
+
+#include "impl/collection_change_builder.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <string>
+
+using namespace realm;
+
+// Measures calculating the changes for sorted results with both the default
+// and the bounded move detection for the best and worst case inputs
+static void calculate()
+{
+    const size_t row_count = 10000;
+    const size_t max_moved_rows = row_count / 10;
+
+    std::vector<size_t> prev(row_count);
+    std::iota(prev.begin(), prev.end(), 0);
+    auto none_modified = [](size_t) { return false; };
+
+    auto run = [&](const char* name, size_t iterations, std::vector<size_t> const& next) {
+        benchmark::run((std::string(name) + ", unlimited").c_str(), iterations, [&] {
+            _impl::CollectionChangeBuilder::calculate(prev, next, none_modified, false);
+        });
+        benchmark::run((std::string(name) + ", limited").c_str(), iterations, [&] {
+            _impl::CollectionChangeBuilder::calculate(prev, next, none_modified, false, max_moved_rows);
+        });
+    };
+
+    // Best cases: nothing or a single row moved
+    run("unchanged", 100, prev);
+
+    auto next = prev;
+    std::rotate(next.begin() + row_count / 4, next.begin() + row_count / 2, next.begin() + row_count / 2 + 1);
+    run("one row moved", 100, next);
+
+    // Worst cases: the order is reversed or completely shuffled, which the
+    // limited calculation reports as a reload
+    next = prev;
+    std::reverse(next.begin(), next.end());
+    run("reversed", 1, next);
+
+    std::mt19937 rng(0);
+    std::shuffle(next.begin(), next.end(), rng);
+    run("shuffled", 1, next);
+
+    // Many short runs of rows swapping places, which stays within the limit
+    next = prev;
+    for (size_t i = 0; i + 1 < row_count; i += row_count / max_moved_rows * 2)
+        std::swap(next[i], next[i + 1]);
+    run("interleaved swaps", 10, next);
+}
+
+// Measures calculating the changes for 1M row results, where sorting the rows
+// by row and results index dominates over finding the actual changes
+static void calculate_large()
+{
+    const size_t row_count = 1000000;
+    auto none_modified = [](size_t) { return false; };
+
+    // Every other row of a 2M row table, as if from a query
+    std::vector<size_t> prev(row_count);
+    for (size_t i = 0; i < row_count; ++i)
+        prev[i] = i * 2;
+
+    auto run = [&](const char* name, std::vector<size_t> const& next, bool in_table_order, size_t max_moved_rows) {
+        benchmark::run(name, 5, [&] {
+            _impl::CollectionChangeBuilder::calculate(prev, next, none_modified, in_table_order, max_moved_rows);
+        });
+    };
+
+    // 1k rows stop matching the query and 1k other rows start matching it
+    auto next = prev;
+    for (size_t i = 0; i < 1000; ++i) {
+        next[i * 997] += 1;
+        next[i * 991 + 500] = IndexSet::npos;
+    }
+    next.erase(std::remove(next.begin(), next.end(), IndexSet::npos), next.end());
+    run("1M rows in table order, 1k rows replaced", next, true, IndexSet::npos);
+
+    run("1M sorted rows, unchanged", prev, false, IndexSet::npos);
+
+    next = prev;
+    std::rotate(next.begin() + row_count / 4, next.begin() + row_count / 2, next.begin() + row_count / 2 + 1);
+    run("1M sorted rows, one row moved", next, false, IndexSet::npos);
+
+    std::mt19937 rng(0);
+    std::shuffle(next.begin(), next.end(), rng);
+    run("1M sorted rows, shuffled, limited", next, false, row_count / 10);
+}
+
+// Measures building and merging the small changesets which most individual
+// writes produce, where each IndexSet holds only a few ranges
+static void build_and_merge()
+{
+    const size_t changeset_count = 10000;
+    size_t sum = 0;
+
+    benchmark::run("insert() 10k single-row changesets", 10, [&] {
+        for (size_t i = 0; i < changeset_count; ++i) {
+            _impl::CollectionChangeBuilder c;
+            c.insert(i % 64);
+            sum += c.insertions.count();
+        }
+    });
+    benchmark::run("erase() 10k single-row changesets", 10, [&] {
+        for (size_t i = 0; i < changeset_count; ++i) {
+            _impl::CollectionChangeBuilder c;
+            c.erase(i % 64);
+            sum += c.deletions.count();
+        }
+    });
+    benchmark::run("insert(), modify() and erase() 10k three-range changesets", 10, [&] {
+        for (size_t i = 0; i < changeset_count; ++i) {
+            _impl::CollectionChangeBuilder c;
+            c.insert(i % 64);
+            c.insert(i % 64 + 10, 2);
+            c.modify(i % 64 + 20);
+            c.erase(i % 64 + 30);
+            sum += c.insertions.count() + c.modifications.count();
+        }
+    });
+    benchmark::run("merge() 10k single-row changesets", 10, [&] {
+        _impl::CollectionChangeBuilder accumulated;
+        for (size_t i = 0; i < changeset_count; ++i) {
+            _impl::CollectionChangeBuilder c;
+            c.modify(i % 64);
+            accumulated.merge(std::move(c));
+        }
+        sum += accumulated.modifications.count();
+    });
+    benchmark::run("copy 10k three-range changesets", 10, [&] {
+        _impl::CollectionChangeBuilder c;
+        c.insert(5);
+        c.modify(20);
+        c.erase(40);
+        for (size_t i = 0; i < changeset_count; ++i) {
+            CollectionChangeSet copy(c);
+            sum += copy.insertions.count();
+        }
+    });
+    benchmark::run("move_over() 20k random rows of 100k", 10, [&] {
+        std::mt19937 rng(0);
+        _impl::CollectionChangeBuilder c;
+        for (size_t size = 100000; size > 80000; --size)
+            c.move_over(rng() % size, size - 1);
+        c.parse_complete();
+        sum += c.moves.size();
+    });
+    benchmark::run("move_over() the first 20k rows of 100k", 10, [&] {
+        _impl::CollectionChangeBuilder c;
+        for (size_t size = 100000; size > 80000; --size)
+            c.move_over(0, size - 1);
+        c.parse_complete();
+        sum += c.moves.size();
+    });
+
+    // Keep the results observable so that the work isn't optimized out
+    printf("(checksum %zu)\n", sum);
+}
+
+int main()
+{
+    calculate();
+    calculate_large();
+    build_and_merge();
+}
@@ -0,0 +1,68 @@
+////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2016 Realm Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+////////////////////////////////////////////////////////////////////////////
+
+#include "benchmark.hpp"
+
+#include "index_set.hpp"
+
+using namespace realm;
+
+// Measures the positional queries on an IndexSet which is as fragmented as
+// possible, i.e. where no two indices are adjacent
+int main()
+{
+    const size_t index_count = 1000000;
+    const size_t queries = 1000;
+
+    IndexSet set;
+    for (size_t i = 0; i < index_count; ++i)
+        set.add(i * 2 + 1);
+
+    size_t sum = 0;
+    size_t index = 0;
+    auto next_index = [&] { return index = (index + 7919) % (index_count * 2); };
+
+    benchmark::run("shift() x1000", 100, [&] {
+        for (size_t i = 0; i < queries; ++i)
+            sum += set.shift(next_index() / 2);
+    });
+    benchmark::run("unshift() x1000", 100, [&] {
+        for (size_t i = 0; i < queries; ++i)
+            sum += set.unshift(next_index() & ~size_t(1));
+    });
+    benchmark::run("count(0, i) x1000", 100, [&] {
+        for (size_t i = 0; i < queries; ++i)
+            sum += set.count(0, next_index());
+    });
+    benchmark::run("contains() x1000", 100, [&] {
+        for (size_t i = 0; i < queries; ++i)
+            sum += set.contains(next_index());
+    });
+    // Adding and then removing an index merges and then splits ranges, which
+    // changes the counts of the chunks after it
+    benchmark::run("add() and remove() x1000", 100, [&] {
+        for (size_t i = 0; i < queries; ++i) {
+            size_t even = next_index() & ~size_t(1);
+            set.add(even);
+            set.remove(even);
+        }
+    });
+
+    // Keep the results observable so that the queries aren't optimized out
+    printf("(checksum %zu)\n", sum);
+}
@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2016 Realm Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+////////////////////////////////////////////////////////////////////////////
+
+#include "benchmark.hpp"
+
+#include "util/test_file.hpp"
+
+#include "object_schema.hpp"
+#include "property.hpp"
+#include "results.hpp"
+#include "schema.hpp"
+
+#include <realm/group_shared.hpp>
+#include <realm/query_engine.hpp>
+
+using namespace realm;
+
+// Measures the time taken to calculate and deliver notifications for a query
+// over a large table of objects which each link to another object, when each
+// commit modifies a single one of the linked objects
+int main()
+{
+    const size_t row_count = 1000000;
+
+    InMemoryTestFile config;
+    config.cache = false;
+    config.automatic_change_notifications = false;
+
+    auto r = Realm::get_shared_realm(config);
+    r->update_schema({
+        {"object", {
+            {"value", PropertyType::Int},
+            {"link", PropertyType::Object, "target", "", false, false, true}
+        }},
+        {"target", {
+            {"value", PropertyType::Int}
+        }}
+    });
+
+    auto table = r->read_group().get_table("class_object");
+    auto target = r->read_group().get_table("class_target");
+    r->begin_transaction();
+    table->add_empty_row(row_count);
+    target->add_empty_row(row_count);
+    for (size_t i = 0; i < row_count; ++i) {
+        table->set_int(0, i, i % 100);
+        table->set_link(1, i, i);
+    }
+    r->commit_transaction();
+
+    auto run = [&](const char* name, Query query) {
+        Results results(r, std::move(query));
+        size_t notification_calls = 0;
+        auto token = results.add_notification_callback([&](CollectionChangeSet, std::exception_ptr) {
+            ++notification_calls;
+        });
+        advance_and_notify(*r);
+
+        size_t row = 0;
+        benchmark::run(name, 100, [&] {
+            r->begin_transaction();
+            target->set_int(0, row, target->get_int(0, row) + 1);
+            row = (row + 7919) % row_count;
+            r->commit_transaction();
+            advance_and_notify(*r);
+        });
+    };
+
+    run("modify one linked row of 1M, 1% of rows match", table->where().equal(0, 5));
+    run("modify one linked row of 1M, all rows match", table->where());
+}
@@ -0,0 +1,139 @@
+////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2016 Realm Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+////////////////////////////////////////////////////////////////////////////
+
+#include "benchmark.hpp"
+
+#include "util/test_file.hpp"
+
+#include "object_accessor.hpp"
+#include "object_schema.hpp"
+#include "property.hpp"
+#include "schema.hpp"
+
+#include <unordered_map>
+
+using namespace realm;
+
+namespace {
+// A minimal native representation: an object is a map from property name to
+// either an integer or a string
+struct Value {
+    int64_t int_value = 0;
+    std::string string_value;
+    const std::unordered_map<std::string, Value>* dict = nullptr;
+};
+using Dict = std::unordered_map<std::string, Value>;
+struct Context { };
+}
+
+namespace realm {
+template<>
+class NativeAccessor<Value, Context*> {
+public:
+    static bool dict_has_value_for_key(Context*, Value dict, const std::string &prop_name)
+    {
+        return dict.dict->count(prop_name);
+    }
+    static Value dict_value_for_key(Context*, Value dict, const std::string &prop_name)
+    {
+        return dict.dict->at(prop_name);
+    }
+
+    static bool has_default_value_for_property(Context*, Realm*, const ObjectSchema&, const std::string&) { return false; }
+    static Value default_value_for_property(Context*, Realm*, const ObjectSchema&, const std::string&) { return {}; }
+
+    static bool to_bool(Context*, Value &v) { return v.int_value; }
+    static long long to_long(Context*, Value &v) { return v.int_value; }
+    static float to_float(Context*, Value &v) { return v.int_value; }
+    static double to_double(Context*, Value &v) { return v.int_value; }
+    static std::string to_string(Context*, Value &v) { return v.string_value; }
+    static std::string to_binary(Context*, Value &v) { return v.string_value; }
+    static Timestamp to_timestamp(Context*, Value &v) { return Timestamp(v.int_value, 0); }
+    static Mixed to_mixed(Context*, Value&) { throw std::logic_error("'Any' type is unsupported"); }
+
+    static bool is_null(Context*, Value &) { return false; }
+    static Value null_value(Context*) { return {}; }
+
+    static size_t to_object_index(Context*, SharedRealm, Value&, const std::string&, bool) { return 0; }
+    static size_t list_size(Context*, Value&) { return 0; }
+    static Value list_value_at_index(Context*, Value&, size_t) { return {}; }
+};
+}
+
+// Measures the time taken to import a large number of objects one at a time
+// with Object::create() compared to as a batch with Object::create_all()
+int main()
+{
+    const size_t object_count = 100000;
+
+    InMemoryTestFile config;
+    config.cache = false;
+    config.automatic_change_notifications = false;
+
+    auto r = Realm::get_shared_realm(config);
+    r->update_schema({
+        {"object", {
+            {"pk", PropertyType::Int, "", "", true},
+            {"name", PropertyType::String},
+            {"value", PropertyType::Int},
+        }},
+        {"no pk", {
+            {"name", PropertyType::String},
+            {"value", PropertyType::Int},
+        }},
+    });
+    auto& object_schema = *r->schema().find("object");
+    auto& no_pk_schema = *r->schema().find("no pk");
+
+    std::vector<Dict> dicts(object_count);
+    std::vector<Value> values(object_count);
+    for (size_t i = 0; i < object_count; ++i) {
+        dicts[i]["pk"].int_value = i * 7919 % object_count;
+        dicts[i]["name"].string_value = util::format("object %1", i);
+        dicts[i]["value"].int_value = i;
+        values[i].dict = &dicts[i];
+    }
+
+    Context ctx;
+    auto create_each = [&](ObjectSchema const& os, bool try_update) {
+        for (auto& value : values)
+            Object::create(&ctx, r, os, value, try_update);
+    };
+    auto create_all = [&](ObjectSchema const& os, bool try_update) {
+        Object::create_all(&ctx, r, os, values, try_update);
+    };
+    auto run = [&](const char* name, ObjectSchema const& os, bool try_update, auto&& fn) {
+        benchmark::run(name, 5, [&] {
+            r->begin_transaction();
+            fn(os, try_update);
+            r->cancel_transaction();
+        });
+    };
+
+    run("create 100k objects without a primary key, one at a time", no_pk_schema, false, create_each);
+    run("create 100k objects without a primary key, as a batch", no_pk_schema, false, create_all);
+    run("create 100k objects with a primary key, one at a time", object_schema, false, create_each);
+    run("create 100k objects with a primary key, as a batch", object_schema, false, create_all);
+
+    r->begin_transaction();
+    create_all(object_schema, false);
+    r->commit_transaction();
+
+    run("update 100k existing objects, one at a time", object_schema, true, create_each);
+    run("update 100k existing objects, as a batch", object_schema, true, create_all);
+}
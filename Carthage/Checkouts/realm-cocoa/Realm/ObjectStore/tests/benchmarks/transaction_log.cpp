@@ -0,0 +1,109 @@
+////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2016 Realm Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+////////////////////////////////////////////////////////////////////////////
+
+#include "benchmark.hpp"
+
+#include "util/test_file.hpp"
+
+#include "impl/collection_notifier.hpp"
+#include "impl/transact_log_handler.hpp"
+#include "object_schema.hpp"
+#include "property.hpp"
+#include "schema.hpp"
+
+#include <realm/commit_log.hpp>
+#include <realm/group_shared.hpp>
+
+#include <random>
+
+using namespace realm;
+
+// Measures the time taken to parse the transaction log for a commit which
+// deleted a large number of rows from an unsorted table with
+// move_last_over(), tracking the moves as the async notifiers do
+int main()
+{
+    const size_t row_count = 100000;
+
+    InMemoryTestFile config;
+    config.cache = false;
+    config.automatic_change_notifications = false;
+
+    auto r = Realm::get_shared_realm(config);
+    r->update_schema({
+        {"object", {
+            {"value", PropertyType::Int}
+        }}
+    });
+
+    auto table = r->read_group().get_table("class_object");
+    r->begin_transaction();
+    table->add_empty_row(row_count);
+    for (size_t i = 0; i < row_count; ++i)
+        table->set_int(0, i, i);
+    r->commit_transaction();
+
+    auto history = make_client_history(config.path, config.encryption_key.data());
+    SharedGroup sg(*history, SharedGroup::durability_MemOnly, config.encryption_key.data());
+
+    auto run = [&](const char* name, auto&& erase_rows) {
+        // Hold a read transaction on the version before the deletions so
+        // that it can be advanced from repeatedly
+        SharedGroup pin(*history, SharedGroup::durability_MemOnly, config.encryption_key.data());
+        auto& group = pin.begin_read();
+        auto initial_version = pin.get_version_of_current_transaction();
+
+        r->begin_transaction();
+        erase_rows();
+        r->commit_transaction();
+
+        size_t moves = 0;
+        benchmark::run(name, 10, [&] {
+            sg.begin_read(initial_version);
+            _impl::TransactionChangeInfo info;
+            info.table_modifications_needed.resize(group.size(), true);
+            info.table_moves_needed.resize(group.size(), true);
+            _impl::transaction::advance(sg, info);
+            moves += info.tables[table->get_index_in_group()].moves.size();
+            sg.end_read();
+        });
+        printf("(%zu moves)\n", moves);
+
+        // Restore the deleted rows for the next case
+        r->begin_transaction();
+        table->clear();
+        table->add_empty_row(row_count);
+        for (size_t i = 0; i < row_count; ++i)
+            table->set_int(0, i, i);
+        r->commit_transaction();
+    };
+
+    run("erase 20k random rows of 100k", [&] {
+        std::mt19937 rng(0);
+        for (size_t size = row_count; size > row_count - 20000; --size)
+            table->move_last_over(rng() % size);
+    });
+    run("erase the first 20k rows of 100k", [&] {
+        for (size_t i = 0; i < 20000; ++i)
+            table->move_last_over(0);
+    });
+    run("erase every other row of 100k", [&] {
+        for (size_t i = row_count / 2; i > 0; --i)
+            table->move_last_over(i * 2 - 1);
+    });
+}
@@ -22,7 +22,10 @@
 
 #include "util/index_helpers.hpp"
 
+#include <algorithm>
 #include <limits>
+#include <numeric>
+#include <random>
 
 using namespace realm;
 
@@ -749,6 +752,361 @@ TEST_CASE("collection_change: calculate() sorted") {
     }
 }
 
+TEST_CASE("collection_change: calculate() sorted with a move limit") {
+    _impl::CollectionChangeBuilder c;
+
+    auto all_modified = [](size_t) { return true; };
+    auto none_modified = [](size_t) { return false; };
+    const auto npos = size_t(-1);
+
+    auto calc = [&](std::vector<size_t> old_rows, std::vector<size_t> new_rows, size_t max_moved_rows) {
+        return _impl::CollectionChangeBuilder::calculate(old_rows, new_rows, none_modified, false, max_moved_rows);
+    };
+
+    SECTION("returns an empty set when input and output are identical") {
+        c = calc({1, 2, 3}, {1, 2, 3}, 0);
+        REQUIRE(c.empty());
+    }
+
+    SECTION("reports insertions and deletions of rows which did not move") {
+        c = calc({1, 2, 3}, {1, 3, 4}, 0);
+        REQUIRE_INDICES(c.deletions, 1);
+        REQUIRE_INDICES(c.insertions, 2);
+    }
+
+    SECTION("marks modified rows as modified") {
+        c = _impl::CollectionChangeBuilder::calculate({3, 5}, {5, 3}, all_modified, false, 1);
+        REQUIRE_INDICES(c.deletions, 1);
+        REQUIRE_INDICES(c.insertions, 0);
+        REQUIRE_INDICES(c.modifications, 0, 1);
+    }
+
+    SECTION("moves the minimum number of rows") {
+        c = calc({1, 2, 3}, {2, 3, 1}, 1);
+        REQUIRE_INDICES(c.insertions, 2);
+        REQUIRE_INDICES(c.deletions, 0);
+
+        c = calc({1, 2, 3}, {3, 2, 1}, 2);
+        REQUIRE(c.insertions.count() == 2);
+        REQUIRE(c.deletions.count() == 2);
+
+        c = calc({10, 1, 2, 11, 3, 4, 5, 12, 6, 7, 13}, {13, 1, 2, 12, 3, 4, 5, 11, 6, 7, 10}, 4);
+        REQUIRE_INDICES(c.deletions, 0, 3, 7, 10);
+        REQUIRE_INDICES(c.insertions, 0, 3, 7, 10);
+    }
+
+    SECTION("never moves more rows than the unlimited calculation") {
+        std::vector<size_t> prev = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+        std::vector<size_t> next = prev;
+        for (size_t i = 0; i < 100; ++i) {
+            std::rotate(next.begin() + i % 7, next.begin() + i % 7 + 1 + i % 3, next.end());
+            std::swap(next[i % 10], next[(i * 7) % 10]);
+            auto expected = calc(prev, next, npos);
+            c = calc(prev, next, 10);
+            REQUIRE(c.insertions.count() <= expected.insertions.count());
+            REQUIRE(c.deletions.count() == c.insertions.count());
+        }
+    }
+
+    SECTION("handles duplicate rows") {
+        c = calc({1, 1, 2, 2, 3, 3}, {3, 3, 1, 1, 2, 2}, 2);
+        REQUIRE_INDICES(c.deletions, 4, 5);
+        REQUIRE_INDICES(c.insertions, 0, 1);
+
+        c = calc({1, 2, 3, 1}, {1, 1, 1, 1, 2, 3}, 1);
+        REQUIRE(c.insertions.count() == 3);
+        REQUIRE(c.deletions.count() == 1);
+    }
+
+    SECTION("reports a reload when more rows than the limit would move") {
+        c = _impl::CollectionChangeBuilder::calculate({npos, 1, 2, 3}, {3, 2, 1, 4}, all_modified, false, 1);
+        REQUIRE_INDICES(c.deletions, 0, 1, 2, 3);
+        REQUIRE_INDICES(c.insertions, 0, 1, 2, 3);
+        REQUIRE(c.modifications.empty());
+        REQUIRE(c.moves.empty());
+    }
+
+    SECTION("is ignored for rows in table order") {
+        c = _impl::CollectionChangeBuilder::calculate({1, 2, 3}, {1, 3}, none_modified, true, 0);
+        REQUIRE_INDICES(c.deletions, 1);
+        REQUIRE(c.insertions.empty());
+    }
+}
+
+TEST_CASE("collection_change: calculate_incremental()") {
+    _impl::CollectionChangeBuilder c, table;
+    const auto npos = size_t(-1);
+
+    auto calc = [&](std::vector<size_t> const& prev, std::vector<size_t> const& next) {
+        table.parse_complete();
+        return _impl::CollectionChangeBuilder::calculate_incremental(prev, next, table);
+    };
+
+    SECTION("returns an empty set when nothing changed") {
+        c = calc({1, 3, 5}, {1, 3, 5});
+        REQUIRE(c.empty());
+    }
+
+    SECTION("ignores changes to rows which are not in either set") {
+        table.modify(2);
+        table.insert(10);
+        table.move_over(4, 10);
+        c = calc({1, 3, 5}, {1, 3, 5});
+        REQUIRE(c.empty());
+    }
+
+    SECTION("marks modified rows which still match as modified") {
+        table.modify(3);
+        c = calc({1, 3, 5}, {1, 3, 5});
+        REQUIRE_INDICES(c.modifications, 1);
+        REQUIRE(c.insertions.empty());
+        REQUIRE(c.deletions.empty());
+    }
+
+    SECTION("marks modified rows which no longer match as deleted") {
+        table.modify(3);
+        c = calc({1, 3, 5}, {1, 5});
+        REQUIRE_INDICES(c.deletions, 1);
+        REQUIRE(c.modifications.empty());
+    }
+
+    SECTION("marks modified rows which now match as inserted but not modified") {
+        table.modify(4);
+        c = calc({1, 3, 5}, {1, 3, 4, 5});
+        REQUIRE_INDICES(c.insertions, 2);
+        REQUIRE(c.modifications.empty());
+    }
+
+    SECTION("marks new matching rows as inserted") {
+        table.insert(10, 2);
+        c = calc({1, 3}, {1, 3, 11});
+        REQUIRE_INDICES(c.insertions, 2);
+    }
+
+    SECTION("marks deleted rows as deleted") {
+        table.move_over(5, 5);
+        c = calc({1, 3, 5}, {1, 3});
+        REQUIRE_INDICES(c.deletions, 2);
+    }
+
+    SECTION("marks all rows as deleted when the table is cleared") {
+        table.clear(10);
+        c = calc({1, 3, 5}, {});
+        REQUIRE_INDICES(c.deletions, 0, 1, 2);
+    }
+
+    SECTION("marks rows moved by move_last_over() as moved") {
+        table.move_over(1, 9);
+        c = calc({1, 3, 9}, {1, 3});
+        REQUIRE_INDICES(c.deletions, 0, 2);
+        REQUIRE_INDICES(c.insertions, 0);
+        REQUIRE_MOVES(c, {2, 0});
+    }
+
+    SECTION("does not report moves which do not change the position of the row") {
+        table.move_over(4, 9);
+        c = calc({1, 3, 9}, {1, 3, 4});
+        REQUIRE(c.empty());
+    }
+
+    SECTION("produces the same results as calculate() for each possible move_last_over()") {
+        std::vector<size_t> prev = {0, 2, 3, 6, 7, 9};
+        for (size_t row = 0; row < 10; ++row) {
+            for (size_t modified = 0; modified < 9; ++modified) {
+                CAPTURE(row);
+                CAPTURE(modified);
+
+                table = {};
+                table.move_over(row, 9);
+                table.modify(modified);
+                table.parse_complete();
+
+                // Map the old rows to new rows, and make the modified row stop matching
+                std::vector<size_t> mapped, next;
+                for (auto old_row : prev) {
+                    size_t new_row = old_row == row ? npos : old_row == 9 ? row : old_row;
+                    mapped.push_back(new_row);
+                    if (new_row != npos && new_row != modified)
+                        next.push_back(new_row);
+                }
+                std::sort(next.begin(), next.end());
+
+                auto expected = _impl::CollectionChangeBuilder::calculate(mapped, next, [&](size_t row) {
+                    return table.modifications.contains(row);
+                }, true);
+                c = _impl::CollectionChangeBuilder::calculate_incremental(prev, next, table);
+
+                auto indexes = [](IndexSet const& s) {
+                    return std::vector<size_t>(s.as_indexes().begin(), s.as_indexes().end());
+                };
+                REQUIRE(indexes(c.deletions) == indexes(expected.deletions));
+                REQUIRE(indexes(c.insertions) == indexes(expected.insertions));
+                REQUIRE(indexes(c.modifications) == indexes(expected.modifications));
+                REQUIRE(c.moves.size() == expected.moves.size());
+            }
+        }
+    }
+}
+
+TEST_CASE("collection_change: calculate_incremental_sorted()") {
+    _impl::CollectionChangeBuilder c, table;
+    const auto npos = size_t(-1);
+
+    auto calc = [&](std::vector<size_t> const& prev, std::vector<size_t> const& next) {
+        table.parse_complete();
+        return _impl::CollectionChangeBuilder::calculate_incremental_sorted(prev, next, table);
+    };
+
+    SECTION("returns an empty set when nothing changed") {
+        c = calc({5, 1, 3}, {5, 1, 3});
+        REQUIRE(c.empty());
+    }
+
+    SECTION("ignores changes to rows which are not in either set") {
+        table.modify(2);
+        table.insert(10);
+        c = calc({5, 1, 3}, {5, 1, 3});
+        REQUIRE(c.empty());
+    }
+
+    SECTION("marks modified rows which did not move as modified") {
+        table.modify(1);
+        c = calc({5, 1, 3}, {5, 1, 3});
+        REQUIRE_INDICES(c.modifications, 1);
+        REQUIRE(c.insertions.empty());
+        REQUIRE(c.deletions.empty());
+    }
+
+    SECTION("moves modified rows which changed position") {
+        table.modify(1);
+        c = calc({5, 1, 3}, {1, 5, 3});
+        REQUIRE_INDICES(c.deletions, 1);
+        REQUIRE_INDICES(c.insertions, 0);
+        REQUIRE_INDICES(c.modifications, 0);
+    }
+
+    SECTION("moves the fewest modified rows when several are between the same unchanged rows") {
+        table.modify(1);
+        table.modify(2);
+        table.modify(4);
+        c = calc({0, 1, 2, 4, 3}, {0, 4, 1, 2, 3});
+        REQUIRE_INDICES(c.deletions, 3);
+        REQUIRE_INDICES(c.insertions, 1);
+        REQUIRE_INDICES(c.modifications, 1, 2, 3);
+    }
+
+    SECTION("marks modified rows which no longer match as deleted") {
+        table.modify(1);
+        c = calc({5, 1, 3}, {5, 3});
+        REQUIRE_INDICES(c.deletions, 1);
+        REQUIRE(c.insertions.empty());
+        REQUIRE(c.modifications.empty());
+    }
+
+    SECTION("marks modified rows which now match as inserted") {
+        table.modify(4);
+        c = calc({5, 1, 3}, {4, 5, 1, 3});
+        REQUIRE_INDICES(c.insertions, 0);
+        REQUIRE(c.deletions.empty());
+        REQUIRE(c.modifications.empty());
+    }
+
+    SECTION("marks new matching rows as inserted") {
+        table.insert(10, 2);
+        c = calc({5, 1, 3}, {5, 11, 1, 3});
+        REQUIRE_INDICES(c.insertions, 1);
+    }
+
+    SECTION("marks deleted rows as deleted") {
+        table.move_over(5, 5);
+        c = calc({5, 1, 3}, {1, 3});
+        REQUIRE_INDICES(c.deletions, 0);
+    }
+
+    SECTION("marks all rows as deleted when the table is cleared") {
+        table.clear(10);
+        c = calc({5, 1, 3}, {});
+        REQUIRE_INDICES(c.deletions, 0, 1, 2);
+    }
+
+    SECTION("handles rows moved by move_last_over()") {
+        table.move_over(1, 9);
+        c = calc({9, 5, 3}, {1, 5, 3});
+        REQUIRE(c.empty());
+
+        c = calc({9, 5, 3}, {5, 1, 3});
+        REQUIRE_INDICES(c.deletions, 0);
+        REQUIRE_INDICES(c.insertions, 1);
+    }
+
+    SECTION("produces changes which turn the old rows into the new rows for random modifications") {
+        std::mt19937 rng(1);
+        for (int iteration = 0; iteration < 500; ++iteration) {
+            CAPTURE(iteration);
+
+            // Rows are sorted by value with the row index as a tiebreaker,
+            // and only rows with even values match
+            std::vector<size_t> values(20);
+            for (auto& value : values)
+                value = rng() % 10;
+            auto sorted_rows = [&] {
+                std::vector<size_t> rows;
+                for (size_t i = 0; i < values.size(); ++i) {
+                    if (values[i] % 2 == 0)
+                        rows.push_back(i);
+                }
+                std::stable_sort(rows.begin(), rows.end(),
+                                 [&](size_t a, size_t b) { return values[a] < values[b]; });
+                return rows;
+            };
+
+            auto prev = sorted_rows();
+            table = {};
+            // The original row index of each current row
+            std::vector<size_t> ids(values.size());
+            std::iota(ids.begin(), ids.end(), 0);
+            for (int i = rng() % 5; i > 0; --i) {
+                size_t row = rng() % values.size();
+                values[row] = rng() % 10;
+                table.modify(row);
+            }
+            for (int i = rng() % 3; i > 0; --i) {
+                size_t row = rng() % values.size();
+                table.move_over(row, values.size() - 1);
+                values[row] = values.back();
+                values.pop_back();
+                ids[row] = ids.back();
+                ids.pop_back();
+            }
+            auto next = sorted_rows();
+            c = calc(prev, next);
+
+            // Map the old rows to their new row indices, then apply the changes
+            // to them
+            std::vector<size_t> mapped;
+            for (auto row : prev) {
+                auto it = std::find(ids.begin(), ids.end(), row);
+                mapped.push_back(it != ids.end() ? it - ids.begin() : npos);
+            }
+
+            std::vector<size_t> rows;
+            for (size_t i = 0; i < prev.size(); ++i) {
+                if (!c.deletions.contains(i))
+                    rows.push_back(mapped[i]);
+            }
+            for (auto i : c.insertions.as_indexes())
+                rows.insert(rows.begin() + i, next[i]);
+            REQUIRE(rows == next);
+
+            // Modified rows which are in both sets are reported as modified
+            for (size_t i = 0; i < next.size(); ++i) {
+                bool was_present = std::find(mapped.begin(), mapped.end(), next[i]) != mapped.end();
+                REQUIRE(c.modifications.contains(i) == (was_present && table.modifications.contains(next[i])));
+            }
+        }
+    }
+}
+
 TEST_CASE("collection_change: merge()") {
     _impl::CollectionChangeBuilder c;
 
@@ -0,0 +1,119 @@
+////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2016 Realm Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+////////////////////////////////////////////////////////////////////////////
+
+#include "catch.hpp"
+
+#include "util/epoll/event_loop.hpp"
+#include "util/epoll/event_loop_signal.hpp"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+
+using namespace realm;
+using namespace realm::util;
+
+using Signal = EventLoopSignal<std::function<void()>>;
+
+TEST_CASE("EventLoopSignal") {
+    auto loop = EventLoop::current();
+    // Drain anything left over from previous tests using this thread's loop
+    while (loop->process_pending()) { }
+
+    int calls = 0;
+    std::thread::id called_on;
+    auto signal = std::make_unique<Signal>([&] {
+        ++calls;
+        called_on = std::this_thread::get_id();
+    });
+
+    SECTION("does not invoke the callback until notified") {
+        REQUIRE_FALSE(loop->process_pending());
+        REQUIRE(calls == 0);
+    }
+
+    SECTION("invokes the callback on the thread which created it when notified from another thread") {
+        std::thread([&] { signal->notify(); }).join();
+        REQUIRE(calls == 0);
+        REQUIRE(loop->run_once(1000));
+        REQUIRE(calls == 1);
+        REQUIRE(called_on == std::this_thread::get_id());
+    }
+
+    SECTION("does not invoke the callback on other threads' event loops") {
+        bool ran_any = true;
+        std::thread([&] {
+            signal->notify();
+            ran_any = EventLoop::current()->run_once(50);
+        }).join();
+        REQUIRE_FALSE(ran_any);
+        REQUIRE(calls == 0);
+        REQUIRE(loop->process_pending());
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("coalesces multiple notifications before the loop runs") {
+        signal->notify();
+        signal->notify();
+        std::thread([&] { signal->notify(); }).join();
+        REQUIRE(loop->process_pending());
+        REQUIRE(calls == 1);
+        REQUIRE_FALSE(loop->process_pending());
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("can be notified again after the callback runs") {
+        signal->notify();
+        loop->process_pending();
+        signal->notify();
+        loop->process_pending();
+        REQUIRE(calls == 2);
+    }
+
+    SECTION("does not invoke the callback after being destroyed on another thread") {
+        signal->notify();
+        std::thread([&] { signal.reset(); }).join();
+        REQUIRE_FALSE(loop->process_pending());
+        REQUIRE(calls == 0);
+    }
+
+    SECTION("can be destroyed on another thread while the owning thread runs its loop") {
+        signal.reset();
+        auto counter = std::make_shared<std::atomic<int>>(0);
+        for (int i = 0; i < 200; ++i) {
+            auto s = std::make_shared<Signal>([counter] { ++*counter; });
+            std::atomic<bool> done{false};
+            std::thread thread([&] {
+                s->notify();
+                s.reset();
+                done = true;
+            });
+            while (!done)
+                loop->process_pending();
+            thread.join();
+        }
+        loop->process_pending();
+        // Whether each callback ran depends on timing, but none may run after
+        // all of the signals have been destroyed
+        int count = *counter;
+        REQUIRE(count <= 200);
+        REQUIRE_FALSE(loop->process_pending());
+        REQUIRE(*counter == count);
+    }
+}
@@ -0,0 +1,219 @@
+////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2016 Realm Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+////////////////////////////////////////////////////////////////////////////
+
+#include "catch.hpp"
+
+#include "util/test_file.hpp"
+
+#include "impl/realm_coordinator.hpp"
+#include "object_schema.hpp"
+#include "property.hpp"
+#include "results.hpp"
+#include "schema.hpp"
+#include "util/epoll/event_loop.hpp"
+
+#include <realm/group_shared.hpp>
+
+#include <chrono>
+#include <dirent.h>
+#include <fstream>
+#include <string>
+#include <thread>
+
+using namespace realm;
+
+namespace {
+// Run this thread's event loop until `fn` returns true, or give up after a
+// few seconds
+template<typename Fn>
+bool run_event_loop_until(Fn&& fn)
+{
+    auto loop = util::EventLoop::current();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!fn()) {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        loop->run_once(10);
+    }
+    return true;
+}
+
+// Check if any thread of this process has the given name
+bool thread_exists_with_name(std::string const& name)
+{
+    DIR* dir = opendir("/proc/self/task");
+    if (!dir)
+        return false;
+    bool found = false;
+    while (auto entry = readdir(dir)) {
+        std::ifstream comm(std::string("/proc/self/task/") + entry->d_name + "/comm");
+        std::string thread_name;
+        if (std::getline(comm, thread_name) && thread_name == name) {
+            found = true;
+            break;
+        }
+    }
+    closedir(dir);
+    return found;
+}
+} // anonymous namespace
+
+TEST_CASE("ExternalCommitHelper") {
+    TestFile config;
+    config.cache = false;
+    config.automatic_change_notifications = true;
+
+    auto r = Realm::get_shared_realm(config);
+    r->update_schema({
+        {"object", {
+            {"value", PropertyType::Int}
+        }}
+    });
+    auto table = r->read_group().get_table("class_object");
+
+    auto write = [&] {
+        r->begin_transaction();
+        table->add_empty_row();
+        r->commit_transaction();
+    };
+
+    // A second coordinator for the same file stands in for another process,
+    // as the only way it can learn about commits made via the first one is
+    // through the named pipe
+    auto open_on_other_coordinator = [&](std::shared_ptr<_impl::RealmCoordinator>& coordinator) {
+        coordinator = std::make_shared<_impl::RealmCoordinator>();
+        return coordinator->get_realm(config);
+    };
+
+    SECTION("the listener thread is named") {
+        // The thread names itself once it starts running
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!thread_exists_with_name("Realm notifier") && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        REQUIRE(thread_exists_with_name("Realm notifier"));
+    }
+
+    SECTION("commits made by one coordinator are delivered to Realms on another coordinator") {
+        std::shared_ptr<_impl::RealmCoordinator> coordinator;
+        auto r2 = open_on_other_coordinator(coordinator);
+        REQUIRE(coordinator != _impl::RealmCoordinator::get_existing_coordinator(config.path));
+        auto table2 = r2->read_group().get_table("class_object");
+
+        write();
+        REQUIRE(run_event_loop_until([&] { return table2->size() == 1; }));
+
+        write();
+        REQUIRE(run_event_loop_until([&] { return table2->size() == 2; }));
+    }
+
+    SECTION("async notifiers on another coordinator are run for commits made by the first") {
+        std::shared_ptr<_impl::RealmCoordinator> coordinator;
+        auto r2 = open_on_other_coordinator(coordinator);
+        Results results(r2, r2->read_group().get_table("class_object")->where());
+
+        size_t calls = 0;
+        CollectionChangeSet change;
+        auto token = results.add_notification_callback([&](CollectionChangeSet c, std::exception_ptr err) {
+            REQUIRE_FALSE(err);
+            change = c;
+            ++calls;
+        });
+
+        write();
+        REQUIRE(run_event_loop_until([&] { return calls > 0 && results.size() == 1; }));
+
+        size_t calls_before = calls;
+        write();
+        REQUIRE(run_event_loop_until([&] { return calls > calls_before; }));
+        REQUIRE(results.size() == 2);
+        REQUIRE(change.insertions.contains(1));
+    }
+
+    SECTION("coordinators can be destroyed while their on_change() may be running") {
+        // Each commit makes the listener thread call on_change() for both
+        // coordinators, and tearing down the second one races with that
+        for (int i = 0; i < 20; ++i) {
+            std::weak_ptr<_impl::RealmCoordinator> weak_coordinator;
+            {
+                std::shared_ptr<_impl::RealmCoordinator> coordinator;
+                auto r2 = open_on_other_coordinator(coordinator);
+                weak_coordinator = coordinator;
+                coordinator = nullptr;
+
+                Results results(r2, r2->read_group().get_table("class_object")->where());
+                auto token = results.add_notification_callback([](CollectionChangeSet, std::exception_ptr) { });
+                write();
+            }
+            REQUIRE(weak_coordinator.expired());
+        }
+
+        // The listener thread is still delivering notifications afterwards
+        std::shared_ptr<_impl::RealmCoordinator> coordinator;
+        auto r2 = open_on_other_coordinator(coordinator);
+        auto table2 = r2->read_group().get_table("class_object");
+        size_t size = table2->size();
+        write();
+        REQUIRE(run_event_loop_until([&] { return table2->size() == size + 1; }));
+    }
+
+    SECTION("coordinators which coalesce commits can be destroyed while their on_change() may be running") {
+        // on_change() schedules the run on the coordinator's scheduler thread
+        // rather than running it on the listener thread
+        config.notification_min_interval = std::chrono::milliseconds(1);
+        for (int i = 0; i < 20; ++i) {
+            std::weak_ptr<_impl::RealmCoordinator> weak_coordinator;
+            {
+                std::shared_ptr<_impl::RealmCoordinator> coordinator;
+                auto r2 = open_on_other_coordinator(coordinator);
+                weak_coordinator = coordinator;
+                coordinator = nullptr;
+
+                Results results(r2, r2->read_group().get_table("class_object")->where());
+                auto token = results.add_notification_callback([](CollectionChangeSet, std::exception_ptr) { });
+                write();
+                std::this_thread::sleep_for(std::chrono::milliseconds(i % 3));
+            }
+            // The scheduler thread may briefly hold the last reference
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (!weak_coordinator.expired() && std::chrono::steady_clock::now() < deadline)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            REQUIRE(weak_coordinator.expired());
+        }
+
+        std::shared_ptr<_impl::RealmCoordinator> coordinator;
+        auto r2 = open_on_other_coordinator(coordinator);
+        auto table2 = r2->read_group().get_table("class_object");
+        size_t size = table2->size();
+        write();
+        REQUIRE(run_event_loop_until([&] { return table2->size() == size + 1; }));
+    }
+
+    SECTION("closing one coordinator's Realm does not stop delivery to others") {
+        std::shared_ptr<_impl::RealmCoordinator> coordinator2, coordinator3;
+        auto r2 = open_on_other_coordinator(coordinator2);
+        auto r3 = open_on_other_coordinator(coordinator3);
+        auto table3 = r3->read_group().get_table("class_object");
+
+        r2->close();
+        r2 = nullptr;
+        coordinator2 = nullptr;
+
+        write();
+        REQUIRE(run_event_loop_until([&] { return table3->size() == 1; }));
+    }
+}
@@ -0,0 +1,265 @@
+////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2016 Realm Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+////////////////////////////////////////////////////////////////////////////
+
+#include "catch.hpp"
+
+#include "util/flat_index_map.hpp"
+
+#include <map>
+#include <random>
+
+using namespace realm;
+
+namespace {
+std::map<size_t, size_t> contents(util::FlatIndexMap const& map)
+{
+    std::map<size_t, size_t> ret;
+    map.for_each([&](size_t key, size_t value) {
+        REQUIRE(ret.emplace(key, value).second);
+    });
+    return ret;
+}
+
+// Find `count` keys which hash to `slot` in the initial 8-slot table. This
+// mirrors FlatIndexMap::home() so that tests can construct specific collisions.
+std::vector<size_t> keys_with_home(size_t slot, size_t count, size_t start = 0)
+{
+    std::vector<size_t> keys;
+    for (size_t key = start; keys.size() < count; ++key) {
+        if (size_t((uint64_t(key) * 0x9E3779B97F4A7C15ull) >> 61) == slot)
+            keys.push_back(key);
+    }
+    return keys;
+}
+} // anonymous namespace
+
+TEST_CASE("flat_index_map: basic operations") {
+    util::FlatIndexMap map;
+
+    SECTION("an empty map finds nothing") {
+        REQUIRE(map.empty());
+        REQUIRE(map.find(0) == nullptr);
+        REQUIRE_FALSE(map.erase(0));
+        REQUIRE(contents(map).empty());
+    }
+
+    SECTION("set() adds new keys and updates existing ones") {
+        map.set(1, 10);
+        map.set(2, 20);
+        REQUIRE(map.size() == 2);
+        map.set(1, 11);
+        REQUIRE(map.size() == 2);
+        REQUIRE(*map.find(1) == 11);
+        REQUIRE(*map.find(2) == 20);
+        REQUIRE(map.find(3) == nullptr);
+    }
+
+    SECTION("contains() reports whether a key is present") {
+        REQUIRE_FALSE(map.contains(1));
+        map.set(1, 10);
+        REQUIRE(map.contains(1));
+        REQUIRE_FALSE(map.contains(2));
+        map.erase(1);
+        REQUIRE_FALSE(map.contains(1));
+    }
+
+    SECTION("values can be modified through find()") {
+        map.set(5, 1);
+        *map.find(5) = 2;
+        REQUIRE(*map.find(5) == 2);
+    }
+
+    SECTION("erase() removes only the given key") {
+        map.set(1, 10);
+        map.set(2, 20);
+        REQUIRE(map.erase(1));
+        REQUIRE_FALSE(map.erase(1));
+        REQUIRE(map.find(1) == nullptr);
+        REQUIRE(*map.find(2) == 20);
+        REQUIRE(map.size() == 1);
+    }
+
+    SECTION("clear() removes all entries and the map remains usable") {
+        for (size_t i = 0; i < 100; ++i)
+            map.set(i, i);
+        map.clear();
+        REQUIRE(map.empty());
+        REQUIRE(map.find(5) == nullptr);
+        map.set(5, 6);
+        REQUIRE(contents(map) == (std::map<size_t, size_t>{{5, 6}}));
+    }
+}
+
+TEST_CASE("flat_index_map: collisions") {
+    util::FlatIndexMap map;
+
+    SECTION("erase() shifts back entries which wrapped around the end of the table") {
+        // a and b both want the last slot, so b wraps around to slot 0, and
+        // c wants slot 0 so it's pushed to slot 1
+        auto last = keys_with_home(7, 2);
+        auto first = keys_with_home(0, 1);
+        size_t a = last[0], b = last[1], c = first[0];
+        map.set(a, 1);
+        map.set(b, 2);
+        map.set(c, 3);
+
+        REQUIRE(map.erase(a));
+        REQUIRE(map.find(a) == nullptr);
+        REQUIRE(*map.find(b) == 2);
+        REQUIRE(*map.find(c) == 3);
+
+        REQUIRE(map.erase(b));
+        REQUIRE(*map.find(c) == 3);
+        REQUIRE(map.size() == 1);
+    }
+
+    SECTION("erase() doesn't shift back entries past their home slot") {
+        // b wants slot 7 and wraps to slot 0; c wants slot 1 and is already
+        // there, so erasing b must not move c into slot 0
+        auto last = keys_with_home(7, 2);
+        size_t a = last[0], b = last[1];
+        size_t c = keys_with_home(1, 1)[0];
+        map.set(a, 1);
+        map.set(b, 2);
+        map.set(c, 3);
+
+        REQUIRE(map.erase(b));
+        REQUIRE(*map.find(a) == 1);
+        REQUIRE(*map.find(c) == 3);
+        REQUIRE(map.find(b) == nullptr);
+    }
+
+    SECTION("erase() of a missing key which collides with present keys") {
+        auto keys = keys_with_home(3, 3);
+        map.set(keys[0], 1);
+        map.set(keys[1], 2);
+        REQUIRE_FALSE(map.erase(keys[2]));
+        REQUIRE(map.size() == 2);
+    }
+}
+
+TEST_CASE("flat_index_map: churn") {
+    util::FlatIndexMap map;
+    std::map<size_t, size_t> expected;
+    std::mt19937 rng(0);
+
+    SECTION("random inserts and erases match std::map") {
+        // A small key space produces lots of collisions and erases, while the
+        // growing number of live keys forces the table to grow repeatedly
+        for (size_t i = 0; i < 20000; ++i) {
+            size_t key = rng() % (i / 10 + 8);
+            if (rng() % 3 == 0) {
+                REQUIRE(map.erase(key) == (expected.erase(key) == 1));
+            }
+            else {
+                map.set(key, i);
+                expected[key] = i;
+            }
+            REQUIRE(map.size() == expected.size());
+        }
+        REQUIRE(contents(map) == expected);
+        for (auto& entry : expected)
+            REQUIRE(*map.find(entry.first) == entry.second);
+    }
+
+    SECTION("growing while entries have wrapped around") {
+        auto keys = keys_with_home(7, 3);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            map.set(keys[i], i);
+            expected[keys[i]] = i;
+        }
+        // The table has 8 slots and holds 3 entries, so this grows it
+        for (size_t key = 1000; key < 1100; ++key) {
+            map.set(key, key);
+            expected[key] = key;
+        }
+        REQUIRE(contents(map) == expected);
+    }
+}
+
+TEST_CASE("flat_index_map: copy and move") {
+    util::FlatIndexMap map;
+    for (size_t i = 0; i < 100; ++i)
+        map.set(i * 3, i);
+    auto expected = contents(map);
+
+    SECTION("copying a non-empty map copies the entries") {
+        util::FlatIndexMap copy = map;
+        REQUIRE(contents(copy) == expected);
+        copy.set(1, 1);
+        REQUIRE(map.find(1) == nullptr);
+    }
+
+    SECTION("copy-assigning a non-empty map replaces the entries") {
+        util::FlatIndexMap copy;
+        copy.set(1, 1);
+        copy = map;
+        REQUIRE(contents(copy) == expected);
+    }
+
+    SECTION("copying an empty map produces a usable empty map") {
+        util::FlatIndexMap empty;
+        util::FlatIndexMap copy = empty;
+        REQUIRE(copy.empty());
+        copy.set(1, 1);
+        REQUIRE(*copy.find(1) == 1);
+    }
+
+    SECTION("copy-assigning an empty map clears the target") {
+        util::FlatIndexMap empty;
+        map = empty;
+        REQUIRE(map.empty());
+        REQUIRE(map.find(3) == nullptr);
+        map.set(3, 4);
+        REQUIRE(contents(map) == (std::map<size_t, size_t>{{3, 4}}));
+    }
+
+    SECTION("copy-assigning a cleared map clears the target") {
+        util::FlatIndexMap cleared = map;
+        cleared.clear();
+        map = cleared;
+        REQUIRE(map.empty());
+    }
+
+    SECTION("self-assignment") {
+        auto& ref = map;
+        map = ref;
+        REQUIRE(contents(map) == expected);
+        map = std::move(ref);
+        REQUIRE(contents(map) == expected);
+    }
+
+    SECTION("moving a non-empty map leaves the source empty and usable") {
+        util::FlatIndexMap moved = std::move(map);
+        REQUIRE(contents(moved) == expected);
+        REQUIRE(map.empty());
+        REQUIRE(map.find(3) == nullptr);
+        REQUIRE_FALSE(map.erase(3));
+        map.set(3, 4);
+        REQUIRE(contents(map) == (std::map<size_t, size_t>{{3, 4}}));
+    }
+
+    SECTION("move-assigning an empty map") {
+        util::FlatIndexMap empty;
+        map = std::move(empty);
+        REQUIRE(map.empty());
+        map.set(1, 2);
+        REQUIRE(*map.find(1) == 2);
+        REQUIRE(empty.empty());
+    }
+}
@@ -76,6 +76,28 @@ TEST_CASE("index_set: count()") {
         REQUIRE(set.count(3, 9) == 5);
     }
 
+    SECTION("matches a linear count over many chunks after modifications") {
+        realm::IndexSet set;
+        for (size_t i = 0; i < 200; i += 2)
+            set.add(i);
+        set.remove(50, 20);
+        set.insert_at(101, 5);
+        set.erase_at(3);
+        set.add_shifted(40);
+
+        auto naive_count = [&](size_t start, size_t end) {
+            size_t count = 0;
+            for (auto index : set.as_indexes())
+                count += index >= start && index < end;
+            return count;
+        };
+        for (size_t start = 0; start < 220; start += 7) {
+            for (size_t end = start; end < 220; end += 5)
+                REQUIRE(set.count(start, end) == naive_count(start, end));
+        }
+        REQUIRE(set.count() == naive_count(0, -1));
+    }
+
     SECTION("handles full chunks well") {
         size_t count = realm::_impl::ChunkedRangeVector::max_size * 4;
         realm::IndexSet set;
@@ -584,6 +606,42 @@ TEST_CASE("index_set: shift()") {
         REQUIRE(set.shift(3) == 7);
         REQUIRE(set.shift(4) == 8);
     }
+
+    SECTION("shifts by entire chunks before the index") {
+        set = {1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23};
+        REQUIRE(set.shift(0) == 0);
+        REQUIRE(set.shift(5) == 10);
+        REQUIRE(set.shift(11) == 22);
+        REQUIRE(set.shift(12) == 24);
+        REQUIRE(set.shift(100) == 112);
+    }
+
+    SECTION("is correct after modifications to earlier chunks") {
+        auto naive_shift = [&](size_t index) {
+            for (auto range : set) {
+                if (range.first > index)
+                    break;
+                index += range.second - range.first;
+            }
+            return index;
+        };
+        auto check = [&] {
+            for (size_t i = 0; i < 30; ++i)
+                REQUIRE(set.shift(i) == naive_shift(i));
+        };
+
+        set = {1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23};
+        set.add(2);
+        check();
+        set.erase_at(3);
+        check();
+        set.remove(7);
+        check();
+        set.insert_at(0);
+        check();
+        set.add_shifted(4);
+        check();
+    }
 }
 
 TEST_CASE("index_set: unshift()") {
@@ -597,6 +655,13 @@ TEST_CASE("index_set: unshift()") {
         REQUIRE(set.unshift(7) == 3);
         REQUIRE(set.unshift(8) == 4);
     }
+
+    SECTION("is the inverse of shift() for indices spread over many chunks") {
+        for (size_t i = 0; i < 100; i += 3)
+            set.add(i);
+        for (size_t i = 0; i < 100; ++i)
+            REQUIRE(set.unshift(set.shift(i)) == i);
+    }
 }
 
 TEST_CASE("index_set: clear()") {
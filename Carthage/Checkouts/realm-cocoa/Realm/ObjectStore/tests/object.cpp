@@ -0,0 +1,279 @@
+////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2016 Realm Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+////////////////////////////////////////////////////////////////////////////
+
+#include "catch.hpp"
+
+#include "util/test_file.hpp"
+
+#include "object_accessor.hpp"
+#include "object_schema.hpp"
+#include "property.hpp"
+#include "schema.hpp"
+
+#include <map>
+
+using namespace realm;
+
+namespace {
+// A minimal native representation: an object is a map from property name to
+// either an integer, a string, null or a nested object
+struct Value {
+    int64_t int_value = 0;
+    std::string string_value;
+    const std::map<std::string, Value>* dict = nullptr;
+    bool null = false;
+};
+using Dict = std::map<std::string, Value>;
+struct Context { };
+
+Value int_value(int64_t value)
+{
+    Value v;
+    v.int_value = value;
+    return v;
+}
+
+Value string_value(std::string value)
+{
+    Value v;
+    v.string_value = std::move(value);
+    return v;
+}
+
+Value dict_value(Dict const& dict)
+{
+    Value v;
+    v.dict = &dict;
+    return v;
+}
+}
+
+namespace realm {
+template<>
+class NativeAccessor<Value, Context*> {
+public:
+    static bool dict_has_value_for_key(Context*, Value dict, const std::string &prop_name)
+    {
+        return dict.dict->count(prop_name);
+    }
+    static Value dict_value_for_key(Context*, Value dict, const std::string &prop_name)
+    {
+        return dict.dict->at(prop_name);
+    }
+
+    static bool has_default_value_for_property(Context*, Realm*, const ObjectSchema&, const std::string&) { return false; }
+    static Value default_value_for_property(Context*, Realm*, const ObjectSchema&, const std::string&) { return {}; }
+
+    static bool to_bool(Context*, Value &v) { return v.int_value; }
+    static long long to_long(Context*, Value &v) { return v.int_value; }
+    static float to_float(Context*, Value &v) { return v.int_value; }
+    static double to_double(Context*, Value &v) { return v.int_value; }
+    static std::string to_string(Context*, Value &v) { return v.string_value; }
+    static std::string to_binary(Context*, Value &v) { return v.string_value; }
+    static Timestamp to_timestamp(Context*, Value &v) { return Timestamp(v.int_value, 0); }
+    static Mixed to_mixed(Context*, Value&) { throw std::logic_error("'Any' type is unsupported"); }
+
+    static bool is_null(Context*, Value &v) { return v.null; }
+    static Value null_value(Context*)
+    {
+        Value v;
+        v.null = true;
+        return v;
+    }
+
+    static size_t to_object_index(Context* ctx, SharedRealm realm, Value& value, const std::string& type, bool try_update)
+    {
+        auto& object_schema = *realm->schema().find(type);
+        return Object::create(ctx, realm, object_schema, value, try_update).row().get_index();
+    }
+    static size_t list_size(Context*, Value&) { return 0; }
+    static Value list_value_at_index(Context*, Value&, size_t) { return {}; }
+};
+}
+
+TEST_CASE("Object::create_all()") {
+    InMemoryTestFile config;
+    config.cache = false;
+    config.automatic_change_notifications = false;
+
+    auto r = Realm::get_shared_realm(config);
+    r->update_schema({
+        {"object", {
+            {"pk", PropertyType::Int, "", "", true},
+            {"value", PropertyType::String},
+        }},
+        {"string pk", {
+            {"pk", PropertyType::String, "", "", true},
+            {"value", PropertyType::String},
+        }},
+        {"person", {
+            {"pk", PropertyType::Int, "", "", true},
+            {"name", PropertyType::String},
+            {"friend", PropertyType::Object, "person", "", false, false, true},
+        }},
+        {"no pk", {
+            {"value", PropertyType::String},
+        }},
+    });
+
+    Context ctx;
+    auto& object_schema = *r->schema().find("object");
+    auto& string_pk_schema = *r->schema().find("string pk");
+    auto& person_schema = *r->schema().find("person");
+    auto& no_pk_schema = *r->schema().find("no pk");
+    auto table = r->read_group().get_table("class_object");
+    auto people = r->read_group().get_table("class_person");
+    size_t value_col = object_schema.property_for_name("value")->table_column;
+    size_t name_col = person_schema.property_for_name("name")->table_column;
+    size_t friend_col = person_schema.property_for_name("friend")->table_column;
+
+    auto create_all = [&](ObjectSchema const& os, std::vector<Dict> const& dicts, bool try_update) {
+        std::vector<Value> values;
+        for (auto& dict : dicts)
+            values.push_back(dict_value(dict));
+        return Object::create_all(&ctx, r, os, values, try_update);
+    };
+
+    r->begin_transaction();
+
+    SECTION("creates objects without a primary key") {
+        auto rows = create_all(no_pk_schema, {
+            {{"value", string_value("a")}},
+            {{"value", string_value("b")}},
+        }, false);
+        auto no_pk_table = r->read_group().get_table("class_no pk");
+        REQUIRE(no_pk_table->size() == 2);
+        REQUIRE(no_pk_table->get_string(0, rows[0]) == "a");
+        REQUIRE(no_pk_table->get_string(0, rows[1]) == "b");
+    }
+
+    SECTION("creates objects with a primary key") {
+        auto rows = create_all(object_schema, {
+            {{"pk", int_value(1)}, {"value", string_value("a")}},
+            {{"pk", int_value(2)}, {"value", string_value("b")}},
+        }, false);
+        REQUIRE(table->size() == 2);
+        REQUIRE(rows[0] == table->find_first_int(0, 1));
+        REQUIRE(rows[1] == table->find_first_int(0, 2));
+        REQUIRE(table->get_string(value_col, rows[0]) == "a");
+        REQUIRE(table->get_string(value_col, rows[1]) == "b");
+    }
+
+    SECTION("throws for duplicate primary keys within the batch when not updating") {
+        REQUIRE_THROWS(create_all(object_schema, {
+            {{"pk", int_value(1)}, {"value", string_value("a")}},
+            {{"pk", int_value(1)}, {"value", string_value("b")}},
+        }, false));
+    }
+
+    SECTION("updates the earlier object for duplicate primary keys within the batch") {
+        auto rows = create_all(object_schema, {
+            {{"pk", int_value(1)}, {"value", string_value("a")}},
+            {{"pk", int_value(2)}, {"value", string_value("b")}},
+            {{"pk", int_value(1)}, {"value", string_value("c")}},
+        }, true);
+        REQUIRE(table->size() == 2);
+        REQUIRE(rows[0] == rows[2]);
+        REQUIRE(table->get_string(value_col, rows[0]) == "c");
+    }
+
+    SECTION("updates duplicate string primary keys within the batch") {
+        auto rows = create_all(string_pk_schema, {
+            {{"pk", string_value("a")}, {"value", string_value("1")}},
+            {{"pk", string_value("a")}, {"value", string_value("2")}},
+        }, true);
+        auto string_table = r->read_group().get_table("class_string pk");
+        REQUIRE(string_table->size() == 1);
+        REQUIRE(rows[0] == rows[1]);
+        REQUIRE(string_table->get_string(1, rows[0]) == "2");
+    }
+
+    SECTION("updates existing objects") {
+        create_all(object_schema, {
+            {{"pk", int_value(1)}, {"value", string_value("a")}},
+        }, false);
+        auto rows = create_all(object_schema, {
+            {{"pk", int_value(2)}, {"value", string_value("b")}},
+            {{"pk", int_value(1)}, {"value", string_value("c")}},
+        }, true);
+        REQUIRE(table->size() == 2);
+        REQUIRE(rows[1] == table->find_first_int(0, 1));
+        REQUIRE(table->get_string(value_col, rows[1]) == "c");
+        REQUIRE(table->get_string(value_col, rows[0]) == "b");
+    }
+
+    SECTION("throws for existing objects when not updating") {
+        create_all(object_schema, {
+            {{"pk", int_value(1)}, {"value", string_value("a")}},
+        }, false);
+        REQUIRE_THROWS(create_all(object_schema, {
+            {{"pk", int_value(2)}, {"value", string_value("b")}},
+            {{"pk", int_value(1)}, {"value", string_value("c")}},
+        }, false));
+        REQUIRE(table->get_string(value_col, table->find_first_int(0, 1)) == "a");
+    }
+
+    SECTION("nested objects of the same type") {
+        SECTION("a nested object created earlier in the batch is updated by a later value") {
+            Dict nested = {{"pk", int_value(2)}, {"name", string_value("nested")}};
+            auto rows = create_all(person_schema, {
+                {{"pk", int_value(1)}, {"name", string_value("a")}, {"friend", dict_value(nested)}},
+                {{"pk", int_value(2)}, {"name", string_value("b")}},
+            }, true);
+            REQUIRE(people->size() == 2);
+            REQUIRE(people->get_link(friend_col, rows[0]) == rows[1]);
+            REQUIRE(people->get_string(name_col, rows[1]) == "b");
+        }
+
+        SECTION("a nested object created earlier in the batch is an existing object when not updating") {
+            Dict nested = {{"pk", int_value(2)}, {"name", string_value("nested")}};
+            REQUIRE_THROWS(create_all(person_schema, {
+                {{"pk", int_value(1)}, {"name", string_value("a")}, {"friend", dict_value(nested)}},
+                {{"pk", int_value(2)}, {"name", string_value("b")}},
+            }, false));
+        }
+
+        SECTION("a nested object can refer to an object earlier in the batch") {
+            Dict nested = {{"pk", int_value(1)}, {"name", string_value("updated")}};
+            auto rows = create_all(person_schema, {
+                {{"pk", int_value(1)}, {"name", string_value("a")}},
+                {{"pk", int_value(2)}, {"name", string_value("b")}, {"friend", dict_value(nested)}},
+            }, true);
+            REQUIRE(people->size() == 2);
+            REQUIRE(people->get_link(friend_col, rows[1]) == rows[0]);
+            REQUIRE(people->get_string(name_col, rows[0]) == "updated");
+        }
+
+        SECTION("a nested object with the default primary key value is not confused with a later object") {
+            Dict nested = {{"pk", int_value(0)}, {"name", string_value("zero")}};
+            auto rows = create_all(person_schema, {
+                {{"pk", int_value(1)}, {"name", string_value("a")}, {"friend", dict_value(nested)}},
+                {{"pk", int_value(5)}, {"name", string_value("five")}},
+            }, false);
+            REQUIRE(people->size() == 3);
+            size_t zero = people->find_first_int(0, 0);
+            REQUIRE(zero != not_found);
+            REQUIRE(people->get_string(name_col, zero) == "zero");
+            REQUIRE(people->get_link(friend_col, rows[0]) == zero);
+            REQUIRE(people->get_string(name_col, rows[1]) == "five");
+            REQUIRE(people->get_int(0, rows[1]) == 5);
+        }
+    }
+
+    r->cancel_transaction();
+}
@@ -0,0 +1,224 @@
+////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2016 Realm Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+////////////////////////////////////////////////////////////////////////////
+
+#include "catch.hpp"
+
+#include "util/test_file.hpp"
+
+#include "impl/realm_coordinator.hpp"
+#include "object_schema.hpp"
+#include "parser/parser.hpp"
+#include "parser/query_builder.hpp"
+#include "property.hpp"
+#include "schema.hpp"
+
+#include <thread>
+#include <vector>
+
+using namespace realm;
+using query_builder::CompiledPredicate;
+using query_builder::PredicateCache;
+
+static Schema test_schema()
+{
+    Schema schema = {
+        {"object", {
+            {"value", PropertyType::Int},
+            {"link", PropertyType::Object, "target", "", false, false, true},
+            {"array", PropertyType::Array, "target"},
+        }},
+        {"target", {
+            {"value", PropertyType::Int},
+            {"name", PropertyType::String},
+        }},
+    };
+    // Give the properties distinct column indices as they would have after
+    // being read from a file
+    for (auto& object_schema : schema) {
+        for (size_t i = 0; i < object_schema.persisted_properties.size(); ++i)
+            object_schema.persisted_properties[i].table_column = i;
+    }
+    return schema;
+}
+
+TEST_CASE("CompiledPredicate") {
+    auto schema = test_schema();
+
+    SECTION("resolves each key path once") {
+        CompiledPredicate compiled(parser::parse("value = 1 AND value = 2 OR link.value = 3"), schema, "object");
+        REQUIRE(compiled.key_paths.size() == 2);
+        REQUIRE(compiled.key_paths.at("value").property.name == "value");
+        REQUIRE(compiled.key_paths.at("value").link_columns.empty());
+    }
+
+    SECTION("resolves links to the columns which have to be followed") {
+        CompiledPredicate compiled(parser::parse("link.name = 'a' AND array.value = 1"), schema, "object");
+        auto& link = compiled.key_paths.at("link.name");
+        REQUIRE(link.property.name == "name");
+        REQUIRE(link.property.table_column == 1);
+        REQUIRE(link.link_columns == std::vector<size_t>{1});
+        REQUIRE(compiled.key_paths.at("array.value").link_columns == std::vector<size_t>{2});
+    }
+
+    SECTION("rejects unknown properties and non-link intermediate properties") {
+        REQUIRE_THROWS(CompiledPredicate(parser::parse("missing = 1"), schema, "object"));
+        REQUIRE_THROWS(CompiledPredicate(parser::parse("value.value = 1"), schema, "object"));
+        REQUIRE_THROWS(CompiledPredicate(parser::parse("link.missing = 1"), schema, "object"));
+    }
+}
+
+TEST_CASE("PredicateCache") {
+    auto schema = test_schema();
+
+    SECTION("returns the cached predicate for a repeated query") {
+        PredicateCache cache;
+        auto first = cache.get("value = 1", "object", schema, 1);
+        REQUIRE(cache.misses() == 1);
+        REQUIRE(cache.hits() == 0);
+
+        auto second = cache.get("value = 1", "object", schema, 1);
+        REQUIRE(first == second);
+        REQUIRE(cache.misses() == 1);
+        REQUIRE(cache.hits() == 1);
+    }
+
+    SECTION("is keyed on the query string, object type and schema version") {
+        PredicateCache cache;
+        auto predicate = cache.get("value = 1", "object", schema, 1);
+        REQUIRE(cache.get("value = 2", "object", schema, 1) != predicate);
+        REQUIRE(cache.get("value = 1", "target", schema, 1) != predicate);
+        REQUIRE(cache.get("value = 1", "object", schema, 2) != predicate);
+        REQUIRE(cache.misses() == 4);
+        REQUIRE(cache.hits() == 0);
+
+        REQUIRE(cache.get("value = 1", "object", schema, 1) == predicate);
+        REQUIRE(cache.hits() == 1);
+    }
+
+    SECTION("discards the least recently used predicate when full") {
+        PredicateCache cache(2);
+        auto a = cache.get("value = 1", "object", schema, 1);
+        auto b = cache.get("value = 2", "object", schema, 1);
+        // Using `a` makes `b` the least recently used
+        REQUIRE(cache.get("value = 1", "object", schema, 1) == a);
+        cache.get("value = 3", "object", schema, 1);
+        REQUIRE(cache.misses() == 3);
+
+        REQUIRE(cache.get("value = 1", "object", schema, 1) == a);
+        REQUIRE(cache.misses() == 3);
+        REQUIRE(cache.get("value = 2", "object", schema, 1) != b);
+        REQUIRE(cache.misses() == 4);
+    }
+
+    SECTION("caches nothing with a capacity of zero") {
+        PredicateCache cache(0);
+        auto first = cache.get("value = 1", "object", schema, 1);
+        auto second = cache.get("value = 1", "object", schema, 1);
+        REQUIRE(first);
+        REQUIRE(second);
+        REQUIRE(first != second);
+        REQUIRE(cache.hits() == 0);
+        REQUIRE(cache.misses() == 2);
+    }
+
+    SECTION("clear() discards the cached predicates") {
+        PredicateCache cache;
+        auto predicate = cache.get("value = 1", "object", schema, 1);
+        cache.clear();
+        REQUIRE(cache.get("value = 1", "object", schema, 1) != predicate);
+        REQUIRE(cache.misses() == 2);
+    }
+
+    SECTION("does not cache predicates which fail to compile") {
+        PredicateCache cache;
+        REQUIRE_THROWS(cache.get("missing = 1", "object", schema, 1));
+        REQUIRE_THROWS(cache.get("missing = 1", "object", schema, 1));
+        REQUIRE(cache.misses() == 2);
+        REQUIRE(cache.hits() == 0);
+    }
+
+    SECTION("concurrent get() for the same query all return the cached predicate") {
+        PredicateCache cache;
+        const size_t thread_count = 8, iterations = 100;
+        std::vector<std::shared_ptr<const CompiledPredicate>> results(thread_count * iterations);
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < thread_count; ++i) {
+            threads.emplace_back([&, i] {
+                for (size_t j = 0; j < iterations; ++j)
+                    results[i * iterations + j] = cache.get("value = 1 AND link.name = 'a'", "object", schema, 1);
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+
+        for (auto& result : results)
+            REQUIRE(result == results.front());
+        REQUIRE(cache.hits() + cache.misses() == thread_count * iterations);
+        REQUIRE(cache.misses() >= 1);
+        REQUIRE(cache.misses() <= thread_count);
+    }
+}
+
+TEST_CASE("RealmCoordinator::predicate_cache()") {
+    InMemoryTestFile config;
+    config.cache = false;
+    config.automatic_change_notifications = false;
+    config.schema_version = 1;
+    config.schema = Schema{
+        {"object", {
+            {"value", PropertyType::Int}
+        }},
+    };
+    auto r = Realm::get_shared_realm(config);
+    auto coordinator = _impl::RealmCoordinator::get_existing_coordinator(config.path);
+    auto& cache = coordinator->predicate_cache();
+    cache.get("value = 1", "object", r->schema(), r->schema_version());
+
+    SECTION("is separate for each Realm file") {
+        InMemoryTestFile config2;
+        config2.cache = false;
+        config2.automatic_change_notifications = false;
+        config2.schema_version = 1;
+        config2.schema = config.schema;
+        auto r2 = Realm::get_shared_realm(config2);
+        auto& cache2 = _impl::RealmCoordinator::get_existing_coordinator(config2.path)->predicate_cache();
+        REQUIRE(&cache2 != &cache);
+        cache2.get("value = 1", "object", r2->schema(), r2->schema_version());
+        REQUIRE(cache2.misses() == 1);
+    }
+
+    SECTION("is shared by Realm instances for the same file") {
+        auto r2 = Realm::get_shared_realm(config);
+        auto& cache2 = _impl::RealmCoordinator::get_existing_coordinator(config.path)->predicate_cache();
+        REQUIRE(&cache2 == &cache);
+        cache2.get("value = 1", "object", r2->schema(), r2->schema_version());
+        REQUIRE(cache.hits() == 1);
+    }
+
+    SECTION("is cleared when the schema changes") {
+        r->update_schema({
+            {"object", {
+                {"value", PropertyType::Int},
+                {"value 2", PropertyType::Int}
+            }},
+        }, 2);
+        cache.get("value = 1", "object", r->schema(), 1);
+        REQUIRE(cache.hits() == 0);
+        REQUIRE(cache.misses() == 2);
+    }
+}
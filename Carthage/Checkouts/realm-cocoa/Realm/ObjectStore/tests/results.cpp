@@ -32,6 +32,12 @@
 #include <realm/link_view.hpp>
 #include <realm/query_engine.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <thread>
+
 #include <unistd.h>
 
 using namespace realm;
@@ -164,6 +170,24 @@ TEST_CASE("results: notifications") {
             REQUIRE(called);
         }
 
+        SECTION("callbacks taking a shared changeset are all passed the same changeset") {
+            std::shared_ptr<const CollectionChangeSet> change1, change2;
+            auto token1 = results.add_notification_callback([&](std::shared_ptr<const CollectionChangeSet> c, std::exception_ptr) {
+                change1 = c;
+            });
+            auto token2 = results.add_notification_callback([&](std::shared_ptr<const CollectionChangeSet> c, std::exception_ptr) {
+                change2 = c;
+            });
+
+            write([&] {
+                table->set_int(0, 1, 3);
+            });
+            REQUIRE(change1);
+            REQUIRE(change1 == change2);
+            REQUIRE_INDICES(change1->modifications, 0);
+            REQUIRE_INDICES(change.modifications, 0);
+        }
+
         SECTION("modifications to unrelated tables do not send notifications") {
             write([&] {
                 r->read_group().get_table("class_other object")->add_empty_row();
@@ -440,6 +464,1199 @@ TEST_CASE("results: notifications") {
     }
 }
 
+TEST_CASE("results: key path filtered notifications") {
+    InMemoryTestFile config;
+    config.cache = false;
+    config.automatic_change_notifications = false;
+
+    auto r = Realm::get_shared_realm(config);
+    r->update_schema({
+        {"object", {
+            {"value", PropertyType::Int},
+            {"other", PropertyType::Int},
+            {"link", PropertyType::Object, "linked to object", "", false, false, true}
+        }},
+        {"linked to object", {
+            {"value", PropertyType::Int},
+            {"other", PropertyType::Int}
+        }}
+    });
+
+    auto table = r->read_group().get_table("class_object");
+    auto linked_table = r->read_group().get_table("class_linked to object");
+
+    r->begin_transaction();
+    table->add_empty_row(5);
+    linked_table->add_empty_row(5);
+    for (int i = 0; i < 5; ++i)
+        table->set_link(2, i, i);
+    r->commit_transaction();
+
+    Results results(r, table->where());
+
+    auto write = [&](auto&& f) {
+        r->begin_transaction();
+        f();
+        r->commit_transaction();
+        advance_and_notify(*r);
+    };
+
+    int unfiltered_calls = 0, filtered_calls = 0;
+    CollectionChangeSet unfiltered_change, filtered_change;
+    auto unfiltered_token = results.add_notification_callback([&](CollectionChangeSet c, std::exception_ptr) {
+        unfiltered_change = c;
+        ++unfiltered_calls;
+    });
+
+    auto add_filtered = [&](KeyPathArray key_paths) {
+        return results.add_notification_callback([&](CollectionChangeSet c, std::exception_ptr) {
+            filtered_change = c;
+            ++filtered_calls;
+        }, std::move(key_paths));
+    };
+
+    SECTION("modifications to observed properties are reported") {
+        auto token = add_filtered({"value"});
+        advance_and_notify(*r);
+        REQUIRE(filtered_calls == 1);
+
+        write([&] { table->set_int(0, 1, 5); });
+        REQUIRE(filtered_calls == 2);
+        REQUIRE_INDICES(filtered_change.modifications, 1);
+    }
+
+    SECTION("modifications to other properties are not reported") {
+        auto token = add_filtered({"value"});
+        advance_and_notify(*r);
+
+        write([&] { table->set_int(1, 1, 5); });
+        REQUIRE(unfiltered_calls == 2);
+        REQUIRE_INDICES(unfiltered_change.modifications, 1);
+        REQUIRE(filtered_calls == 1);
+    }
+
+    SECTION("insertions and deletions are reported regardless of the properties modified") {
+        auto token = add_filtered({"value"});
+        advance_and_notify(*r);
+
+        write([&] {
+            table->set_int(1, 1, 5);
+            table->add_empty_row();
+            table->move_last_over(0);
+        });
+        REQUIRE(filtered_calls == 2);
+        REQUIRE_FALSE(filtered_change.deletions.empty());
+        REQUIRE_FALSE(filtered_change.insertions.empty());
+        REQUIRE(filtered_change.modifications.empty());
+    }
+
+    SECTION("modifications to observed properties of linked objects are reported") {
+        auto token = add_filtered({"link.value"});
+        advance_and_notify(*r);
+
+        write([&] { linked_table->set_int(1, 2, 5); });
+        REQUIRE(filtered_calls == 1);
+
+        write([&] { linked_table->set_int(0, 2, 5); });
+        REQUIRE(filtered_calls == 2);
+        REQUIRE_INDICES(filtered_change.modifications, 2);
+    }
+
+    SECTION("changing a link is reported when the link property is observed") {
+        auto token = add_filtered({"link"});
+        advance_and_notify(*r);
+
+        write([&] { linked_table->set_int(0, 2, 5); });
+        REQUIRE(filtered_calls == 1);
+
+        write([&] { table->set_link(2, 3, 4); });
+        REQUIRE(filtered_calls == 2);
+        REQUIRE_INDICES(filtered_change.modifications, 3);
+    }
+
+    SECTION("callbacks with different key paths see different modifications") {
+        auto token = add_filtered({"other"});
+        CollectionChangeSet value_change;
+        auto value_token = results.add_notification_callback([&](CollectionChangeSet c, std::exception_ptr) {
+            value_change = c;
+        }, KeyPathArray{"value"});
+        advance_and_notify(*r);
+
+        write([&] {
+            table->set_int(0, 1, 5);
+            table->set_int(1, 3, 5);
+        });
+        REQUIRE_INDICES(value_change.modifications, 1);
+        REQUIRE_INDICES(filtered_change.modifications, 3);
+        REQUIRE_INDICES(unfiltered_change.modifications, 1, 3);
+    }
+
+    SECTION("invalid key paths throw") {
+        REQUIRE_THROWS(add_filtered({"invalid"}));
+        REQUIRE_THROWS(add_filtered({"value.value"}));
+        REQUIRE_THROWS(add_filtered({"link.invalid"}));
+    }
+}
+
+TEST_CASE("results: deferred notifier runs") {
+    InMemoryTestFile config;
+    config.cache = false;
+    config.automatic_change_notifications = false;
+    config.defer_notifier_runs_while_pending = true;
+
+    auto r = Realm::get_shared_realm(config);
+    r->update_schema({
+        {"object", {
+            {"value", PropertyType::Int}
+        }}
+    });
+
+    auto coordinator = _impl::RealmCoordinator::get_existing_coordinator(config.path);
+    auto table = r->read_group().get_table("class_object");
+
+    r->begin_transaction();
+    table->add_empty_row(10);
+    for (int i = 0; i < 10; ++i)
+        table->set_int(0, i, i * 2);
+    r->commit_transaction();
+
+    Results results(r, table->where().greater(0, 0).less(0, 10));
+
+    int notification_calls = 0;
+    CollectionChangeSet change;
+    auto token = results.add_notification_callback([&](CollectionChangeSet c, std::exception_ptr err) {
+        REQUIRE_FALSE(err);
+        change = c;
+        ++notification_calls;
+    });
+    advance_and_notify(*r);
+    REQUIRE(notification_calls == 1);
+
+    auto write = [&](auto&& f) {
+        r->begin_transaction();
+        f();
+        r->commit_transaction();
+    };
+
+    SECTION("runs are not deferred when each result is delivered") {
+        write([&] { table->set_int(0, 1, 3); });
+        advance_and_notify(*r);
+        REQUIRE(notification_calls == 2);
+        REQUIRE_INDICES(change.modifications, 0);
+
+        write([&] { table->set_int(0, 2, 5); });
+        advance_and_notify(*r);
+        REQUIRE(notification_calls == 3);
+        REQUIRE_INDICES(change.modifications, 1);
+    }
+
+    SECTION("changes from deferred runs are reported by the next run") {
+        write([&] { table->set_int(0, 1, 3); });
+        coordinator->on_change();
+
+        // The first result hasn't been delivered, so this run is deferred
+        write([&] {
+            table->set_int(0, 2, 5);
+            table->set_int(0, 0, 4);
+        });
+        coordinator->on_change();
+
+        // Catching up doesn't deliver the outdated result
+        r->notify();
+        REQUIRE(notification_calls == 1);
+
+        advance_and_notify(*r);
+        REQUIRE(notification_calls == 2);
+        REQUIRE_INDICES(change.insertions, 0);
+        REQUIRE_INDICES(change.modifications, 0, 1);
+    }
+
+    SECTION("catching up runs the deferred run without another commit") {
+        write([&] { table->set_int(0, 1, 3); });
+        coordinator->on_change();
+
+        write([&] {
+            table->set_int(0, 2, 5);
+            table->set_int(0, 0, 4);
+        });
+        coordinator->on_change();
+
+        // Delivering the outdated result wakes up the coordinator's notifier
+        // thread, even though there's no ExternalCommitHelper to do so
+        r->notify();
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (notification_calls == 1 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            r->notify();
+        }
+        REQUIRE(notification_calls == 2);
+        REQUIRE_INDICES(change.insertions, 0);
+        REQUIRE_INDICES(change.modifications, 0, 1);
+    }
+
+    SECTION("rows deleted while deferred are reported as deleted") {
+        write([&] { table->set_int(0, 1, 3); });
+        coordinator->on_change();
+
+        write([&] { table->move_last_over(2); });
+        coordinator->on_change();
+        r->notify();
+
+        advance_and_notify(*r);
+        REQUIRE(notification_calls == 2);
+        REQUIRE_INDICES(change.deletions, 1);
+        REQUIRE_INDICES(change.modifications, 0);
+    }
+}
+
+TEST_CASE("results: notification coalescing") {
+    using namespace std::chrono;
+
+    InMemoryTestFile config;
+    config.cache = false;
+    config.automatic_change_notifications = false;
+
+    auto open = [&] {
+        auto r = Realm::get_shared_realm(config);
+        r->update_schema({
+            {"object", {
+                {"value", PropertyType::Int}
+            }}
+        });
+        return r;
+    };
+
+    int notification_calls = 0;
+    CollectionChangeSet change;
+    auto callback = [&](CollectionChangeSet c, std::exception_ptr err) {
+        REQUIRE_FALSE(err);
+        change = c;
+        ++notification_calls;
+    };
+
+    // Deliver notifications on this thread until `calls` have been made,
+    // giving up after a few seconds
+    auto wait_for_calls = [&](Realm& realm, int calls) {
+        auto deadline = steady_clock::now() + seconds(5);
+        while (notification_calls < calls && steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(milliseconds(1));
+            realm.notify();
+        }
+        return notification_calls == calls;
+    };
+
+    auto add_row = [&](Realm& realm) {
+        realm.begin_transaction();
+        realm.read_group().get_table("class_object")->add_empty_row();
+        realm.commit_transaction();
+    };
+
+    SECTION("notification_min_interval") {
+        config.notification_min_interval = milliseconds(200);
+        auto r = open();
+        auto coordinator = _impl::RealmCoordinator::get_existing_coordinator(config.path);
+        Results results(r, r->read_group().get_table("class_object")->where());
+        auto token = results.add_notification_callback(callback);
+
+        // The first run isn't delayed
+        coordinator->on_change();
+        REQUIRE(wait_for_calls(*r, 1));
+        auto first_run = steady_clock::now();
+
+        SECTION("commits made before the interval passes are delivered by a single run") {
+            for (int i = 0; i < 3; ++i) {
+                add_row(*r);
+                auto start = steady_clock::now();
+                coordinator->on_change();
+                // Waiting for the interval happens on the scheduler thread
+                REQUIRE(steady_clock::now() - start < milliseconds(100));
+            }
+            REQUIRE(wait_for_calls(*r, 2));
+            REQUIRE(steady_clock::now() - first_run >= milliseconds(150));
+            REQUIRE_INDICES(change.insertions, 0, 1, 2);
+
+            std::this_thread::sleep_for(milliseconds(300));
+            r->notify();
+            REQUIRE(notification_calls == 2);
+        }
+
+        SECTION("commits made after the interval has passed are not delayed") {
+            std::this_thread::sleep_for(milliseconds(250));
+            add_row(*r);
+            coordinator->on_change();
+            auto start = steady_clock::now();
+            REQUIRE(wait_for_calls(*r, 2));
+            REQUIRE(steady_clock::now() - start < milliseconds(150));
+            REQUIRE_INDICES(change.insertions, 0);
+        }
+    }
+
+    SECTION("notification_max_latency") {
+        config.notification_min_interval = seconds(60);
+        config.notification_max_latency = milliseconds(50);
+        auto r = open();
+        auto coordinator = _impl::RealmCoordinator::get_existing_coordinator(config.path);
+        Results results(r, r->read_group().get_table("class_object")->where());
+        auto token = results.add_notification_callback(callback);
+        coordinator->on_change();
+        REQUIRE(wait_for_calls(*r, 1));
+
+        // Well within the minimum interval, so it's the latency which applies
+        add_row(*r);
+        auto start = steady_clock::now();
+        coordinator->on_change();
+        REQUIRE(wait_for_calls(*r, 2));
+        REQUIRE(steady_clock::now() - start >= milliseconds(50));
+        REQUIRE(steady_clock::now() - start < seconds(5));
+        REQUIRE_INDICES(change.insertions, 0);
+
+        // Commits made while a run is scheduled are included in it
+        add_row(*r);
+        coordinator->on_change();
+        add_row(*r);
+        coordinator->on_change();
+        REQUIRE(wait_for_calls(*r, 3));
+        REQUIRE_INDICES(change.insertions, 1, 2);
+    }
+
+    SECTION("notification_run_cost_factor") {
+        // Any run takes well over a microsecond, so this makes the interval
+        // after each run far longer than the maximum latency
+        config.notification_run_cost_factor = 1000000;
+        config.notification_max_latency = milliseconds(100);
+        auto r = open();
+        auto coordinator = _impl::RealmCoordinator::get_existing_coordinator(config.path);
+        Results results(r, r->read_group().get_table("class_object")->where());
+        auto token = results.add_notification_callback(callback);
+        coordinator->on_change();
+        REQUIRE(wait_for_calls(*r, 1));
+
+        auto start = steady_clock::now();
+        add_row(*r);
+        coordinator->on_change();
+        add_row(*r);
+        coordinator->on_change();
+        REQUIRE(wait_for_calls(*r, 2));
+        REQUIRE(steady_clock::now() - start >= milliseconds(100));
+        REQUIRE_INDICES(change.insertions, 0, 1);
+    }
+
+    SECTION("runs aren't scheduled for a coordinator which has never opened a Realm") {
+        std::weak_ptr<_impl::RealmCoordinator> weak_coordinator;
+        {
+            auto coordinator = std::make_shared<_impl::RealmCoordinator>();
+            weak_coordinator = coordinator;
+            coordinator->wake_notifier_thread();
+        }
+        REQUIRE(weak_coordinator.expired());
+    }
+
+    SECTION("the coordinator can be destroyed with a run scheduled") {
+        config.notification_min_interval = seconds(60);
+        config.notification_max_latency = seconds(60);
+        std::weak_ptr<_impl::RealmCoordinator> weak_coordinator;
+        {
+            auto r = open();
+            auto coordinator = _impl::RealmCoordinator::get_existing_coordinator(config.path);
+            weak_coordinator = coordinator;
+            Results results(r, r->read_group().get_table("class_object")->where());
+            auto token = results.add_notification_callback(callback);
+            coordinator->on_change();
+            REQUIRE(wait_for_calls(*r, 1));
+
+            add_row(*r);
+            coordinator->on_change();
+        }
+        REQUIRE(weak_coordinator.expired());
+        REQUIRE(notification_calls == 1);
+    }
+}
+
+TEST_CASE("results: live aggregates") {
+    InMemoryTestFile config;
+    config.cache = false;
+    config.automatic_change_notifications = false;
+
+    auto r = Realm::get_shared_realm(config);
+    r->update_schema({
+        {"object", {
+            {"value", PropertyType::Int},
+            {"optional", PropertyType::Double, "", "", false, false, true},
+            {"date", PropertyType::Date},
+            {"name", PropertyType::String},
+        }}
+    });
+
+    auto table = r->read_group().get_table("class_object");
+
+    r->begin_transaction();
+    table->add_empty_row(10);
+    for (int i = 0; i < 10; ++i) {
+        table->set_int(0, i, i);
+        if (i % 2)
+            table->set_double(1, i, i);
+        table->set_timestamp(2, i, Timestamp(i, 0));
+    }
+    r->commit_transaction();
+
+    Results results(r, table->where().less(0, 8));
+    auto write = [&](auto&& f) {
+        r->begin_transaction();
+        f();
+        r->commit_transaction();
+        advance_and_notify(*r);
+    };
+
+    SECTION("initial values match the non-live aggregates") {
+        auto agg = results.live_aggregate(0);
+        REQUIRE(agg.min()->get_int() == results.min(0)->get_int());
+        REQUIRE(agg.max()->get_int() == results.max(0)->get_int());
+        REQUIRE(agg.sum()->get_int() == results.sum(0)->get_int());
+        REQUIRE(agg.average()->get_double() == results.average(0)->get_double());
+        REQUIRE(agg.count() == 8);
+
+        advance_and_notify(*r);
+        REQUIRE(agg.sum()->get_int() == results.sum(0)->get_int());
+    }
+
+    SECTION("values follow insertions, deletions and modifications") {
+        auto agg = results.live_aggregate(0);
+        advance_and_notify(*r);
+
+        write([&] { table->set_int(0, table->add_empty_row(), -5); });
+        REQUIRE(agg.min()->get_int() == -5);
+        REQUIRE(agg.sum()->get_int() == 23);
+        REQUIRE(agg.count() == 9);
+
+        write([&] { table->move_last_over(7); });
+        REQUIRE(agg.max()->get_int() == 6);
+        REQUIRE(agg.sum()->get_int() == 16);
+        REQUIRE(agg.count() == 8);
+
+        write([&] { table->set_int(0, 7, 20); });
+        REQUIRE(agg.min()->get_int() == 0);
+        REQUIRE(agg.sum()->get_int() == 21);
+        REQUIRE(agg.count() == 7);
+
+        write([&] { table->set_int(0, 3, 7); });
+        REQUIRE(agg.max()->get_int() == 7);
+        REQUIRE(agg.sum()->get_int() == results.sum(0)->get_int());
+        REQUIRE(agg.average()->get_double() == results.average(0)->get_double());
+    }
+
+    SECTION("values match a recalculation after many changes") {
+        auto agg = results.live_aggregate(0);
+        advance_and_notify(*r);
+
+        for (int i = 0; i < 10; ++i) {
+            write([&] {
+                table->set_int(0, table->add_empty_row(), (i * 7) % 11);
+                table->move_last_over(i % table->size());
+                table->set_int(0, (i * 3) % table->size(), (i * 5) % 13);
+            });
+            REQUIRE(agg.min()->get_int() == results.min(0)->get_int());
+            REQUIRE(agg.max()->get_int() == results.max(0)->get_int());
+            REQUIRE(agg.sum()->get_int() == results.sum(0)->get_int());
+        }
+    }
+
+    SECTION("nulls are not counted") {
+        auto agg = results.live_aggregate(1);
+        REQUIRE(agg.count() == 4);
+        REQUIRE(agg.sum()->get_double() == 16.0);
+        REQUIRE(agg.average()->get_double() == 4.0);
+
+        advance_and_notify(*r);
+        write([&] { table->set_double(1, 0, 10.0); });
+        REQUIRE(agg.count() == 5);
+        REQUIRE(agg.max()->get_double() == 10.0);
+
+        write([&] { table->set_null(1, 7); });
+        REQUIRE(agg.count() == 4);
+        REQUIRE(agg.max()->get_double() == 10.0);
+        REQUIRE(agg.sum()->get_double() == 19.0);
+    }
+
+    SECTION("NaN and infinities stop affecting the sum once removed") {
+        auto agg = results.live_aggregate(1);
+        advance_and_notify(*r);
+
+        write([&] { table->set_double(1, 0, std::numeric_limits<double>::quiet_NaN()); });
+        REQUIRE(std::isnan(agg.sum()->get_double()));
+        REQUIRE(std::isnan(agg.average()->get_double()));
+        REQUIRE(agg.count() == 5);
+        REQUIRE(agg.max()->get_double() == 7.0);
+
+        write([&] { table->set_double(1, 2, std::numeric_limits<double>::infinity()); });
+        REQUIRE(std::isnan(agg.sum()->get_double()));
+
+        write([&] { table->set_null(1, 0); });
+        REQUIRE(agg.sum()->get_double() == std::numeric_limits<double>::infinity());
+        REQUIRE(agg.max()->get_double() == std::numeric_limits<double>::infinity());
+
+        write([&] { table->set_double(1, 4, -std::numeric_limits<double>::infinity()); });
+        REQUIRE(std::isnan(agg.sum()->get_double()));
+
+        write([&] {
+            table->set_null(1, 2);
+            table->set_null(1, 4);
+        });
+        REQUIRE(agg.sum()->get_double() == 16.0);
+        REQUIRE(agg.average()->get_double() == 4.0);
+        REQUIRE(agg.count() == 4);
+        REQUIRE(agg.max()->get_double() == 7.0);
+
+        // Removing the rows rather than nulling the values works the same way
+        write([&] { table->set_double(1, 0, std::numeric_limits<double>::quiet_NaN()); });
+        write([&] { table->set_int(0, 0, 100); });
+        REQUIRE(agg.sum()->get_double() == 16.0);
+    }
+
+    SECTION("float sums don't drift as values are added and removed") {
+        auto agg = results.live_aggregate(1);
+        advance_and_notify(*r);
+
+        for (int i = 0; i < 20; ++i) {
+            write([&] { table->set_double(1, 0, i % 2 ? 1e20 : 0.1); });
+            write([&] { table->set_null(1, 0); });
+        }
+        REQUIRE(agg.sum()->get_double() == 16.0);
+        REQUIRE(agg.sum()->get_double() == results.sum(1)->get_double());
+    }
+
+    SECTION("timestamp columns have only a min and max") {
+        auto agg = results.live_aggregate(2);
+        REQUIRE(agg.max()->get_timestamp() == results.max(2)->get_timestamp());
+        REQUIRE_FALSE(agg.sum());
+        REQUIRE_FALSE(agg.average());
+    }
+
+    SECTION("unsupported column types throw") {
+        REQUIRE_THROWS_AS(results.live_aggregate(3), Results::UnsupportedColumnTypeException);
+        REQUIRE_THROWS_AS(results.live_aggregate(4), Results::OutOfBoundsIndexException);
+    }
+}
+
+TEST_CASE("results: windowed results") {
+    InMemoryTestFile config;
+    config.cache = false;
+    config.automatic_change_notifications = false;
+
+    auto r = Realm::get_shared_realm(config);
+    r->update_schema({
+        {"object", {
+            {"value", PropertyType::Int}
+        }}
+    });
+
+    auto table = r->read_group().get_table("class_object");
+
+    r->begin_transaction();
+    table->add_empty_row(10);
+    for (int i = 0; i < 10; ++i)
+        table->set_int(0, i, i);
+    r->commit_transaction();
+
+    auto write = [&](auto&& f) {
+        r->begin_transaction();
+        f();
+        r->commit_transaction();
+        advance_and_notify(*r);
+    };
+
+    SECTION("unsorted") {
+        auto results = Results(r, table->where().greater(0, 0)).limit(1, 3);
+        REQUIRE(results.size() == 3);
+        REQUIRE(results.get(0).get_int(0) == 2);
+        REQUIRE(results.last()->get_int(0) == 4);
+        REQUIRE(results.index_of(4) == 2);
+        REQUIRE(results.index_of(1) == not_found);
+        REQUIRE(results.index_of(5) == not_found);
+        REQUIRE(results.sum(0)->get_int() == 9);
+        REQUIRE(results.max(0)->get_int() == 4);
+        REQUIRE_THROWS_AS(results.get(3), Results::OutOfBoundsIndexException);
+
+        r->begin_transaction();
+        results.clear();
+        r->commit_transaction();
+        REQUIRE(table->size() == 7);
+        REQUIRE(results.size() == 3);
+        REQUIRE(results.get(0).get_int(0) == 7);
+    }
+
+    SECTION("sorted") {
+        auto results = Results(r, table->where()).sort({*table, {{0}}, {false}}).limit(2, 3);
+        REQUIRE(results.size() == 3);
+        REQUIRE(results.first()->get_int(0) == 7);
+        REQUIRE(results.get(2).get_int(0) == 5);
+        REQUIRE(results.index_of(6) == 1);
+        REQUIRE(results.index_of(9) == not_found);
+    }
+
+    SECTION("windows compose") {
+        auto results = Results(r, table->where()).limit(2, 6).limit(1, 10);
+        REQUIRE(results.size() == 5);
+        REQUIRE(results.get(0).get_int(0) == 3);
+        REQUIRE(results.last()->get_int(0) == 7);
+    }
+
+    SECTION("a window past the end is empty") {
+        auto results = Results(r, table->where()).limit(20, 5);
+        REQUIRE(results.size() == 0);
+        REQUIRE_FALSE(results.first());
+    }
+
+    SECTION("notifications") {
+        auto results = Results(r, table->where()).sort({*table, {{0}}, {false}}).limit(2, 3);
+
+        int notification_calls = 0;
+        CollectionChangeSet change;
+        auto token = results.add_notification_callback([&](CollectionChangeSet c, std::exception_ptr err) {
+            REQUIRE_FALSE(err);
+            change = c;
+            ++notification_calls;
+        });
+        advance_and_notify(*r);
+        REQUIRE(notification_calls == 1);
+
+        SECTION("inserting before the window shifts rows in and out of it") {
+            write([&] { table->set_int(0, table->add_empty_row(), 10); });
+            REQUIRE(notification_calls == 2);
+            REQUIRE_INDICES(change.insertions, 0);
+            REQUIRE_INDICES(change.deletions, 2);
+            REQUIRE(results.get(0).get_int(0) == 8);
+        }
+
+        SECTION("changes outside the window are not reported") {
+            write([&] { table->set_int(0, 0, 1); });
+            REQUIRE(notification_calls == 1);
+        }
+
+        SECTION("deleting inside the window pulls in the next row") {
+            write([&] { table->move_last_over(6); });
+            REQUIRE(notification_calls == 2);
+            REQUIRE_INDICES(change.deletions, 1);
+            REQUIRE_INDICES(change.insertions, 2);
+            REQUIRE(results.get(2).get_int(0) == 4);
+        }
+    }
+}
+
+TEST_CASE("results: index_of") {
+    InMemoryTestFile config;
+    config.cache = false;
+    config.automatic_change_notifications = false;
+
+    auto r = Realm::get_shared_realm(config);
+    r->update_schema({
+        {"object", {
+            {"value", PropertyType::Int}
+        }}
+    });
+
+    auto table = r->read_group().get_table("class_object");
+
+    r->begin_transaction();
+    table->add_empty_row(10);
+    for (int i = 0; i < 10; ++i)
+        table->set_int(0, i, i);
+    r->commit_transaction();
+
+    Results results(r, table->where().greater(0, 1));
+    results = results.sort({*table, {{0}}, {false}});
+
+    auto require_index_of_matches_get = [&] {
+        for (size_t i = 0; i < results.size(); ++i)
+            REQUIRE(results.index_of(results.get(i).get_index()) == i);
+    };
+
+    SECTION("finds every row") {
+        require_index_of_matches_get();
+        REQUIRE(results.index_of(0) == not_found);
+        REQUIRE(results.index_of(9) == 0);
+        REQUIRE(results.index_of(2) == 7);
+    }
+
+    SECTION("reflects local writes") {
+        require_index_of_matches_get();
+
+        r->begin_transaction();
+        table->move_last_over(3);
+        table->set_int(0, table->add_empty_row(), 20);
+        REQUIRE(results.index_of(9) == 0);
+        REQUIRE(results.index_of(3) == 1);
+        require_index_of_matches_get();
+        r->cancel_transaction();
+    }
+
+    SECTION("reflects delivered notifications") {
+        auto token = results.add_notification_callback([&](CollectionChangeSet, std::exception_ptr) { });
+        advance_and_notify(*r);
+        require_index_of_matches_get();
+
+        r->begin_transaction();
+        table->set_int(0, 5, 100);
+        table->move_last_over(2);
+        r->commit_transaction();
+        advance_and_notify(*r);
+
+        REQUIRE(results.index_of(5) == 0);
+        REQUIRE(results.index_of(2) == 1);
+        require_index_of_matches_get();
+    }
+
+    SECTION("snapshots look up rows directly") {
+        auto snapshot = results.snapshot();
+        r->begin_transaction();
+        table->move_last_over(4);
+        REQUIRE(snapshot.index_of(4) == 0);
+        REQUIRE(snapshot.index_of(9) == not_found);
+        r->cancel_transaction();
+    }
+}
+
+TEST_CASE("results: notifications for queries on tables without links") {
+    InMemoryTestFile config;
+    config.cache = false;
+    config.automatic_change_notifications = false;
+
+    auto r = Realm::get_shared_realm(config);
+    r->update_schema({
+        {"object", {
+            {"value", PropertyType::Int}
+        }}
+    });
+
+    auto table = r->read_group().get_table("class_object");
+
+    r->begin_transaction();
+    table->add_empty_row(10);
+    for (int i = 0; i < 10; ++i)
+        table->set_int(0, i, i * 2);
+    r->commit_transaction();
+
+    Results results(r, table->where().greater(0, 0).less(0, 10));
+
+    int notification_calls = 0;
+    CollectionChangeSet change;
+    auto token = results.add_notification_callback([&](CollectionChangeSet c, std::exception_ptr err) {
+        REQUIRE_FALSE(err);
+        change = c;
+        ++notification_calls;
+    });
+    advance_and_notify(*r);
+
+    auto write = [&](auto&& f) {
+        r->begin_transaction();
+        f();
+        r->commit_transaction();
+        advance_and_notify(*r);
+    };
+
+    SECTION("modifying a matching row and leaving it matching marks that row as modified") {
+        write([&] {
+            table->set_int(0, 1, 3);
+        });
+        REQUIRE(notification_calls == 2);
+        REQUIRE_INDICES(change.modifications, 0);
+    }
+
+    SECTION("modifying a matching row to no longer match marks that row as deleted") {
+        write([&] {
+            table->set_int(0, 2, 0);
+        });
+        REQUIRE(notification_calls == 2);
+        REQUIRE_INDICES(change.deletions, 1);
+    }
+
+    SECTION("modifying a non-matching row to match marks that row as inserted, but not modified") {
+        write([&] {
+            table->set_int(0, 7, 3);
+        });
+        REQUIRE(notification_calls == 2);
+        REQUIRE_INDICES(change.insertions, 4);
+        REQUIRE(change.modifications.empty());
+    }
+
+    SECTION("inserting a matching row marks that row as inserted") {
+        write([&] {
+            table->set_int(0, table->add_empty_row(), 5);
+        });
+        REQUIRE(notification_calls == 2);
+        REQUIRE_INDICES(change.insertions, 4);
+    }
+
+    SECTION("moving a matching row via deletion marks that row as moved") {
+        write([&] {
+            table->where().greater_equal(0, 10).find_all().clear(RemoveMode::unordered);
+            table->move_last_over(0);
+        });
+        REQUIRE(notification_calls == 2);
+        REQUIRE_MOVES(change, {3, 0});
+    }
+
+    SECTION("modification indices are pre-insert/delete") {
+        write([&] {
+            table->set_int(0, 2, 0);
+            table->set_int(0, 3, 6);
+        });
+        REQUIRE(notification_calls == 2);
+        REQUIRE_INDICES(change.deletions, 1);
+        REQUIRE_INDICES(change.modifications, 2);
+    }
+}
+
+TEST_CASE("results: notifications with multiple notifier threads") {
+    InMemoryTestFile config;
+    config.cache = false;
+    config.automatic_change_notifications = false;
+    config.async_notifier_thread_count = 3;
+
+    auto r = Realm::get_shared_realm(config);
+    r->update_schema({
+        {"object", {
+            {"value", PropertyType::Int}
+        }}
+    });
+
+    auto table = r->read_group().get_table("class_object");
+
+    r->begin_transaction();
+    table->add_empty_row(10);
+    for (int i = 0; i < 10; ++i)
+        table->set_int(0, i, i);
+    r->commit_transaction();
+
+    std::vector<Results> results;
+    std::vector<CollectionChangeSet> changes(5);
+    std::vector<NotificationToken> tokens;
+    for (int i = 0; i < 5; ++i)
+        results.push_back(Results(r, table->where().greater_equal(0, i)));
+    for (int i = 0; i < 5; ++i) {
+        tokens.push_back(results[i].add_notification_callback([&changes, i](CollectionChangeSet c, std::exception_ptr err) {
+            REQUIRE_FALSE(err);
+            changes[i] = c;
+        }));
+    }
+    advance_and_notify(*r);
+
+    SECTION("each notifier reports the changes to its results") {
+        r->begin_transaction();
+        table->set_int(0, 4, 0);
+        r->commit_transaction();
+        advance_and_notify(*r);
+
+        REQUIRE_INDICES(changes[0].modifications, 4);
+        REQUIRE(results[0].size() == 10);
+        for (int i = 1; i < 5; ++i) {
+            CAPTURE(i);
+            REQUIRE_INDICES(changes[i].deletions, 4 - i);
+            REQUIRE(results[i].size() == size_t(9 - i));
+        }
+    }
+
+    SECTION("notifiers added later are delivered at the same version as existing ones") {
+        Results later(r, table->where().less(0, 5));
+        bool called = false;
+        auto token = later.add_notification_callback([&](CollectionChangeSet, std::exception_ptr) {
+            called = true;
+        });
+
+        r->begin_transaction();
+        table->set_int(0, 0, 20);
+        r->commit_transaction();
+        advance_and_notify(*r);
+
+        REQUIRE(called);
+        REQUIRE(later.size() == 4);
+        REQUIRE_INDICES(changes[1].insertions, 0);
+    }
+
+    SECTION("change info is reused rather than reallocated for each commit") {
+        auto coordinator = _impl::RealmCoordinator::get_existing_coordinator(config.path);
+        auto commit = [&](int i) {
+            r->begin_transaction();
+            table->set_int(0, i, i + 1);
+            r->commit_transaction();
+            advance_and_notify(*r);
+        };
+
+        commit(0);
+        size_t high_water_mark = coordinator->change_info_high_water_mark();
+        REQUIRE(high_water_mark > 0);
+
+        for (int i = 1; i < 10; ++i)
+            commit(i);
+
+        REQUIRE(coordinator->change_info_high_water_mark() == high_water_mark);
+        REQUIRE_INDICES(changes[0].modifications, 9);
+    }
+}
+
+TEST_CASE("results: notifier change info lifetime") {
+    // The change info which the notifiers read while running is released
+    // back to a pool afterwards, so a run which reads it after it was
+    // released sees it cleared and misses changes (or crashes under ASan).
+    // This covers both the per-worker and the shared change info paths.
+    InMemoryTestFile config;
+    config.cache = false;
+    config.automatic_change_notifications = false;
+
+    size_t thread_count = 0;
+    SECTION("one notifier thread") {
+        thread_count = 1;
+    }
+    SECTION("multiple notifier threads") {
+        thread_count = 3;
+    }
+    config.async_notifier_thread_count = thread_count;
+
+    auto r = Realm::get_shared_realm(config);
+    r->update_schema({
+        {"object", {
+            {"value", PropertyType::Int},
+            {"link", PropertyType::Object, "target", "", false, false, true}
+        }},
+        {"target", {
+            {"value", PropertyType::Int}
+        }}
+    });
+
+    auto table = r->read_group().get_table("class_object");
+    auto target = r->read_group().get_table("class_target");
+    r->begin_transaction();
+    table->add_empty_row(10);
+    target->add_empty_row(10);
+    for (int i = 0; i < 10; ++i) {
+        table->set_int(0, i, i);
+        table->set_link(1, i, i);
+    }
+    r->commit_transaction();
+
+    auto write = [&](auto&& f) {
+        r->begin_transaction();
+        f();
+        r->commit_transaction();
+        advance_and_notify(*r);
+    };
+
+    auto check_changes = [&](std::vector<Results>& results, std::vector<CollectionChangeSet>& changes) {
+        // A modification which is only visible via the link
+        for (int i = 0; i < 3; ++i) {
+            write([&] { target->set_int(0, i, i + 100); });
+            for (size_t j = 0; j < results.size(); ++j) {
+                CAPTURE(i);
+                CAPTURE(j);
+                REQUIRE_INDICES(changes[j].modifications, i);
+                REQUIRE(changes[j].insertions.empty());
+                REQUIRE(changes[j].deletions.empty());
+            }
+        }
+
+        write([&] { table->set_int(0, 9, -1); });
+        for (size_t j = 0; j < results.size(); ++j) {
+            CAPTURE(j);
+            REQUIRE_INDICES(changes[j].deletions, 9);
+        }
+
+        write([&] { table->set_int(0, 9, 9); });
+        for (size_t j = 0; j < results.size(); ++j) {
+            CAPTURE(j);
+            REQUIRE_INDICES(changes[j].insertions, 9);
+        }
+    };
+
+    auto add_results = [&](size_t begin, size_t end, std::vector<Results>& results,
+                           std::vector<CollectionChangeSet>& changes,
+                           std::vector<NotificationToken>& tokens) {
+        results.reserve(end);
+        for (size_t i = begin; i < end; ++i)
+            results.push_back(Results(r, table->where().greater_equal(0, 0)));
+        for (size_t i = begin; i < end; ++i) {
+            tokens.push_back(results[i].add_notification_callback([&changes, i](CollectionChangeSet c, std::exception_ptr err) {
+                REQUIRE_FALSE(err);
+                changes[i] = c;
+            }));
+        }
+    };
+
+    auto make_results = [&](size_t count, std::vector<Results>& results,
+                            std::vector<CollectionChangeSet>& changes,
+                            std::vector<NotificationToken>& tokens) {
+        changes.resize(count);
+        add_results(0, count, results, changes, tokens);
+        advance_and_notify(*r);
+    };
+
+    SECTION("a single notifier") {
+        std::vector<Results> results;
+        std::vector<CollectionChangeSet> changes;
+        std::vector<NotificationToken> tokens;
+        make_results(1, results, changes, tokens);
+        check_changes(results, changes);
+    }
+
+    SECTION("several notifiers") {
+        std::vector<Results> results;
+        std::vector<CollectionChangeSet> changes;
+        std::vector<NotificationToken> tokens;
+        make_results(6, results, changes, tokens);
+        check_changes(results, changes);
+    }
+
+    SECTION("notifiers added at different versions") {
+        // The notifiers added after the commit start at a newer version than
+        // the existing ones, so the workers can't share change info
+        std::vector<Results> results;
+        std::vector<CollectionChangeSet> changes(6);
+        std::vector<NotificationToken> tokens;
+        add_results(0, 3, results, changes, tokens);
+        advance_and_notify(*r);
+
+        r->begin_transaction();
+        table->set_int(0, 0, 0);
+        r->commit_transaction();
+        add_results(3, 6, results, changes, tokens);
+        advance_and_notify(*r);
+
+        check_changes(results, changes);
+    }
+}
+
+TEST_CASE("results: notifications for Realms on multiple threads") {
+    using namespace std::chrono;
+
+    InMemoryTestFile config;
+    config.cache = false;
+    config.automatic_change_notifications = false;
+
+    auto r = Realm::get_shared_realm(config);
+    r->update_schema({
+        {"object", {
+            {"value", PropertyType::Int}
+        }}
+    });
+    auto coordinator = _impl::RealmCoordinator::get_existing_coordinator(config.path);
+    auto table = r->read_group().get_table("class_object");
+
+    // Each thread has its own Realm, which shares the coordinator with the
+    // others, and observes the rows with its own value. Catch's assertions
+    // can't be used on other threads, so they only record what happened.
+    struct Observer {
+        std::atomic<size_t> calls{0};
+        std::atomic<size_t> size{0};
+        std::atomic<size_t> added_calls{0};
+        std::atomic<size_t> added_size{0};
+        std::atomic<bool> wrong_thread{false};
+        std::atomic<bool> error{false};
+    };
+    const int thread_count = 3;
+    Observer observers[thread_count];
+    std::atomic<int> ready{0};
+    std::atomic<int> phase{0};
+    std::atomic<bool> done{false};
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&, t] {
+            auto& observer = observers[t];
+            auto thread_id = std::this_thread::get_id();
+            auto record = [&observer, thread_id](std::atomic<size_t>& calls, std::atomic<size_t>& size, Results& results) {
+                return [&observer, &calls, &size, &results, thread_id](CollectionChangeSet, std::exception_ptr err) {
+                    if (err)
+                        observer.error = true;
+                    if (std::this_thread::get_id() != thread_id)
+                        observer.wrong_thread = true;
+                    size = results.size();
+                    ++calls;
+                };
+            };
+
+            auto realm = Realm::get_shared_realm(config);
+            auto thread_table = realm->read_group().get_table("class_object");
+            Results results(realm, thread_table->where().equal(0, t));
+            auto token = results.add_notification_callback(record(observer.calls, observer.size, results));
+            ++ready;
+
+            // Added partway through, after the thread's Realm already has notifiers
+            Results added(realm, thread_table->where().equal(0, t));
+            NotificationToken added_token;
+            bool did_add = false;
+
+            while (!done) {
+                if (phase == 1 && !did_add) {
+                    did_add = true;
+                    added_token = added.add_notification_callback(record(observer.added_calls, observer.added_size, added));
+                    // The first thread's original notifier is removed
+                    if (t == 0)
+                        token = {};
+                    ++ready;
+                }
+                realm->notify();
+                std::this_thread::sleep_for(milliseconds(1));
+            }
+        });
+    }
+
+    auto wait_until = [&](auto&& fn) {
+        auto deadline = steady_clock::now() + seconds(5);
+        while (!fn() && steady_clock::now() < deadline)
+            std::this_thread::sleep_for(milliseconds(1));
+        return fn();
+    };
+    auto all = [&](auto&& fn) {
+        return [&, fn] {
+            for (int t = 0; t < thread_count; ++t) {
+                if (!fn(t, observers[t]))
+                    return false;
+            }
+            return true;
+        };
+    };
+    auto add_rows = [&] {
+        r->begin_transaction();
+        for (int t = 0; t < thread_count; ++t)
+            table->set_int(0, table->add_empty_row(), t);
+        r->commit_transaction();
+        coordinator->on_change();
+    };
+
+    bool initial = wait_until([&] { return ready == thread_count; });
+    coordinator->on_change();
+    initial = initial && wait_until(all([](int, Observer& o) { return o.calls == 1; }));
+
+    add_rows();
+    bool first_commit = wait_until(all([](int, Observer& o) { return o.calls == 2 && o.size == 1; }));
+
+    phase = 1;
+    bool added = wait_until([&] { return ready == thread_count * 2; });
+    coordinator->on_change();
+    added = added && wait_until(all([](int, Observer& o) { return o.added_calls == 1 && o.added_size == 1; }));
+
+    add_rows();
+    bool second_commit = wait_until(all([](int t, Observer& o) {
+        return o.added_calls == 2 && o.added_size == 2 && (t == 0 || (o.calls == 3 && o.size == 2));
+    }));
+    // Give a wrongly delivered notification a chance to show up
+    std::this_thread::sleep_for(milliseconds(50));
+
+    done = true;
+    for (auto& thread : threads)
+        thread.join();
+
+    REQUIRE(initial);
+    REQUIRE(first_commit);
+    REQUIRE(added);
+    REQUIRE(second_commit);
+    for (int t = 0; t < thread_count; ++t) {
+        CAPTURE(t);
+        REQUIRE_FALSE(observers[t].wrong_thread);
+        REQUIRE_FALSE(observers[t].error);
+        REQUIRE(observers[t].added_calls == 2);
+        REQUIRE(observers[t].calls == (t == 0 ? 2 : 3));
+    }
+}
+
 #if REALM_PLATFORM_APPLE
 TEST_CASE("results: async error handling") {
     InMemoryTestFile config;
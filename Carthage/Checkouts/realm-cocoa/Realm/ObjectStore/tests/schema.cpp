@@ -22,6 +22,8 @@
 #include "property.hpp"
 #include "schema.hpp"
 
+#include "util/format.hpp"
+
 #include <realm/group.hpp>
 #include <realm/table.hpp>
 
@@ -172,6 +174,61 @@ TEST_CASE("ObjectSchema") {
         pk->set_string(1, 0, "nonexistent property");
         REQUIRE(ObjectSchema(g, "table").primary_key_property() == nullptr);
     }
+
+    SECTION("property lookup") {
+        std::vector<Property> properties;
+        for (int i = 0; i < 50; ++i)
+            properties.push_back({util::format("prop %1", i), PropertyType::Int});
+        ObjectSchema os("object", {});
+        os.persisted_properties = properties;
+        os.computed_properties.push_back({"computed", PropertyType::LinkingObjects, "object", "link"});
+
+        SECTION("finds all properties without an up-to-date index") {
+            for (int i = 0; i < 50; ++i)
+                REQUIRE(os.property_for_name(util::format("prop %1", i)) == &os.persisted_properties[i]);
+            REQUIRE(os.property_for_name("computed") == &os.computed_properties[0]);
+            REQUIRE(os.property_for_name("missing") == nullptr);
+        }
+
+        SECTION("finds all properties after updating the index") {
+            os.update_property_index();
+            for (int i = 0; i < 50; ++i)
+                REQUIRE(os.property_for_name(util::format("prop %1", i)) == &os.persisted_properties[i]);
+            REQUIRE(os.property_for_name("computed") == &os.computed_properties[0]);
+            REQUIRE(os.property_for_name("missing") == nullptr);
+        }
+
+        SECTION("handles properties which were reordered or removed after building the index") {
+            os.update_property_index();
+            std::swap(os.persisted_properties[0], os.persisted_properties[1]);
+            os.persisted_properties.erase(os.persisted_properties.begin() + 10);
+            REQUIRE(os.property_for_name("prop 0") == &os.persisted_properties[1]);
+            REQUIRE(os.property_for_name("prop 1") == &os.persisted_properties[0]);
+            REQUIRE(os.property_for_name("prop 10") == nullptr);
+            REQUIRE(os.property_for_name("prop 11") == &os.persisted_properties[10]);
+            REQUIRE(os.property_for_name("computed") == &os.computed_properties[0]);
+        }
+
+        SECTION("handles are valid in copies of the ObjectSchema") {
+            os.update_property_index();
+            auto handle = os.property_handle_for_name("prop 25");
+            REQUIRE(handle);
+            REQUIRE(&os.property_for_handle(handle) == &os.persisted_properties[25]);
+
+            ObjectSchema copy = os;
+            REQUIRE(&copy.property_for_handle(handle) == &copy.persisted_properties[25]);
+
+            auto computed = os.property_handle_for_name("computed");
+            REQUIRE(&copy.property_for_handle(computed) == &copy.computed_properties[0]);
+
+            REQUIRE_FALSE(os.property_handle_for_name("missing"));
+        }
+
+        SECTION("Schema updates the indexes of its ObjectSchemas") {
+            Schema schema = {os};
+            REQUIRE(schema.find("object")->property_for_name("prop 49")->name == "prop 49");
+        }
+    }
 }
 
 TEST_CASE("Schema") {
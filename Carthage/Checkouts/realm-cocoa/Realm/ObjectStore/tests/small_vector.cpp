@@ -0,0 +1,323 @@
+////////////////////////////////////////////////////////////////////////////
+//
+// Copyright 2016 Realm Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+////////////////////////////////////////////////////////////////////////////
+
+#include "catch.hpp"
+
+#include "util/small_vector.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace realm;
+
+namespace {
+// A non-trivial element type which tracks how many instances are alive, so
+// that tests can check that every constructed element is destroyed exactly once
+struct Counted {
+    static int live;
+    std::string value;
+
+    Counted(std::string v = "") : value(std::move(v)) { ++live; }
+    Counted(Counted const& other) : value(other.value) { ++live; }
+    Counted(Counted&& other) noexcept : value(std::move(other.value)) { ++live; }
+    Counted& operator=(Counted const&) = default;
+    Counted& operator=(Counted&&) = default;
+    ~Counted() { --live; }
+
+    bool operator==(std::string const& other) const { return value == other; }
+};
+int Counted::live = 0;
+
+// An element type whose copy constructor throws after a given number of
+// copies and which has no non-throwing move constructor
+struct ThrowOnCopy {
+    static int live;
+    static int copies_until_throw;
+    int value;
+
+    ThrowOnCopy(int v) : value(v) { ++live; }
+    ThrowOnCopy(ThrowOnCopy const& other) : value(other.value)
+    {
+        if (copies_until_throw-- == 0)
+            throw std::runtime_error("copy failed");
+        ++live;
+    }
+    ThrowOnCopy& operator=(ThrowOnCopy const&) = default;
+    ~ThrowOnCopy() { --live; }
+};
+int ThrowOnCopy::live = 0;
+int ThrowOnCopy::copies_until_throw = -1;
+
+template<typename Vector>
+std::vector<std::string> values(Vector const& v)
+{
+    std::vector<std::string> ret;
+    for (auto& c : v)
+        ret.push_back(c.value);
+    return ret;
+}
+
+using Strings = std::vector<std::string>;
+} // anonymous namespace
+
+TEST_CASE("small_vector: inline and heap storage") {
+    Counted::live = 0;
+
+    SECTION("starts inline with the inline capacity") {
+        util::SmallVector<Counted, 2> v;
+        REQUIRE(v.is_inline());
+        REQUIRE(v.capacity() == 2);
+        REQUIRE(v.empty());
+    }
+
+    SECTION("stays inline until the inline capacity is exceeded") {
+        util::SmallVector<Counted, 2> v;
+        v.emplace_back("a");
+        v.emplace_back("b");
+        REQUIRE(v.is_inline());
+        v.emplace_back("c");
+        REQUIRE_FALSE(v.is_inline());
+        REQUIRE(v.capacity() >= 3);
+        REQUIRE(values(v) == (Strings{"a", "b", "c"}));
+        REQUIRE(Counted::live == 3);
+    }
+
+    SECTION("emplace_back() of an existing element when full") {
+        util::SmallVector<Counted, 2> v;
+        v.emplace_back("a");
+        v.emplace_back("b");
+        v.push_back(v[0]);
+        REQUIRE(values(v) == (Strings{"a", "b", "a"}));
+        REQUIRE(Counted::live == 3);
+    }
+
+    SECTION("reserve() moves the elements to the heap") {
+        util::SmallVector<Counted, 2> v = {Counted("a")};
+        v.reserve(10);
+        REQUIRE_FALSE(v.is_inline());
+        REQUIRE(v.capacity() == 10);
+        REQUIRE(values(v) == (Strings{"a"}));
+        REQUIRE(Counted::live == 1);
+    }
+
+    SECTION("reserve() does nothing when there is already enough capacity") {
+        util::SmallVector<Counted, 2> v;
+        v.reserve(2);
+        REQUIRE(v.is_inline());
+    }
+
+    SECTION("clear() keeps heap storage") {
+        util::SmallVector<Counted, 2> v = {Counted("a"), Counted("b"), Counted("c")};
+        v.clear();
+        REQUIRE(v.empty());
+        REQUIRE_FALSE(v.is_inline());
+        REQUIRE(Counted::live == 0);
+    }
+
+    REQUIRE(Counted::live == 0);
+}
+
+TEST_CASE("small_vector: copy and move") {
+    Counted::live = 0;
+
+    SECTION("copying inline storage") {
+        util::SmallVector<Counted, 2> v = {Counted("a"), Counted("b")};
+        auto copy = v;
+        REQUIRE(copy.is_inline());
+        REQUIRE(values(copy) == (Strings{"a", "b"}));
+        REQUIRE(values(v) == (Strings{"a", "b"}));
+        REQUIRE(Counted::live == 4);
+    }
+
+    SECTION("copying heap storage") {
+        util::SmallVector<Counted, 2> v = {Counted("a"), Counted("b"), Counted("c")};
+        auto copy = v;
+        REQUIRE_FALSE(copy.is_inline());
+        REQUIRE(copy.data() != v.data());
+        REQUIRE(values(copy) == (Strings{"a", "b", "c"}));
+        REQUIRE(values(v) == (Strings{"a", "b", "c"}));
+        REQUIRE(Counted::live == 6);
+    }
+
+    SECTION("copying a small vector into one with heap storage") {
+        util::SmallVector<Counted, 2> v = {Counted("a")};
+        util::SmallVector<Counted, 2> target = {Counted("x"), Counted("y"), Counted("z")};
+        target = v;
+        REQUIRE(values(target) == (Strings{"a"}));
+        REQUIRE(Counted::live == 2);
+    }
+
+    SECTION("moving inline storage moves each element") {
+        util::SmallVector<Counted, 2> v = {Counted("a"), Counted("b")};
+        auto moved = std::move(v);
+        REQUIRE(moved.is_inline());
+        REQUIRE(values(moved) == (Strings{"a", "b"}));
+        REQUIRE(v.empty());
+        REQUIRE(v.is_inline());
+        REQUIRE(Counted::live == 2);
+    }
+
+    SECTION("moving heap storage takes the buffer") {
+        util::SmallVector<Counted, 2> v = {Counted("a"), Counted("b"), Counted("c")};
+        auto data = v.data();
+        auto moved = std::move(v);
+        REQUIRE(moved.data() == data);
+        REQUIRE(values(moved) == (Strings{"a", "b", "c"}));
+        REQUIRE(v.empty());
+        REQUIRE(v.is_inline());
+        REQUIRE(v.capacity() == 2);
+        REQUIRE(Counted::live == 3);
+
+        // The moved-from vector is still usable
+        v.emplace_back("d");
+        REQUIRE(values(v) == (Strings{"d"}));
+    }
+
+    SECTION("move-assigning over heap storage frees the old elements") {
+        util::SmallVector<Counted, 2> v = {Counted("a")};
+        util::SmallVector<Counted, 2> target = {Counted("x"), Counted("y"), Counted("z")};
+        target = std::move(v);
+        REQUIRE(target.is_inline());
+        REQUIRE(values(target) == (Strings{"a"}));
+        REQUIRE(Counted::live == 1);
+    }
+
+    SECTION("self-assignment") {
+        util::SmallVector<Counted, 2> inline_v = {Counted("a")};
+        util::SmallVector<Counted, 2> heap_v = {Counted("a"), Counted("b"), Counted("c")};
+        auto& inline_ref = inline_v;
+        auto& heap_ref = heap_v;
+
+        inline_v = inline_ref;
+        heap_v = heap_ref;
+        REQUIRE(values(inline_v) == (Strings{"a"}));
+        REQUIRE(values(heap_v) == (Strings{"a", "b", "c"}));
+
+        inline_v = std::move(inline_ref);
+        heap_v = std::move(heap_ref);
+        REQUIRE(values(inline_v) == (Strings{"a"}));
+        REQUIRE(values(heap_v) == (Strings{"a", "b", "c"}));
+        REQUIRE(Counted::live == 4);
+    }
+
+    REQUIRE(Counted::live == 0);
+}
+
+TEST_CASE("small_vector: insert(), erase() and resize()") {
+    Counted::live = 0;
+    util::SmallVector<Counted, 2> v = {Counted("a"), Counted("b")};
+
+    SECTION("insert() at the beginning moves to the heap when needed") {
+        auto it = v.insert(v.begin(), Counted("x"));
+        REQUIRE(it == v.begin());
+        REQUIRE(values(v) == (Strings{"x", "a", "b"}));
+        REQUIRE(Counted::live == 3);
+    }
+
+    SECTION("insert() in the middle") {
+        auto it = v.insert(v.begin() + 1, Counted("x"));
+        REQUIRE(it->value == "x");
+        REQUIRE(values(v) == (Strings{"a", "x", "b"}));
+    }
+
+    SECTION("insert() of an existing element") {
+        v.insert(v.begin(), v[1]);
+        REQUIRE(values(v) == (Strings{"b", "a", "b"}));
+        REQUIRE(Counted::live == 3);
+    }
+
+    SECTION("erase() a single element") {
+        v.emplace_back("c");
+        auto it = v.erase(v.begin());
+        REQUIRE(it == v.begin());
+        REQUIRE(values(v) == (Strings{"b", "c"}));
+        REQUIRE(Counted::live == 2);
+    }
+
+    SECTION("erase() a range") {
+        v.emplace_back("c");
+        v.emplace_back("d");
+        auto it = v.erase(v.begin() + 1, v.begin() + 3);
+        REQUIRE(it->value == "d");
+        REQUIRE(values(v) == (Strings{"a", "d"}));
+        REQUIRE(Counted::live == 2);
+    }
+
+    SECTION("erase() an empty range") {
+        v.erase(v.begin() + 1, v.begin() + 1);
+        REQUIRE(values(v) == (Strings{"a", "b"}));
+    }
+
+    SECTION("resize() larger default-constructs new elements") {
+        v.resize(4);
+        REQUIRE(values(v) == (Strings{"a", "b", "", ""}));
+        REQUIRE(Counted::live == 4);
+    }
+
+    SECTION("resize() smaller destroys the removed elements") {
+        v.resize(1);
+        REQUIRE(values(v) == (Strings{"a"}));
+        REQUIRE(Counted::live == 1);
+    }
+
+    SECTION("pop_back() destroys the last element") {
+        v.pop_back();
+        REQUIRE(values(v) == (Strings{"a"}));
+        REQUIRE(Counted::live == 1);
+    }
+
+    v.clear();
+    REQUIRE(Counted::live == 0);
+}
+
+TEST_CASE("small_vector: exception safety") {
+    ThrowOnCopy::live = 0;
+    ThrowOnCopy::copies_until_throw = -1;
+
+    util::SmallVector<ThrowOnCopy, 2> v;
+    v.emplace_back(1);
+    v.emplace_back(2);
+
+    SECTION("reserve() destroys the copied elements and leaves the vector unchanged if a copy throws") {
+        ThrowOnCopy::copies_until_throw = 1;
+        REQUIRE_THROWS(v.reserve(10));
+        REQUIRE(ThrowOnCopy::live == 2);
+        REQUIRE(v.is_inline());
+        REQUIRE(v.size() == 2);
+        REQUIRE(v[0].value == 1);
+        REQUIRE(v[1].value == 2);
+    }
+
+    SECTION("growing in emplace_back() leaves the vector unchanged if a copy throws") {
+        ThrowOnCopy::copies_until_throw = 1;
+        REQUIRE_THROWS(v.emplace_back(3));
+        REQUIRE(ThrowOnCopy::live == 2);
+        REQUIRE(v.size() == 2);
+        REQUIRE(v[1].value == 2);
+    }
+
+    SECTION("copy construction destroys the copied elements if a copy throws") {
+        ThrowOnCopy::copies_until_throw = 1;
+        REQUIRE_THROWS([&] { auto copy = v; }());
+        REQUIRE(ThrowOnCopy::live == 2);
+    }
+
+    ThrowOnCopy::copies_until_throw = -1;
+    v.clear();
+    REQUIRE(ThrowOnCopy::live == 0);
+}
@@ -21,6 +21,7 @@
 #include "util/index_helpers.hpp"
 #include "util/test_file.hpp"
 
+#include "binding_context.hpp"
 #include "impl/collection_notifier.hpp"
 #include "impl/transact_log_handler.hpp"
 #include "property.hpp"
@@ -1000,6 +1001,157 @@ TEST_CASE("Transaction log parsing: changeset calcuation") {
     }
 }
 
+namespace {
+class KVOContext : public BindingContext {
+public:
+    KVOContext(std::vector<ObserverState> observed) : m_observed(std::move(observed)) { }
+
+    std::vector<ObserverState> will_change_observers, did_change_observers;
+    std::vector<void*> will_change_invalidated, did_change_invalidated;
+
+    std::vector<ObserverState> get_observed_rows() override { return m_observed; }
+
+    void will_change(std::vector<ObserverState> const& observers, std::vector<void*> const& invalidated) override
+    {
+        will_change_observers = observers;
+        will_change_invalidated = invalidated;
+    }
+
+    void did_change(std::vector<ObserverState> const& observers, std::vector<void*> const& invalidated) override
+    {
+        did_change_observers = observers;
+        did_change_invalidated = invalidated;
+    }
+
+private:
+    std::vector<ObserverState> m_observed;
+};
+} // anonymous namespace
+
+TEST_CASE("Transaction log parsing: KVO observers") {
+    using ObserverState = BindingContext::ObserverState;
+    using Kind = BindingContext::ColumnInfo::Kind;
+
+    InMemoryTestFile config;
+    config.automatic_change_notifications = false;
+    auto r = Realm::get_shared_realm(config);
+    r->update_schema({
+        {"table", {
+            {"value", PropertyType::Int}
+        }},
+        {"other table", {
+            {"value", PropertyType::Int}
+        }},
+    });
+    auto& table = *r->read_group().get_table("class_table");
+    auto& other_table = *r->read_group().get_table("class_other table");
+    size_t table_ndx = table.get_index_in_group();
+    size_t other_ndx = other_table.get_index_in_group();
+
+    r->begin_transaction();
+    table.add_empty_row(10);
+    other_table.add_empty_row(10);
+    r->commit_transaction();
+
+    auto observe = [&](std::vector<ObserverState> observed, auto&& f) {
+        auto history = make_client_history(config.path);
+        SharedGroup sg(*history, SharedGroup::durability_MemOnly);
+        sg.begin_read();
+
+        r->begin_transaction();
+        f();
+        r->commit_transaction();
+
+        KVOContext context(std::move(observed));
+        _impl::transaction::advance(sg, &context, SchemaMode::Automatic);
+        return context;
+    };
+
+    auto modified = [](ObserverState const& o) {
+        return !o.changes.empty() && o.changes[0].kind == Kind::Set;
+    };
+
+    int a, b, c, d;
+
+    SECTION("inserting rows into one table does not shift observed rows of other tables") {
+        auto context = observe({{table_ndx, 2, &a}, {other_ndx, 2, &b}}, [&] {
+            table.insert_empty_row(0);
+        });
+        auto& observers = context.did_change_observers;
+        REQUIRE(observers.size() == 2);
+        REQUIRE(observers[0].row_ndx == 3);
+        REQUIRE(observers[1].table_ndx == other_ndx);
+        REQUIRE(observers[1].row_ndx == 2);
+    }
+
+    SECTION("modifications are reported for unsorted observers") {
+        auto context = observe({{table_ndx, 5, &a}, {other_ndx, 0, &b}, {table_ndx, 1, &c}, {table_ndx, 3, &d}}, [&] {
+            table.set_int(0, 3, 1);
+            other_table.set_int(0, 0, 1);
+        });
+        auto& observers = context.did_change_observers;
+        REQUIRE(observers.size() == 4);
+        REQUIRE_FALSE(modified(observers[0]));
+        REQUIRE(modified(observers[1]));
+        REQUIRE_FALSE(modified(observers[2]));
+        REQUIRE(modified(observers[3]));
+    }
+
+    SECTION("modifications are reported for rows moved by move_last_over()") {
+        // Moving row 9 to row 1 leaves the observed rows out of order
+        auto context = observe({{table_ndx, 2, &a}, {table_ndx, 9, &b}}, [&] {
+            table.move_last_over(1);
+            table.set_int(0, 1, 1);
+        });
+        auto& observers = context.did_change_observers;
+        REQUIRE(observers.size() == 2);
+        REQUIRE(observers[0].row_ndx == 2);
+        REQUIRE_FALSE(modified(observers[0]));
+        REQUIRE(observers[1].row_ndx == 1);
+        REQUIRE(modified(observers[1]));
+    }
+
+    SECTION("every observer of a row is updated") {
+        auto context = observe({{table_ndx, 4, &a}, {table_ndx, 4, &b}}, [&] {
+            table.insert_empty_row(0);
+            table.set_int(0, 5, 1);
+        });
+        auto& observers = context.did_change_observers;
+        REQUIRE(observers.size() == 2);
+        for (auto& observer : observers) {
+            REQUIRE(observer.row_ndx == 5);
+            REQUIRE(modified(observer));
+        }
+    }
+
+    SECTION("observers are passed in their original order after invalidating some") {
+        auto context = observe({{table_ndx, 5, &a}, {table_ndx, 1, &b}, {other_ndx, 3, &c}, {table_ndx, 7, &d}}, [&] {
+            table.remove(1);
+        });
+        REQUIRE(context.will_change_invalidated == std::vector<void*>{&b});
+        REQUIRE(context.did_change_invalidated == std::vector<void*>{&b});
+
+        for (auto* observers : {&context.will_change_observers, &context.did_change_observers}) {
+            REQUIRE(observers->size() == 3);
+            REQUIRE((*observers)[0].info == &a);
+            REQUIRE((*observers)[0].row_ndx == 4);
+            REQUIRE((*observers)[1].info == &c);
+            REQUIRE((*observers)[1].row_ndx == 3);
+            REQUIRE((*observers)[2].info == &d);
+            REQUIRE((*observers)[2].row_ndx == 6);
+        }
+    }
+
+    SECTION("clearing a table invalidates only that table's observers") {
+        auto context = observe({{other_ndx, 1, &a}, {table_ndx, 1, &b}, {table_ndx, 2, &c}}, [&] {
+            table.clear();
+        });
+        REQUIRE(context.did_change_invalidated == (std::vector<void*>{&b, &c}));
+        REQUIRE(context.did_change_observers.size() == 1);
+        REQUIRE(context.did_change_observers[0].info == &a);
+    }
+}
+
 TEST_CASE("DeepChangeChecker") {
     InMemoryTestFile config;
     config.automatic_change_notifications = false;
@@ -1187,3 +1339,146 @@ TEST_CASE("DeepChangeChecker") {
         REQUIRE(_impl::DeepChangeChecker(info, *table, tables)(0));
     }
 }
+
+TEST_CASE("DirtyRowClosure") {
+    InMemoryTestFile config;
+    config.automatic_change_notifications = false;
+    auto r = Realm::get_shared_realm(config);
+    r->update_schema({
+        {"table", {
+            {"int", PropertyType::Int},
+            {"link", PropertyType::Object, "table", "", false, false, true},
+            {"array", PropertyType::Array, "table"},
+            {"other", PropertyType::Object, "other table", "", false, false, true}
+        }},
+        {"other table", {
+            {"int", PropertyType::Int}
+        }},
+    });
+    auto table = r->read_group().get_table("class_table");
+    auto other_table = r->read_group().get_table("class_other table");
+
+    r->begin_transaction();
+    table->add_empty_row(10);
+    other_table->add_empty_row(10);
+    for (int i = 0; i < 10; ++i)
+        table->set_int(0, i, i);
+    r->commit_transaction();
+
+    auto track_changes = [&](auto&& f) {
+        auto history = make_client_history(config.path);
+        SharedGroup sg(*history, SharedGroup::durability_MemOnly);
+        Group const& g = sg.begin_read();
+
+        r->begin_transaction();
+        f();
+        r->commit_transaction();
+
+        _impl::TransactionChangeInfo info;
+        info.table_modifications_needed.resize(g.size(), true);
+        info.table_moves_needed.resize(g.size(), true);
+        _impl::transaction::advance(sg, info);
+        return info;
+    };
+
+    std::vector<_impl::DeepChangeChecker::RelatedTable> tables;
+    _impl::DeepChangeChecker::find_related_tables(tables, *table);
+
+    SECTION("direct changes are tracked") {
+        auto info = track_changes([&] {
+            table->set_int(0, 9, 10);
+        });
+
+        auto checker = info.dirty_rows->get_checker(info, *table, tables);
+        REQUIRE_FALSE(checker(8));
+        REQUIRE(checker(9));
+    }
+
+    SECTION("changes over links are tracked") {
+        r->begin_transaction();
+        for (int i = 0; i < 9; ++i)
+            table->set_link(1, i, i + 1);
+        r->commit_transaction();
+
+        auto info = track_changes([&] {
+            table->set_int(0, 9, 10);
+        });
+
+        auto checker = info.dirty_rows->get_checker(info, *table, tables);
+        for (int i = 0; i < 10; ++i)
+            REQUIRE(checker(i));
+    }
+
+    SECTION("changes over linklists are tracked") {
+        r->begin_transaction();
+        for (int i = 0; i < 9; ++i)
+            table->get_linklist(2, i)->add(i + 1);
+        r->commit_transaction();
+
+        auto info = track_changes([&] {
+            table->set_int(0, 9, 10);
+        });
+
+        REQUIRE(info.dirty_rows->get_checker(info, *table, tables)(0));
+    }
+
+    SECTION("cycles over links do not loop forever") {
+        r->begin_transaction();
+        table->set_link(1, 0, 0);
+        table->get_linklist(2, 0)->add(0);
+        r->commit_transaction();
+
+        auto info = track_changes([&] {
+            table->set_int(0, 9, 10);
+        });
+        REQUIRE_FALSE(info.dirty_rows->get_checker(info, *table, tables)(0));
+    }
+
+    SECTION("link chains of any length are tracked") {
+        r->begin_transaction();
+        table->add_empty_row(30);
+        for (int i = 0; i < 39; ++i)
+            table->set_link(1, i, i + 1);
+        r->commit_transaction();
+
+        auto info = track_changes([&] {
+            table->set_int(0, 39, -1);
+        });
+
+        auto checker = info.dirty_rows->get_checker(info, *table, tables);
+        for (int i = 0; i < 40; ++i)
+            REQUIRE(checker(i));
+    }
+
+    SECTION("targets moving is not a change") {
+        r->begin_transaction();
+        table->set_link(1, 0, 9);
+        table->get_linklist(2, 0)->add(9);
+        r->commit_transaction();
+
+        auto info = track_changes([&] {
+            table->move_last_over(5);
+        });
+        REQUIRE_FALSE(info.dirty_rows->get_checker(info, *table, tables)(0));
+    }
+
+    SECTION("tables calculated for a previous checker are reused") {
+        r->begin_transaction();
+        table->set_link(3, 0, 5);
+        r->commit_transaction();
+
+        auto info = track_changes([&] {
+            other_table->set_int(0, 5, 10);
+        });
+
+        std::vector<_impl::DeepChangeChecker::RelatedTable> other_tables;
+        _impl::DeepChangeChecker::find_related_tables(other_tables, *other_table);
+        auto other_checker = info.dirty_rows->get_checker(info, *other_table, other_tables);
+        REQUIRE(other_checker(5));
+        REQUIRE_FALSE(other_checker(0));
+
+        auto checker = info.dirty_rows->get_checker(info, *table, tables);
+        REQUIRE(checker(0));
+        REQUIRE_FALSE(checker(1));
+    }
+}